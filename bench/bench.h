@@ -0,0 +1,88 @@
+/*
+ * Shared helpers for the benchmarks: a clock,
+ * and a sink that counts the write system calls made on its behalf.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <line_sink.h>
+
+#include <string.h>
+#include <time.h>
+
+/*
+ * Get the current time in nanoseconds
+ * returns	the value of the monotonic clock
+ */
+static inline double now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*
+ * the state of a counting sink, which wraps another sink
+ */
+struct count_sink {
+	struct line_sink inner; /* the wrapped sink */
+	size_t n_writes; /* the number of writes passed to "inner" */
+	size_t n_bytes; /* the number of bytes passed to "inner" */
+	size_t n_lines; /* the number of line breaks passed to "inner" */
+};
+
+static inline int count_write(struct line_sink *sink, const char *bytes,
+			      size_t len)
+{
+	struct count_sink *counts = sink->state.ctx;
+	const char *line_end = bytes;
+	const char *end = bytes + len;
+
+	counts->n_writes++;
+	counts->n_bytes += len;
+	while ((line_end = memchr(line_end, '\n', end - line_end)) != NULL) {
+		counts->n_lines++;
+		line_end++;
+	}
+
+	return counts->inner.ops->write(&counts->inner, bytes, len);
+}
+
+static inline int count_flush(struct line_sink *sink)
+{
+	struct count_sink *counts = sink->state.ctx;
+
+	return counts->inner.ops->flush(&counts->inner);
+}
+
+static inline int count_close(struct line_sink *sink)
+{
+	struct count_sink *counts = sink->state.ctx;
+
+	return counts->inner.ops->close(&counts->inner);
+}
+
+static const struct line_sink_ops count_ops = {
+	.write = count_write,
+	.flush = count_flush,
+	.close = count_close
+};
+
+/*
+ * Make a sink that counts what it passes on to another sink.
+ * With a file descriptor sink, every write is one system call.
+ * sink:	the sink to initialize
+ * counts:	the counters, and the wrapped sink, which must be set up
+ */
+static inline void count_sink_init(struct line_sink *sink,
+				   struct count_sink *counts)
+{
+	counts->n_writes = 0;
+	counts->n_bytes = 0;
+	counts->n_lines = 0;
+	sink->ops = &count_ops;
+	sink->state.ctx = counts;
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,103 @@
+/*
+ * Benchmark of "start_if" and "declare_variable",
+ * comparing their concatenation of literal pieces and arguments
+ * against formatting the same text with IF_FMT and VAR_DEC_FMT.
+ */
+#include <c_gen.h>
+
+#include "bench.h"
+
+#include <stdio.h>
+
+/* the number of calls to time for each emitter */
+#define N_CALLS		(1 << 22)
+
+/*
+ * The formatted way of starting an if block
+ * to_start:	contains the stream in which to start the block
+ * condition:	the condition for the if statement
+ * returns	0 iff successful, nonzero otherwise
+ */
+static int printf_start_if(struct c_gen *to_start, char *condition)
+{
+	if (line_gen_printf(&to_start->base_gen, IF_FMT, condition) <= 0) {
+		return -1;
+	}
+	return open_block(to_start);
+}
+
+/*
+ * The formatted way of declaring a variable
+ * to_declare:	the stream in which to declare the variable
+ * new_var	the variable to declare
+ * returns	0 iff successful, nonzero otherwise
+ */
+static int printf_declare_variable(struct c_gen *to_declare,
+				   struct typed_var *new_var)
+{
+	if (line_gen_printf(&to_declare->base_gen, VAR_DEC_FMT,
+			    new_var->type, new_var->name) <= 0) {
+		return -1;
+	}
+	return end_statement(to_declare);
+}
+
+/*
+ * Time one way of emitting an if block around a declaration
+ * out:		the generator to write to
+ * use_printf:	nonzero to format the lines, 0 to use the c_gen.h helpers
+ * if_ns:	set to the average time of starting and closing the block
+ * dec_ns:	set to the average time of declaring the variable
+ */
+static void time_emit(struct c_gen *out, int use_printf,
+		      double *if_ns, double *dec_ns)
+{
+	struct typed_var var = {.type = UNSIGNED_TP " " LONG_TP,
+				.name = "generated_value"};
+	double start;
+	size_t call_i;
+
+	start = now_ns();
+	for (call_i = 0; call_i < N_CALLS; call_i++) {
+		if (use_printf) {
+			printf_start_if(out, "index < count");
+		} else {
+			start_if(out, "index < count");
+		}
+		close_block(out);
+	}
+	*if_ns = (now_ns() - start) / N_CALLS;
+
+	start = now_ns();
+	for (call_i = 0; call_i < N_CALLS; call_i++) {
+		if (use_printf) {
+			printf_declare_variable(out, &var);
+		} else {
+			declare_variable(out, &var);
+		}
+	}
+	*dec_ns = (now_ns() - start) / N_CALLS;
+}
+
+int main()
+{
+	struct line_sink sink;
+	struct c_gen out;
+	int use_printf;
+
+	line_sink_null(&sink);
+	init_c_gen_sink(&out, &sink);
+
+	printf("path\tstart_if_ns\tdeclare_variable_ns\n");
+	for (use_printf = 1; use_printf >= 0; use_printf--) {
+		double if_ns, dec_ns;
+
+		time_emit(&out, use_printf, &if_ns, &dec_ns);
+		printf("%s\t%.2f\t%.2f\n", use_printf ? "printf" : "concat",
+		       if_ns, dec_ns);
+	}
+
+	close_c_gen(&out);
+
+	return 0;
+}
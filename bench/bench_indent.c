@@ -0,0 +1,95 @@
+/*
+ * Microbenchmark of starting indented lines,
+ * comparing the precomputed indentation run in "try_start_line"
+ * against the old path, which filled a stack buffer for every line.
+ */
+#include <line_gen.h>
+
+#include "bench.h"
+
+#include <stdio.h>
+
+/* the number of lines to start at each depth */
+#define N_LINES		(1 << 22)
+/* the deepest indentation to measure */
+#define MAX_DEPTH	64
+/* the output, which only needs to accept the flushed bytes */
+#define NULL_PATH	"/dev/null"
+
+/*
+ * The old way of starting a line,
+ * which built the indentation in a variable-length array on every call.
+ * to_write:	contains the stream to which to try to write the line
+ * returns	0 iff successfuly wrote the bytes;
+ *		-1 iff writing indentation characters failed.
+ */
+static inline int vla_start_line(struct line_gen *to_write)
+{
+	if (to_write->on_new_line) {
+		if (to_write->indent) {
+			char tab_buf[to_write->indent];
+
+			memset(tab_buf, INDENT_CHAR, to_write->indent);
+			if (line_gen_append(to_write, tab_buf,
+					    to_write->indent)) {
+				return -1;
+			}
+		}
+		to_write->on_new_line = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Time starting and finishing lines at one depth
+ * gen:		the generator, already at the desired depth
+ * use_vla:	nonzero to use the old path, 0 to use "try_start_line"
+ * returns	the average cost of a line in nanoseconds
+ */
+static double time_lines(struct line_gen *gen, int use_vla)
+{
+	double start = now_ns();
+	size_t line_i;
+
+	for (line_i = 0; line_i < N_LINES; line_i++) {
+		if (use_vla) {
+			vla_start_line(gen);
+		} else {
+			try_start_line(gen);
+		}
+		finish_line(gen);
+	}
+
+	return (now_ns() - start) / N_LINES;
+}
+
+int main()
+{
+	struct line_gen gen;
+	size_t depth = 0;
+
+	if (open_line_gen(&gen, MAX_DEPTH, NULL_PATH)) {
+		printlg(ERROR_LEVEL, "Could not open %s.\n", NULL_PATH);
+		return 1;
+	}
+
+	printf("depth\tvla_ns_per_line\trun_ns_per_line\n");
+	while (1) {
+		double vla_ns = time_lines(&gen, 1);
+		double run_ns = time_lines(&gen, 0);
+
+		printf("%u\t%.2f\t%.2f\n", (unsigned) depth, vla_ns, run_ns);
+		if (depth == MAX_DEPTH) {
+			break;
+		}
+		depth = depth ? depth * 2 : 1;
+		while (gen.indent < depth) {
+			indent(&gen);
+		}
+	}
+
+	close_line_gen(&gen);
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Benchmark of writing a large generated file
+ * through the FILE stream opened by "open_line_gen",
+ * and through the memory-mapped sink opened by "open_line_gen_mmap",
+ * with and without its staging buffer.
+ */
+#include <c_gen.h>
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the default number of functions to generate */
+#define N_FUNCS		(1 << 20)
+/* the default path of the generated file */
+#define OUT_PATH	"bench_sink_out.c"
+
+/* the ways of opening the output that are compared */
+enum open_mode {
+	FOPEN_MODE, /* "open_line_gen" */
+	MMAP_MODE, /* "open_line_gen_mmap" */
+	MMAP_DIRECT_MODE, /* mapped sink without a staging buffer */
+	N_MODES
+};
+
+static const char *mode_names[N_MODES] = {[FOPEN_MODE] = "fopen",
+					  [MMAP_MODE] = "mmap",
+					  [MMAP_DIRECT_MODE] = "mmap_direct"};
+
+/*
+ * Open the output in one of the compared ways
+ * out:		the generator to open
+ * mode:	the way to open it
+ * path:	the path of the output file
+ * size_hint:	the expected size of the output
+ * returns	0 iff successful, -1 otherwise
+ */
+static int open_out(struct c_gen *out, enum open_mode mode, const char *path,
+		    size_t size_hint)
+{
+	struct line_sink sink;
+
+	str_arena_init(&out->arena);
+	out->protos = NULL;
+	switch (mode) {
+	case FOPEN_MODE:
+		return open_c_gen(out, path);
+	case MMAP_MODE:
+		return open_line_gen_mmap(&out->base_gen, MAX_C_INDENTS, path,
+					  size_hint);
+	default:
+		if (line_sink_mmap(&sink, path, size_hint)) {
+			return -1;
+		}
+		return init_line_gen_sink(&out->base_gen, MAX_C_INDENTS,
+					  &sink, 0);
+	}
+}
+
+/*
+ * Generate a file of small functions
+ * out:		the generator to write to
+ * n_funcs:	the number of functions to generate
+ */
+static void gen_funcs(struct c_gen *out, size_t n_funcs)
+{
+	struct typed_var arg = {.type = INT_TP, .name = "value"};
+	struct typed_var local = {.type = INT_TP, .name = "result"};
+	size_t func_i;
+
+	include(out, STDIO_H_PATH);
+	for (func_i = 0; func_i < n_funcs; func_i++) {
+		finish_line(&out->base_gen);
+		line_gen_write(STATIC_KW " ", &out->base_gen);
+		declare_function(out, INT_TP, "generated", 1, &arg);
+		finish_line(&out->base_gen);
+		open_block(out);
+		declare_variable(out, &local);
+		start_if(out, "value > 0");
+		line_gen_write("result = value * 2", &out->base_gen);
+		end_statement(out);
+		start_else(out);
+		line_gen_write("result = -value", &out->base_gen);
+		end_statement(out);
+		close_block(out);
+		return_value(out, "result");
+		close_block(out);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : OUT_PATH;
+	size_t n_funcs = argc > 2 ? strtoul(argv[2], NULL, 0) : N_FUNCS;
+	size_t size_hint = 0;
+	int mode;
+
+	printf("mode\tseconds\tbytes\tMB_per_s\n");
+	for (mode = 0; mode < N_MODES; mode++) {
+		struct c_gen out;
+		FILE *written;
+		double start, seconds;
+		long size;
+
+		start = now_ns();
+		if (open_out(&out, mode, path, size_hint)) {
+			printlg(ERROR_LEVEL, "Could not open %s.\n", path);
+			return 1;
+		}
+		gen_funcs(&out, n_funcs);
+		if (close_c_gen(&out)) {
+			printlg(ERROR_LEVEL, "Could not close %s.\n", path);
+			return 1;
+		}
+		seconds = (now_ns() - start) / 1e9;
+
+		if ((written = fopen(path, "r")) == NULL) {
+			return 1;
+		}
+		fseek(written, 0, SEEK_END);
+		size = ftell(written);
+		fclose(written);
+		/* later runs know how big the output will be */
+		size_hint = size;
+
+		printf("%s\t%.3f\t%ld\t%.1f\n", mode_names[mode], seconds,
+		       size, size / seconds / 1e6);
+	}
+	remove(path);
+
+	return 0;
+}
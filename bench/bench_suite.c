@@ -0,0 +1,679 @@
+/*
+ * Throughput suite for "struct line_gen" and "struct c_gen".
+ * Microbenchmarks time single calls,
+ * and macrobenchmarks time generating a file of N_MACRO_LINES lines
+ * in the styles of the test vectors.
+ * All output goes to /dev/null through a file descriptor sink,
+ * so every write the library makes is one system call.
+ * Results are printed to stdout as tab-separated values, one row per case.
+ */
+#include <c_gen.h>
+#include <c_snippet.h>
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* the number of calls timed by each microbenchmark */
+#define N_MICRO_CALLS	(1 << 22)
+/* the number of lines generated by each macrobenchmark */
+#define N_MACRO_LINES	(1000 * 1000)
+/* the output, which only needs to accept the written bytes */
+#define NULL_PATH	"/dev/null"
+/* the largest number of arguments given to "declare_function" */
+#define MAX_BENCH_ARGS	16
+
+/* a single benchmark case */
+struct bench_case {
+	/* the name printed in the results */
+	const char *name;
+	/*
+	 * the benchmarked code
+	 * out:		the generator to write to
+	 * counts:	the counters of the sink behind "out"
+	 * returns	the number of calls made, for the time per call
+	 */
+	size_t (*run)(struct c_gen *out, const struct count_sink *counts);
+};
+
+static size_t bench_write(struct c_gen *out, const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	for (call_i = 0; call_i < N_MICRO_CALLS; call_i++) {
+		line_gen_write("token", &out->base_gen);
+		if (call_i % 8 == 7) {
+			finish_line(&out->base_gen);
+		}
+	}
+
+	return N_MICRO_CALLS;
+}
+
+static size_t bench_printf(struct c_gen *out, const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	for (call_i = 0; call_i < N_MICRO_CALLS; call_i++) {
+		line_gen_printf(&out->base_gen, "%s = %u;", "value",
+				(unsigned) call_i);
+		finish_line(&out->base_gen);
+	}
+
+	return N_MICRO_CALLS;
+}
+
+static size_t bench_indent(struct c_gen *out, const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	for (call_i = 0; call_i < N_MICRO_CALLS; call_i++) {
+		indent(&out->base_gen);
+		unindent(&out->base_gen);
+	}
+
+	return N_MICRO_CALLS;
+}
+
+static size_t bench_block(struct c_gen *out, const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	for (call_i = 0; call_i < N_MICRO_CALLS; call_i++) {
+		open_block(out);
+		close_block(out);
+	}
+
+	return N_MICRO_CALLS;
+}
+
+/*
+ * Time "declare_function" with a number of arguments
+ * out:		the generator to write to
+ * n_args:	the number of arguments, up to MAX_BENCH_ARGS
+ * returns	the number of calls made
+ */
+static size_t bench_declare(struct c_gen *out, size_t n_args)
+{
+	struct typed_var arg = {.type = INT_TP, .name = "arg"};
+	struct typed_var *a = &arg;
+	size_t call_i;
+
+	for (call_i = 0; call_i < N_MICRO_CALLS / 4; call_i++) {
+		/* extra arguments past "n_args" are ignored */
+		declare_function(out, INT_TP, "generated", n_args,
+				 a, a, a, a, a, a, a, a,
+				 a, a, a, a, a, a, a, a);
+		end_statement(out);
+	}
+
+	return N_MICRO_CALLS / 4;
+}
+
+static size_t bench_declare_0(struct c_gen *out,
+			      const struct count_sink *counts)
+{
+	(void) counts;
+	return bench_declare(out, 0);
+}
+
+static size_t bench_declare_1(struct c_gen *out,
+			      const struct count_sink *counts)
+{
+	(void) counts;
+	return bench_declare(out, 1);
+}
+
+static size_t bench_declare_4(struct c_gen *out,
+			      const struct count_sink *counts)
+{
+	(void) counts;
+	return bench_declare(out, 4);
+}
+
+static size_t bench_declare_16(struct c_gen *out,
+			       const struct count_sink *counts)
+{
+	(void) counts;
+	return bench_declare(out, MAX_BENCH_ARGS);
+}
+
+/*
+ * Write an error check ladder, the snippet of the snippet benchmarks
+ */
+static int ladder_recorder(struct c_gen *out, void *arg)
+{
+	(void) arg;
+	line_gen_write("if (ret < 0)", &out->base_gen);
+	open_block(out);
+	line_gen_write("log_error(ret)", &out->base_gen);
+	end_statement(out);
+	return_value(out, "ret");
+	close_block(out);
+	finish_line(&out->base_gen);
+
+	return 0;
+}
+
+/* the ladder, recorded before the benchmarks run */
+static struct c_snippet ladder;
+
+static size_t bench_ladder_calls(struct c_gen *out,
+				 const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	open_block(out);
+	for (call_i = 0; call_i < N_MICRO_CALLS / 4; call_i++) {
+		ladder_recorder(out, NULL);
+	}
+	close_block(out);
+
+	return N_MICRO_CALLS / 4;
+}
+
+static size_t bench_ladder_snippet(struct c_gen *out,
+				   const struct count_sink *counts)
+{
+	size_t call_i;
+
+	(void) counts;
+	open_block(out);
+	for (call_i = 0; call_i < N_MICRO_CALLS / 4; call_i++) {
+		c_snippet_emit(&ladder, out);
+	}
+	close_block(out);
+
+	return N_MICRO_CALLS / 4;
+}
+
+/* the number of if statements per generated function */
+#define N_COND_PER_FUNC	64
+
+static size_t bench_cond_malloc(struct c_gen *out,
+				const struct count_sink *counts)
+{
+	size_t call_i;
+	char *cond;
+
+	(void) counts;
+	open_block(out);
+	for (call_i = 0; call_i < N_MICRO_CALLS / 4; call_i++) {
+		int len = snprintf(NULL, 0, "idx_%u < n", (unsigned) call_i);
+
+		if ((cond = malloc(len + 1)) == NULL) {
+			break;
+		}
+		snprintf(cond, len + 1, "idx_%u < n", (unsigned) call_i);
+		start_if(out, cond);
+		close_block(out);
+		free(cond);
+	}
+	close_block(out);
+
+	return N_MICRO_CALLS / 4;
+}
+
+static size_t bench_cond_arena(struct c_gen *out,
+			       const struct count_sink *counts)
+{
+	struct str_builder cond;
+	size_t call_i;
+
+	(void) counts;
+	open_block(out);
+	for (call_i = 0; call_i < N_MICRO_CALLS / 4; call_i++) {
+		c_gen_build_str(out, &cond);
+		str_build_lit(&cond, "idx_");
+		str_build_uint(&cond, call_i);
+		str_build_lit(&cond, " < n");
+		start_if(out, str_build_finish(&cond));
+		close_block(out);
+		if (call_i % N_COND_PER_FUNC == N_COND_PER_FUNC - 1) {
+			c_gen_reset_strs(out);
+		}
+	}
+	close_block(out);
+
+	return N_MICRO_CALLS / 4;
+}
+
+/*
+ * Generate nested blocks up to the maximum depth, like "deep_block.c",
+ * until the sink has seen N_MACRO_LINES lines
+ */
+static size_t bench_deep_block(struct c_gen *out,
+			       const struct count_sink *counts)
+{
+	size_t n_units = 0;
+
+	include(out, STDIO_H_PATH);
+	finish_line(&out->base_gen);
+	while (counts->n_lines < N_MACRO_LINES) {
+		size_t indent_i;
+
+		declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+		finish_line(&out->base_gen);
+		for (indent_i = 0; indent_i < MAX_C_INDENTS; indent_i++) {
+			open_block(out);
+		}
+		line_gen_write("printf(\"Hello World!\\n\")", &out->base_gen);
+		end_statement(out);
+		line_gen_write("return 0", &out->base_gen);
+		end_statement(out);
+		for (indent_i = 0; indent_i < MAX_C_INDENTS; indent_i++) {
+			close_block(out);
+		}
+		finish_line(&out->base_gen);
+		n_units++;
+	}
+
+	return n_units;
+}
+
+/*
+ * Generate struct declarations and uses, like "struct_use.c",
+ * until the sink has seen N_MACRO_LINES lines
+ */
+static size_t bench_struct_use(struct c_gen *out,
+			       const struct count_sink *counts)
+{
+	size_t n_units = 0;
+
+	include(out, STDIO_H_PATH);
+	finish_line(&out->base_gen);
+	while (counts->n_lines < N_MACRO_LINES) {
+		line_gen_printf(&out->base_gen, STRUCT_FMT, "test_struct");
+		open_block(out);
+		line_gen_printf(&out->base_gen, VAR_DEC_FMT, CHAR_TP,
+				"test_member");
+		end_statement(out);
+		_close_block(out);
+		end_statement(out);
+		finish_line(&out->base_gen);
+
+		line_gen_printf(&out->base_gen, VAR_DEF_FMT,
+				STATIC_KW " " STRUCT_KW " " "test_struct",
+				"test_value");
+		open_block(out);
+		line_gen_printf(&out->base_gen, FIELD_ASSIGN_FMT "'h'" ",",
+				"test_member");
+		_close_block(out);
+		end_statement(out);
+		finish_line(&out->base_gen);
+
+		declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+		finish_line(&out->base_gen);
+		open_block(out);
+		line_gen_write("printf(" "\"Member of struct is %c\\n\", "
+			       "test_value.test_member" ")", &out->base_gen);
+		end_statement(out);
+		line_gen_write("return 0", &out->base_gen);
+		end_statement(out);
+		close_block(out);
+		finish_line(&out->base_gen);
+		n_units++;
+	}
+
+	return n_units;
+}
+
+/*
+ * Generate one array of N_MACRO_LINES characters, one per line,
+ * like "array_use.c"
+ */
+static size_t bench_array_use(struct c_gen *out,
+			      const struct count_sink *counts)
+{
+	size_t elem_i;
+
+	(void) counts;
+	include(out, STDIO_H_PATH);
+	finish_line(&out->base_gen);
+	line_gen_write(STATIC_KW " " CHAR_TP " ", &out->base_gen);
+	line_gen_printf(&out->base_gen, ARR_INT_FMT " = ", "letters",
+			N_MACRO_LINES);
+	open_block(out);
+	for (elem_i = 0; elem_i < N_MACRO_LINES; elem_i++) {
+		line_gen_printf(&out->base_gen, "'%c',",
+				(char) ('A' + elem_i % 26));
+		finish_line(&out->base_gen);
+	}
+	_close_block(out);
+	end_statement(out);
+
+	return N_MACRO_LINES;
+}
+
+/* the number of elements per line of the generated lookup tables */
+#define N_TABLE_PER_LINE	8
+
+/*
+ * Fill a lookup table of N_MACRO_LINES lines of pseudorandom entries
+ * returns	the table, or NULL if allocating it failed
+ */
+static uint32_t *make_table(void)
+{
+	size_t n_elems = (size_t) N_MACRO_LINES * N_TABLE_PER_LINE, elem_i;
+	uint32_t *table = malloc(n_elems * sizeof(*table));
+	uint32_t state = 1;
+
+	for (elem_i = 0; table != NULL && elem_i < n_elems; elem_i++) {
+		state = state * 1664525 + 1013904223;
+		table[elem_i] = state >> (elem_i % 32);
+	}
+
+	return table;
+}
+
+/*
+ * Generate a lookup table like "table_use.c", with printf per element,
+ * as in "array_use.c"
+ */
+static size_t bench_table_printf(struct c_gen *out,
+				 const struct count_sink *counts)
+{
+	size_t elem_i, n_elems = (size_t) N_MACRO_LINES * N_TABLE_PER_LINE;
+	uint32_t *table = make_table();
+
+	(void) counts;
+	if (table == NULL) {
+		return 0;
+	}
+	line_gen_printf(&out->base_gen, "static const uint32_t table[%lu] = ",
+			(unsigned long) n_elems);
+	open_block(out);
+	for (elem_i = 0; elem_i < n_elems; elem_i++) {
+		line_gen_printf(&out->base_gen,
+				elem_i % N_TABLE_PER_LINE ? " %u," : "%u,",
+				(unsigned) table[elem_i]);
+		if (elem_i % N_TABLE_PER_LINE == N_TABLE_PER_LINE - 1) {
+			finish_line(&out->base_gen);
+		}
+	}
+	_close_block(out);
+	end_statement(out);
+	free(table);
+
+	return N_MACRO_LINES;
+}
+
+/*
+ * Generate the same lookup table as "bench_table_printf" with "emit_array"
+ */
+static size_t bench_table_emit(struct c_gen *out,
+			       const struct count_sink *counts)
+{
+	uint32_t *table = make_table();
+
+	(void) counts;
+	if (table == NULL) {
+		return 0;
+	}
+	emit_array(out, "table", C_ARRAY_U32, table,
+		   (size_t) N_MACRO_LINES * N_TABLE_PER_LINE, N_TABLE_PER_LINE,
+		   C_ARRAY_DEC);
+	free(table);
+
+	return N_MACRO_LINES;
+}
+
+/*
+ * Fill a table of N_MACRO_LINES lines of pseudorandom coefficients,
+ * which mostly need all 17 significant digits
+ * returns	the table, or NULL if allocating it failed
+ */
+static double *make_coeffs(void)
+{
+	size_t n_elems = (size_t) N_MACRO_LINES * N_TABLE_PER_LINE, elem_i;
+	double *coeffs = malloc(n_elems * sizeof(*coeffs));
+	uint32_t state = 1;
+
+	for (elem_i = 0; coeffs != NULL && elem_i < n_elems; elem_i++) {
+		state = state * 1664525 + 1013904223;
+		coeffs[elem_i] = (double) (int32_t) state / 3e5;
+	}
+
+	return coeffs;
+}
+
+/*
+ * Generate a table of doubles with printf per element, with "%.17g"
+ */
+static size_t bench_coeffs_printf(struct c_gen *out,
+				  const struct count_sink *counts)
+{
+	size_t elem_i, n_elems = (size_t) N_MACRO_LINES * N_TABLE_PER_LINE;
+	double *coeffs = make_coeffs();
+
+	(void) counts;
+	if (coeffs == NULL) {
+		return 0;
+	}
+	line_gen_printf(&out->base_gen, "static const double coeffs[%lu] = ",
+			(unsigned long) n_elems);
+	open_block(out);
+	for (elem_i = 0; elem_i < n_elems; elem_i++) {
+		line_gen_printf(&out->base_gen,
+				elem_i % N_TABLE_PER_LINE ?
+				" %.17g," : "%.17g,", coeffs[elem_i]);
+		if (elem_i % N_TABLE_PER_LINE == N_TABLE_PER_LINE - 1) {
+			finish_line(&out->base_gen);
+		}
+	}
+	_close_block(out);
+	end_statement(out);
+	free(coeffs);
+
+	return N_MACRO_LINES;
+}
+
+/*
+ * Generate the same table as "bench_coeffs_printf" with "emit_array",
+ * with the shortest digits of each element
+ */
+static size_t bench_coeffs_emit(struct c_gen *out,
+				const struct count_sink *counts)
+{
+	double *coeffs = make_coeffs();
+
+	(void) counts;
+	if (coeffs == NULL) {
+		return 0;
+	}
+	emit_array(out, "coeffs", C_ARRAY_DOUBLE, coeffs,
+		   (size_t) N_MACRO_LINES * N_TABLE_PER_LINE, N_TABLE_PER_LINE,
+		   C_ARRAY_DEC);
+	free(coeffs);
+
+	return N_MACRO_LINES;
+}
+
+/* the number of bytes of each line of the generated text, with its break */
+#define TEXT_LINE_LEN	64
+
+/*
+ * Fill the text of N_MACRO_LINES lines of words,
+ * with a quote or backslash on every eighth line
+ * returns	the text, or NULL if allocating it failed
+ */
+static char *make_text(void)
+{
+	size_t len = (size_t) N_MACRO_LINES * TEXT_LINE_LEN, byte_i;
+	char *text = malloc(len);
+	uint32_t state = 1;
+
+	for (byte_i = 0; text != NULL && byte_i < len; byte_i++) {
+		size_t col = byte_i % TEXT_LINE_LEN;
+
+		state = state * 1664525 + 1013904223;
+		if (col == TEXT_LINE_LEN - 1) {
+			text[byte_i] = '\n';
+		} else if (col == 0 && byte_i / TEXT_LINE_LEN % 8 == 0) {
+			text[byte_i] = state >> 31 ? '"' : '\\';
+		} else {
+			text[byte_i] = (state >> 28) < 3 ? ' ' :
+				       'a' + (state >> 24) % 26;
+		}
+	}
+
+	return text;
+}
+
+/*
+ * Generate the text as string literals, one per line,
+ * escaped into a buffer in a second pass and written with STRING_FMT
+ */
+static size_t bench_string_printf(struct c_gen *out,
+				  const struct count_sink *counts)
+{
+	/* every byte escaped, the worst case */
+	char escaped[4 * TEXT_LINE_LEN + 1];
+	char *text = make_text();
+	size_t line_i;
+
+	(void) counts;
+	if (text == NULL) {
+		return 0;
+	}
+	line_gen_write(STATIC_KW " const " CHAR_TP " text[] =",
+		       &out->base_gen);
+	indent(&out->base_gen);
+	for (line_i = 0; line_i < N_MACRO_LINES; line_i++) {
+		const char *line = text + line_i * TEXT_LINE_LEN;
+		size_t byte_i, len = 0;
+
+		for (byte_i = 0; byte_i < TEXT_LINE_LEN; byte_i++) {
+			char c = line[byte_i];
+
+			if (c == '"' || c == '\\') {
+				escaped[len++] = '\\';
+			} else if (c == '\n') {
+				escaped[len++] = '\\';
+				c = 'n';
+			}
+			escaped[len++] = c;
+		}
+		escaped[len] = '\0';
+		line_gen_printf(&out->base_gen, STRING_FMT, escaped);
+		finish_line(&out->base_gen);
+	}
+	unindent(&out->base_gen);
+	end_statement(out);
+	free(text);
+
+	return N_MACRO_LINES;
+}
+
+/*
+ * Generate the same literals as "bench_string_printf"
+ * with "emit_string_literal"
+ */
+static size_t bench_string_emit(struct c_gen *out,
+				const struct count_sink *counts)
+{
+	char *text = make_text();
+
+	(void) counts;
+	if (text == NULL) {
+		return 0;
+	}
+	line_gen_write(STATIC_KW " const " CHAR_TP " text[] = ",
+		       &out->base_gen);
+	emit_string_literal(out, text, (size_t) N_MACRO_LINES * TEXT_LINE_LEN);
+	end_statement(out);
+	free(text);
+
+	return N_MACRO_LINES;
+}
+
+static const struct bench_case bench_cases[] = {
+	{"micro_line_gen_write", bench_write},
+	{"micro_line_gen_printf", bench_printf},
+	{"micro_indent_unindent", bench_indent},
+	{"micro_open_close_block", bench_block},
+	{"micro_declare_function_0", bench_declare_0},
+	{"micro_declare_function_1", bench_declare_1},
+	{"micro_declare_function_4", bench_declare_4},
+	{"micro_declare_function_16", bench_declare_16},
+	{"micro_ladder_calls", bench_ladder_calls},
+	{"micro_ladder_snippet", bench_ladder_snippet},
+	{"micro_cond_malloc", bench_cond_malloc},
+	{"micro_cond_arena", bench_cond_arena},
+	{"macro_deep_block", bench_deep_block},
+	{"macro_struct_use", bench_struct_use},
+	{"macro_array_use", bench_array_use},
+	{"macro_table_printf", bench_table_printf},
+	{"macro_table_emit", bench_table_emit},
+	{"macro_coeffs_printf", bench_coeffs_printf},
+	{"macro_coeffs_emit", bench_coeffs_emit},
+	{"macro_string_printf", bench_string_printf},
+	{"macro_string_emit", bench_string_emit}
+};
+
+/* the number of benchmark cases */
+#define N_BENCH_CASES	(sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+/*
+ * Run a single case, and print its results
+ * bench_case:	the case to run
+ * returns	0 iff successful, -1 if the output could not be opened
+ */
+static int run_case(const struct bench_case *bench_case)
+{
+	struct count_sink counts;
+	struct line_sink sink;
+	struct c_gen out;
+	double start, seconds;
+	size_t n_calls;
+	int fd = open(NULL_PATH, O_WRONLY);
+
+	if (fd < 0) {
+		printlg(ERROR_LEVEL, "Could not open %s.\n", NULL_PATH);
+		return -1;
+	}
+	line_sink_fd(&counts.inner, fd);
+	count_sink_init(&sink, &counts);
+	init_c_gen_sink(&out, &sink);
+
+	start = now_ns();
+	n_calls = bench_case->run(&out, &counts);
+	close_c_gen(&out);
+	seconds = (now_ns() - start) / 1e9;
+
+	printf("%s\t%lu\t%.2f\t%lu\t%lu\t%.0f\t%.0f\t%.2f\n", bench_case->name,
+	       (unsigned long) n_calls, seconds * 1e9 / n_calls,
+	       (unsigned long) counts.n_lines, (unsigned long) counts.n_bytes,
+	       counts.n_lines / seconds, counts.n_bytes / seconds,
+	       counts.n_bytes ? counts.n_writes / (counts.n_bytes / 1e6) : 0);
+
+	return 0;
+}
+
+int main()
+{
+	size_t case_i;
+
+	if (c_snippet_record(&ladder, ladder_recorder, NULL)) {
+		return 1;
+	}
+	printf("name\tcalls\tns_per_call\tlines\tbytes"
+	       "\tlines_per_s\tbytes_per_s\tsyscalls_per_mb\n");
+	for (case_i = 0; case_i < N_BENCH_CASES; case_i++) {
+		if (run_case(&bench_cases[case_i])) {
+			return 1;
+		}
+	}
+	c_snippet_free(&ladder);
+
+	return 0;
+}
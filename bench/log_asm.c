@@ -0,0 +1,11 @@
+/*
+ * An out-of-line copy of "line_gen_write",
+ * compiled to assembly to check that its disabled log statements,
+ * and the evaluation of their arguments, are removed at compile time.
+ */
+#include <line_gen.h>
+
+int asm_line_gen_write(const char *text, struct line_gen *to_write)
+{
+	return line_gen_write(text, to_write);
+}
@@ -1,6 +1,6 @@
 CC=gcc
 CXX=g++
 AR=ar
-_CPPFLAGS=-O3 -Wall -Wextra -Werror
+_CPPFLAGS=-O3 -Wall -Wextra -Werror -pthread
 AR_FLAGS=cr -o
 RM_FLAGS=-f
@@ -0,0 +1,55 @@
+/*
+ * Parallel generation of independent fragments of C code,
+ * such as function definitions,
+ * which are spliced into one "struct c_gen" in a chosen order.
+ */
+#ifndef C_FRAG_H
+#define C_FRAG_H
+
+#include <c_gen.h>
+
+/*
+ * Emit a single fragment.
+ * Called from a worker thread, so it must not touch the parent generator,
+ * and must only share "arg" in a thread-safe way.
+ * out:		a generator writing to the fragment's private buffer,
+ *		starting at the parent's indentation depth and line state
+ * frag_i:	the index of the fragment to emit
+ * arg:		the argument passed to "c_gen_fragments"
+ * returns	0 iff successful, nonzero otherwise
+ */
+typedef int (*c_frag_emitter)(struct c_gen *out, size_t frag_i, void *arg);
+
+/*
+ * Emit fragments on a pool of worker threads, and splice them into the parent.
+ * Each fragment starts at the indentation depth and line state
+ * the parent had when this function was called,
+ * so every fragment spliced before another must end in that same state,
+ * eg. by closing all of the blocks it opened.
+ * The output is byte-identical to calling the emitter on the parent
+ * for each fragment in turn, in the splice order.
+ * Workers take fragments from their own queues,
+ * and steal from the others when theirs run out.
+ * parent:	the generator into which to splice the fragments
+ * n_frags:	the number of fragments to emit
+ * order:	the order in which to splice the fragments,
+ *		as a permutation of the fragment indices,
+ *		or NULL to splice them by increasing index
+ * emitter:	the function that emits each fragment
+ * arg:		passed to every call of "emitter"
+ * n_threads:	the number of worker threads,
+ *		or 0 to use one per online processor,
+ *		which is also the most that are used
+ * returns	0 iff successful;
+ *		-1 if a fragment failed, or splicing the fragments failed,
+ *		   with errno set if a system call failed
+ *		-2 if a fragment did not end in the state it started in,
+ *		   but was not the last to be spliced.
+ *		   Nothing is written to the parent unless the return is 0,
+ *		   or splicing failed.
+ *		Failures are latched in the parent, as by "line_gen_fail".
+ */
+int c_gen_fragments(struct c_gen *parent, size_t n_frags, const size_t *order,
+		    c_frag_emitter emitter, void *arg, size_t n_threads);
+
+#endif /* C_FRAG_H */
@@ -5,14 +5,33 @@
 #define C_GEN_H
 
 #include <line_gen.h>
+#include <str_arena.h>
 #include <logger.h>
 
 #include <stdarg.h>
 
 /* not enforced, but used to determine MAX_C_INDENTS */
 #define MAX_C_CHARS_PER_LINE	80
+/* the number of columns a tab is assumed to take */
+#define C_TAB_WIDTH		8
 /* maximum number of indents allowed in a line of C code */
-#define MAX_C_INDENTS		(MAX_C_CHARS_PER_LINE / 8)
+#define MAX_C_INDENTS		(MAX_C_CHARS_PER_LINE / C_TAB_WIDTH)
+
+/*
+ * the minimum level of the log statements of "struct c_gen",
+ * below which they are compiled out
+ */
+#ifndef C_GEN_LOG_LEVEL
+#define C_GEN_LOG_LEVEL	DISP_LEVEL
+#endif
+#pragma push_macro("LOG_THRESHOLD")
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/*
+ * The constant strings below are string literals,
+ * so wrapping them in LINE_GEN_LIT gives their length at compile time.
+ */
 
 /* opening and closing characters */
 /* for code blocks, unions and structs */
@@ -47,26 +66,48 @@
 #define STRUCT_KW	"struct"
 #define UNION_KW	"union"
 
+/*
+ * Literal pieces around the arguments of the format strings below,
+ * denoted by PRE, SEP and POST suffixes,
+ * so that the same text can be written without parsing a format
+ */
+#define FOR_PRE			"for ("
+#define FOR_SEP			"; "
+#define COND_POST		") "
+#define WHILE_PRE		"while ("
+#define IF_PRE			"if ("
+#define ELSE_IF_PRE		ELSE_KW IF_PRE
+#define SWITCH_PRE		"switch ("
+#define CASE_PRE		"case "
+#define CASE_POST		":"
+#define RETURN_VAL_PRE		RETURN_KW " "
+#define VAR_DEC_SEP		" "
+#define INCLUDE_LOCAL_PRE	INCLUDE_KW "\""
+#define INCLUDE_LOCAL_POST	"\""
+#define INCLUDE_PRE		INCLUDE_KW "<"
+#define INCLUDE_POST		">"
+
 /* Format strings for C code, denoted by FMT suffix */
-#define FOR_FMT			"for (%s; %s; %s) "
-#define WHILE_FMT		"while (%s) "
-#define IF_FMT			"if (%s) "
-#define ELSE_IF_FMT		ELSE_KW IF_FMT
-#define SWITCH_FMT		"switch (%s) "
-#define CASE_FMT		"case %s:"
+#define FOR_FMT			FOR_PRE "%s" FOR_SEP "%s" FOR_SEP "%s" COND_POST
+#define WHILE_FMT		WHILE_PRE "%s" COND_POST
+#define IF_FMT			IF_PRE "%s" COND_POST
+#define ELSE_IF_FMT		ELSE_IF_PRE "%s" COND_POST
+#define SWITCH_FMT		SWITCH_PRE "%s" COND_POST
+#define CASE_FMT		CASE_PRE "%s" CASE_POST
 #define ARR_FMT			"%s[%s]"
 #define ARR_INT_FMT		"%s[%d]"
-#define RETURN_VAL_FMT		RETURN_KW " %s"
+#define RETURN_VAL_FMT		RETURN_VAL_PRE "%s"
 #define STRUCT_FMT		STRUCT_KW " %s "
 #define UNION_FMT		UNION_KW " %s "
-#define VAR_DEC_FMT		"%s %s"
+#define VAR_DEC_FMT		"%s" VAR_DEC_SEP "%s"
 #define VAR_DEF_FMT		VAR_DEC_FMT " = "
 #define ASSIGN_FMT		"%s = "
 #define FIELD_ASSIGN_FMT	FIELD_ACCESS ASSIGN_FMT
 #define TYPEDEF_FMT		"typedef " VAR_DEC_FMT
 #define MACRO_FMT		"#define %s %s"
-#define INCLUDE_LOCAL_FMT	INCLUDE_KW "\"%s\""
-#define INCLUDE_FMT		INCLUDE_KW "<%s>"
+#define INCLUDE_LOCAL_FMT	INCLUDE_LOCAL_PRE "%s" INCLUDE_LOCAL_POST
+#define INCLUDE_FMT		INCLUDE_PRE "%s" INCLUDE_POST
+/* only for text that needs no escaping, see "emit_string_literal" */
 #define STRING_FMT		"\"%s\""
 
 /* types, denoted by TP suffix */
@@ -94,6 +135,16 @@ struct c_gen {
 	 * indentation state and the output stream
 	 */
 	struct line_gen base_gen;
+	/*
+	 * the arena of the strings built for statements, such as conditions,
+	 * which the caller resets between functions
+	 */
+	struct str_arena arena;
+	/*
+	 * the generator to which "declare_function" also writes
+	 * the prototype of every function that is not static, or NULL
+	 */
+	struct c_gen *protos;
 };
 
 /*
@@ -114,34 +165,118 @@ struct typed_var {
  */
 static inline int open_c_gen(struct c_gen *to_open, const char *path)
 {
+	str_arena_init(&to_open->arena);
+	to_open->protos = NULL;
 	return open_line_gen(&to_open->base_gen, MAX_C_INDENTS, path);
 }
 
+/*
+ * Initializes "struct c_gen" with the specific values for proper C code,
+ * and writes to the file through a shared memory mapping
+ * to_open:	the struct in which to write the initialized values
+ * path:	the path of the file to write to
+ * size_hint:	the expected size of the output, or 0 if unknown
+ * returns	0 iff successful;
+ *		-1 if opening or mapping the file failed, which will set errno.
+ */
+static inline int open_c_gen_mmap(struct c_gen *to_open, const char *path,
+				  size_t size_hint)
+{
+	str_arena_init(&to_open->arena);
+	to_open->protos = NULL;
+	return open_line_gen_mmap(&to_open->base_gen, MAX_C_INDENTS, path,
+				  size_hint);
+}
+
+/*
+ * Initializes "struct c_gen" with the specific values for proper C code,
+ * and generates the file in the path in memory,
+ * only replacing it on closing if its contents change,
+ * as by "open_line_gen_if_changed"
+ * to_open:	the struct in which to write the initialized values
+ * path:	the path of the file to write
+ * update:	where to report whether the file was replaced,
+ *		when the struct is closed, or NULL
+ * returns	0 iff successful;
+ *		-1 if allocating the sink failed, which will set errno.
+ */
+static inline int open_c_gen_if_changed(struct c_gen *to_open,
+					const char *path,
+					struct line_sink_update *update)
+{
+	str_arena_init(&to_open->arena);
+	to_open->protos = NULL;
+	return open_line_gen_if_changed(&to_open->base_gen, MAX_C_INDENTS,
+					path, update);
+}
+
 /*
  * Initializes "struct c_gen" with the specific values for proper C code,
  * and sets the FILE stream
  * to_open:	the struct in which to write the initialized values
- * out_stream:	the desired "out_stream" field value
+ * out_stream:	the stream for the "base_gen" field to write to
  */
 static inline void init_c_gen(struct c_gen *to_open, FILE *out_stream)
 {
+	str_arena_init(&to_open->arena);
+	to_open->protos = NULL;
 	init_line_gen(&to_open->base_gen, MAX_C_INDENTS, out_stream);
 }
 
+/*
+ * Initializes "struct c_gen" with the specific values for proper C code,
+ * and sets the output sink
+ * to_open:	the struct in which to write the initialized values
+ * sink:	the sink for the "base_gen" field to write to
+ */
+static inline void init_c_gen_sink(struct c_gen *to_open,
+				   const struct line_sink *sink)
+{
+	str_arena_init(&to_open->arena);
+	to_open->protos = NULL;
+	init_line_gen_sink(&to_open->base_gen, MAX_C_INDENTS, sink,
+			   LINE_GEN_BUF_SIZE);
+}
+
 /*
  * Close the "struct c_gen",
  * which should be done before it is deallocated, or falls out of scope.
- * The "out_stream" field of the "base_gen" field
- * will be closed and set to NULL.
+ * The staging buffer of the "base_gen" field will be flushed,
+ * and its sink will be closed.
+ * The strings built in the arena are released.
  * to_close:	contains the "base_gen" field to close
- * returns	0 iff successful;
- *		-1 if fclose failed, which will set errno
+ * returns	0 iff successful, otherwise the failure,
+ *		as by "close_line_gen"
  */
 static inline int close_c_gen(struct c_gen *to_close)
 {
+	str_arena_free(&to_close->arena);
 	return close_line_gen(&to_close->base_gen);
 }
 
+/*
+ * Start building a string in the arena of a "struct c_gen",
+ * eg. the condition of an if statement, which stays valid
+ * until "c_gen_reset_strs" is called
+ * to_build_in:	contains the arena
+ * builder:	the builder to initialize
+ */
+static inline void c_gen_build_str(struct c_gen *to_build_in,
+				   struct str_builder *builder)
+{
+	str_build_start(builder, &to_build_in->arena);
+}
+
+/*
+ * Invalidate the strings built in the arena of a "struct c_gen",
+ * to reuse its memory, eg. at the end of every generated function
+ * to_reset:	contains the arena
+ */
+static inline void c_gen_reset_strs(struct c_gen *to_reset)
+{
+	str_arena_reset(&to_reset->arena);
+}
+
 /*
  * Start a block with an open brace and indent.
  * to_start:	contains the stream in which to open the block
@@ -154,7 +289,8 @@ static inline int close_c_gen(struct c_gen *to_close)
 static inline int open_block(struct c_gen *to_start)
 {
 	int ret;
-	if ((ret = line_gen_write(BLOCK_OPEN, &to_start->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(BLOCK_OPEN),
+				      &to_start->base_gen))) {
 		printlg(ERROR_LEVEL, "Could not write open brace.\n");
 		return ret;
 	}
@@ -184,7 +320,8 @@ static inline int _close_block(struct c_gen *to_close)
 			"Could not unindent before closing block.\n");
 		return ret;
 	}
-	if ((ret = line_gen_write(BLOCK_CLOSE, &to_close->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(BLOCK_CLOSE),
+				      &to_close->base_gen))) {
 		printlg(ERROR_LEVEL,
 			"Could not write close brace.\n");
 		return ret;
@@ -228,7 +365,8 @@ static inline int close_block(struct c_gen *to_close)
 static inline int end_statement(struct c_gen *to_end)
 {
 	int ret;
-	if ((ret = line_gen_write(END_STATEMENT, &to_end->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(END_STATEMENT),
+				      &to_end->base_gen))) {
 		printlg(ERROR_LEVEL, "Could not end statement.\n");
 		return ret;
 	}
@@ -242,30 +380,54 @@ static inline int end_statement(struct c_gen *to_end)
 }
 
 /*
- * Start if block
+ * Write the head of a control statement, such as "if (condition) ",
+ * and open its block.
  * to_start:	contains the stream in which to start the block
- * condition:	the condition for the if statement
+ * pre:		the literal text before the expression, eg. IF_PRE
+ * expr:	the expression in the parentheses
  * returns	0 iff successful
- *		-1 if writing the if line, or opening the block failed,
+ *		-1 if writing the head, or opening the block failed,
  *		   with errno set
  *		-2 if indenting failed because indentation depth
  *		   would exceed maximum. errno is not set
  */
-static inline int start_if(struct c_gen *to_start, char *condition)
+static inline int _start_cond_block(struct c_gen *to_start,
+				    struct line_gen_str pre, const char *expr)
 {
+	const struct line_gen_str head[] = {
+		pre, LINE_GEN_STR(expr), LINE_GEN_LIT(COND_POST)
+	};
 	int ret;
-	if (line_gen_printf(&to_start->base_gen, IF_FMT, condition) <= 0) {
-		printlg(ERROR_LEVEL, "Could not write \"if\" line.\n");
+
+	if (line_gen_writev(&to_start->base_gen, head, 3)) {
+		printlg(ERROR_LEVEL, "Could not write head of block: %s.\n",
+			pre.str);
 		return -1;
 	}
 	if ((ret = open_block(to_start))) {
-		printlg(ERROR_LEVEL, "Could not open \"if\" block.\n");
+		printlg(ERROR_LEVEL, "Could not open block after %s.\n",
+			pre.str);
 		return ret;
 	}
 
 	return 0;
 }
 
+/*
+ * Start if block
+ * to_start:	contains the stream in which to start the block
+ * condition:	the condition for the if statement
+ * returns	0 iff successful
+ *		-1 if writing the if line, or opening the block failed,
+ *		   with errno set
+ *		-2 if indenting failed because indentation depth
+ *		   would exceed maximum. errno is not set
+ */
+static inline int start_if(struct c_gen *to_start, char *condition)
+{
+	return _start_cond_block(to_start, LINE_GEN_LIT(IF_PRE), condition);
+}
+
 /*
  * Start while block
  * to_start:	contains the stream in which to start the block
@@ -278,17 +440,7 @@ static inline int start_if(struct c_gen *to_start, char *condition)
  */
 static inline int start_while(struct c_gen *to_start, char *condition)
 {
-	int ret;
-	if (line_gen_printf(&to_start->base_gen, WHILE_FMT, condition) <= 0) {
-		printlg(ERROR_LEVEL, "Could not write \"while\" line.\n");
-		return -1;
-	}
-	if ((ret = open_block(to_start))) {
-		printlg(ERROR_LEVEL, "Could not open \"while\" block.\n");
-		return ret;
-	}
-
-	return 0;
+	return _start_cond_block(to_start, LINE_GEN_LIT(WHILE_PRE), condition);
 }
 
 /*
@@ -303,17 +455,7 @@ static inline int start_while(struct c_gen *to_start, char *condition)
  */
 static inline int start_switch(struct c_gen *to_start, char *expr)
 {
-	int ret;
-	if (line_gen_printf(&to_start->base_gen, SWITCH_FMT, expr) <= 0) {
-		printlg(ERROR_LEVEL, "Could not write \"switch\" line.\n");
-		return -1;
-	}
-	if ((ret = open_block(to_start))) {
-		printlg(ERROR_LEVEL, "Could not open \"switch\" block.\n");
-		return ret;
-	}
-
-	return 0;
+	return _start_cond_block(to_start, LINE_GEN_LIT(SWITCH_PRE), expr);
 }
 
 /*
@@ -328,11 +470,16 @@ static inline int start_switch(struct c_gen *to_start, char *expr)
 static inline int add_case(struct c_gen *to_start, char *value)
 {
 	int ret;
+	const struct line_gen_str case_line[] = {
+		LINE_GEN_LIT(CASE_PRE), LINE_GEN_STR(value),
+		LINE_GEN_LIT(CASE_POST)
+	};
+
 	if ((ret = unindent(&to_start->base_gen))) {
 		printlg(ERROR_LEVEL, "Could not unindent to add case.\n");
 		return ret;
 	}
-	if (line_gen_printf(&to_start->base_gen, CASE_FMT, value) <= 0) {
+	if (line_gen_writev(&to_start->base_gen, case_line, 3)) {
 		printlg(ERROR_LEVEL, "Could not write value for \"case\"\n");
 		return -1;
 	}
@@ -362,7 +509,8 @@ static inline int add_default(struct c_gen *to_start)
 			"Could not unindent to add default case.\n");
 		return ret;
 	}
-	if ((ret = line_gen_write(DEFAULT_KW, &to_start->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(DEFAULT_KW),
+				      &to_start->base_gen))) {
 		printlg(ERROR_LEVEL, "Could not start default case\n");
 		return ret;
 	}
@@ -390,9 +538,15 @@ static inline int add_default(struct c_gen *to_start)
 static inline int start_for(struct c_gen *to_start,
 			    char *init, char *condition, char *progress)
 {
+	const struct line_gen_str for_line[] = {
+		LINE_GEN_LIT(FOR_PRE), LINE_GEN_STR(init),
+		LINE_GEN_LIT(FOR_SEP), LINE_GEN_STR(condition),
+		LINE_GEN_LIT(FOR_SEP), LINE_GEN_STR(progress),
+		LINE_GEN_LIT(COND_POST)
+	};
 	int ret;
-	if (line_gen_printf(&to_start->base_gen, FOR_FMT,
-			    init, condition, progress) <= 0) {
+
+	if (line_gen_writev(&to_start->base_gen, for_line, 7)) {
 		printlg(ERROR_LEVEL, "Could not write \"for\" line.\n");
 		return -1;
 	}
@@ -420,7 +574,8 @@ static inline int start_else(struct c_gen *to_start)
 			"Could not end block before \"else\".\n");
 		return ret;
 	}
-	if ((ret = line_gen_write(ELSE_KW, &to_start->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(ELSE_KW),
+				      &to_start->base_gen))) {
 		printlg(ERROR_LEVEL, "Could not write \"else\" statement\n");
 		return ret;
 	}
@@ -450,13 +605,9 @@ static inline int start_else_if(struct c_gen *to_start, char *condition)
 			"Could not end block before else-if.\n");
 		return ret;
 	}
-	if (line_gen_printf(&to_start->base_gen, ELSE_IF_FMT, condition) <= 0) {
-		printlg(ERROR_LEVEL, "Could not write else-if statement\n");
-		return -1;
-	}
-
-	if ((ret = open_block(to_start))) {
-		printlg(ERROR_LEVEL, "Could not open else-if block.\n");
+	if ((ret = _start_cond_block(to_start, LINE_GEN_LIT(ELSE_IF_PRE),
+				     condition))) {
+		printlg(ERROR_LEVEL, "Could not start else-if block.\n");
 		return ret;
 	}
 
@@ -473,10 +624,13 @@ static inline int start_else_if(struct c_gen *to_start, char *condition)
 inline static int include_local(struct c_gen *to_include_in,
 				const char *local_header)
 {
+	const struct line_gen_str include_line[] = {
+		LINE_GEN_LIT(INCLUDE_LOCAL_PRE), LINE_GEN_STR(local_header),
+		LINE_GEN_LIT(INCLUDE_LOCAL_POST)
+	};
 	int ret;
 
-	if (line_gen_printf(&to_include_in->base_gen, INCLUDE_LOCAL_FMT,
-			    local_header) <= 0) {
+	if (line_gen_writev(&to_include_in->base_gen, include_line, 3)) {
 		printlg(ERROR_LEVEL, "Could not write local include line.\n");
 		return -1;
 	}
@@ -499,10 +653,13 @@ inline static int include_local(struct c_gen *to_include_in,
  */
 inline static int include(struct c_gen *to_include_in, const char *header)
 {
+	const struct line_gen_str include_line[] = {
+		LINE_GEN_LIT(INCLUDE_PRE), LINE_GEN_STR(header),
+		LINE_GEN_LIT(INCLUDE_POST)
+	};
 	int ret;
 
-	if (line_gen_printf(&to_include_in->base_gen, INCLUDE_FMT, header)
-	    <= 0) {
+	if (line_gen_writev(&to_include_in->base_gen, include_line, 3)) {
 		printlg(ERROR_LEVEL, "Could not write include line.\n");
 		return -1;
 	}
@@ -525,10 +682,13 @@ inline static int include(struct c_gen *to_include_in, const char *header)
 inline static int
 declare_variable(struct c_gen *to_declare, struct typed_var *new_var)
 {
+	const struct line_gen_str dec_line[] = {
+		LINE_GEN_STR(new_var->type), LINE_GEN_LIT(VAR_DEC_SEP),
+		LINE_GEN_STR(new_var->name)
+	};
 	int ret;
 
-	if (line_gen_printf(&(to_declare->base_gen), VAR_DEC_FMT,
-			    new_var->type, new_var->name) <= 0) {
+	if (line_gen_writev(&to_declare->base_gen, dec_line, 3)) {
 		printlg(ERROR_LEVEL, "Could not declare %s %s.\n",
 			new_var->type, new_var->name);
 		return -1;
@@ -551,10 +711,12 @@ declare_variable(struct c_gen *to_declare, struct typed_var *new_var)
  */
 inline static int return_value(struct c_gen *to_return, char *ret_value)
 {
+	const struct line_gen_str return_line[] = {
+		LINE_GEN_LIT(RETURN_VAL_PRE), LINE_GEN_STR(ret_value)
+	};
 	int ret;
 
-	if (line_gen_printf(&(to_return->base_gen), RETURN_VAL_FMT,
-			    ret_value) <= 0) {
+	if (line_gen_writev(&to_return->base_gen, return_line, 2)) {
 		printlg(ERROR_LEVEL, "Could not return %s.\n", ret_value);
 		return -1;
 	}
@@ -577,9 +739,186 @@ inline static int return_value(struct c_gen *to_return, char *ret_value)
  * n_args:	number of function arguments to follow
  * ...:		"struct typed_var *" instances that determine the arguments
  *		of the new function
+ * If "to_declare" has a generator of prototypes, and the type does not
+ * start with STATIC_KW, the prototype is also written there as a statement,
+ * without any INLINE_KW at the start of the type,
+ * so that the definition is an external one.
  * returns	0 iff successful
  *		-1 if writing a line failed, with errno set
  */
 int declare_function(struct c_gen *to_declare, const char *type,
 		     const char *name, size_t n_args, ...);
+
+/*
+ * Write bytes as a string literal, escaped in a single pass.
+ * Quotes and backslashes are escaped, as is the second of "??",
+ * which could start a trigraph,
+ * line breaks, tabs and carriage returns are written as "\n", "\t" and "\r",
+ * and other control bytes and non-ASCII bytes as three-digit octal escapes.
+ * A literal that is too long for a line, or that has a line break
+ * before its end, is split into adjacent literals, one per line,
+ * each ending after a line break of the text, or where the line is full,
+ * so that they fit in MAX_C_CHARS_PER_LINE columns,
+ * with room for a comma or semicolon after the last one.
+ * A literal that fits in one piece, but not in the rest of the current line,
+ * starts on a line of its own.
+ * The lines are indented one deeper than the current line,
+ * or as deep as it, if the literal starts it.
+ * to_emit:	the generator to write to
+ * bytes:	the bytes of the string, which need not be 0-terminated
+ * len:		the number of bytes
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+int emit_string_literal(struct c_gen *to_emit, const char *bytes,
+			size_t len);
+
+/*
+ * the element types of the arrays written by "emit_array",
+ * which are named as in stdint.h
+ */
+enum c_array_type {
+	C_ARRAY_U8,
+	C_ARRAY_U16,
+	C_ARRAY_U32,
+	C_ARRAY_U64,
+	C_ARRAY_I8,
+	C_ARRAY_I16,
+	C_ARRAY_I32,
+	C_ARRAY_I64,
+	C_ARRAY_FLOAT,
+	C_ARRAY_DOUBLE,
+	N_C_ARRAY_TYPES
+};
+
+/* how "emit_array" and the literal writers below write numbers */
+enum c_array_radix {
+	C_ARRAY_DEC, /* in decimal */
+	/*
+	 * in hexadecimal, zero-padded to the width of the type for integers,
+	 * and as exact hexadecimal floating point literals, eg. "0x1.8p-3"
+	 */
+	C_ARRAY_HEX
+};
+
+/* the longest literals of a float and a double, eg. "-1.17549435e-38f" */
+#define C_FLOAT_LITERAL_MAX_LEN		17
+#define C_DOUBLE_LITERAL_MAX_LEN	24
+
+/*
+ * Format a float as the shortest decimal literal that reads back
+ * as the same float, with an "f" suffix,
+ * or as "INFINITY", "-INFINITY" or "NAN" of math.h if it is not finite.
+ * Integral values keep a decimal point, eg. "1.0f", or an exponent,
+ * so that they stay floating point literals.
+ * dst:		where to write the literal,
+ *		with room for C_FLOAT_LITERAL_MAX_LEN characters
+ * value:	the float to format
+ * radix:	C_ARRAY_HEX for a hexadecimal literal
+ * returns	the number of characters written, without a terminating 0
+ */
+size_t format_float_literal(char *dst, float value, enum c_array_radix radix);
+
+/*
+ * Format a double as the shortest decimal literal that reads back
+ * as the same double, as by "format_float_literal" but with no suffix
+ * dst:		where to write the literal,
+ *		with room for C_DOUBLE_LITERAL_MAX_LEN characters
+ * value:	the double to format
+ * radix:	C_ARRAY_HEX for a hexadecimal literal
+ * returns	the number of characters written, without a terminating 0
+ */
+size_t format_double_literal(char *dst, double value,
+			     enum c_array_radix radix);
+
+/*
+ * Write a float to the current line, as by "format_float_literal"
+ * to_write:	the generator to write to
+ * value:	the float to write
+ * radix:	C_ARRAY_HEX for a hexadecimal literal
+ * returns	0 iff successful, -1 if writing failed
+ */
+int write_float_literal(struct c_gen *to_write, float value,
+			enum c_array_radix radix);
+
+/*
+ * Write a double to the current line, as by "format_double_literal"
+ * to_write:	the generator to write to
+ * value:	the double to write
+ * radix:	C_ARRAY_HEX for a hexadecimal literal
+ * returns	0 iff successful, -1 if writing failed
+ */
+int write_double_literal(struct c_gen *to_write, double value,
+			 enum c_array_radix radix);
+
+/*
+ * Define a constant array from the elements in memory, as
+ * "static const T name[N] = {", with the elements on the following lines,
+ * and "};" after them.
+ * Elements are formatted straight into the staging buffer,
+ * without going through printf, with floats and doubles formatted
+ * as by "format_float_literal" and "format_double_literal".
+ * The output uses the types of stdint.h,
+ * and INFINITY and NAN of math.h for elements that are not finite,
+ * which the generated file must include.
+ * to_emit:	the generator to write the array to
+ * name:	the name of the array
+ * type:	the type of the elements
+ * data:	the elements, as an array of the matching C type
+ * n_elems:	the number of elements, which must not be 0
+ * per_line:	the number of elements per line,
+ *		or 0 for as many as fit in MAX_C_CHARS_PER_LINE columns
+ *		at their widest
+ * radix:	the radix of the elements
+ * returns	0 iff successful;
+ *		-1 if writing failed, with errno set,
+ *		   or an argument was invalid, with errno set to EINVAL
+ *		-2 if indenting the elements would exceed the maximum depth
+ */
+int emit_array(struct c_gen *to_emit, const char *name,
+	       enum c_array_type type, const void *data, size_t n_elems,
+	       size_t per_line, enum c_array_radix radix);
+
+/* how "embed_file" embeds a file */
+enum c_embed_mode {
+	/* as a "static const uint8_t" array, like "xxd -i" */
+	C_EMBED_ARRAY,
+	/*
+	 * as an ".incbin" directive in a top-level asm statement,
+	 * which the assembler reads the file with,
+	 * so that the compiler does not parse the bytes.
+	 * Only for ELF targets of the GNU assembler, or one compatible.
+	 */
+	C_EMBED_INCBIN
+};
+
+/*
+ * Embed the bytes of a file as the array "name",
+ * followed by "static const size_t name_len" with its length.
+ * In C_EMBED_ARRAY mode, the file is mapped a window at a time,
+ * or read a buffer at a time if it cannot be mapped, eg. if it is a pipe,
+ * in which case the length is left out of the array's brackets.
+ * Either way, only a bounded part of the file is in memory at once.
+ * An empty file gives a single 0 byte, with a length of 0.
+ * In C_EMBED_INCBIN mode, "name" is a global symbol,
+ * declared as "extern const uint8_t name[]", and "path" is written as is,
+ * so it must name the file from where the output is assembled.
+ * The output uses the types of stdint.h and stddef.h,
+ * which the generated file must include.
+ * to_emit:	the generator to write to
+ * name:	the name of the array
+ * path:	the path of the file to embed
+ * mode:	how to embed the file
+ * per_line:	the number of bytes per line in C_EMBED_ARRAY mode,
+ *		or 0 for as many as fit in MAX_C_CHARS_PER_LINE columns
+ * radix:	the radix of the bytes in C_EMBED_ARRAY mode
+ * returns	0 iff successful;
+ *		-1 if reading the file or writing failed, with errno set,
+ *		   which is EINVAL if the file cannot be embedded in "mode",
+ *		   eg. a path with quotes or backslashes in C_EMBED_INCBIN mode
+ *		-2 if indenting the bytes would exceed the maximum depth
+ */
+int embed_file(struct c_gen *to_emit, const char *name, const char *path,
+	       enum c_embed_mode mode, size_t per_line,
+	       enum c_array_radix radix);
+#pragma pop_macro("LOG_THRESHOLD")
 #endif /* C_GEN_H */
@@ -0,0 +1,105 @@
+/*
+ * Generating one logical translation unit as several files, or shards,
+ * that can be compiled in parallel.
+ * A prelude of includes and declarations is written once,
+ * and copied to the start of every shard,
+ * each function is written to the shard with the fewest bytes so far,
+ * and the prototypes of the functions are collected in a header
+ * that every shard includes after its prelude,
+ * so that functions can call each other across shards.
+ * Functions are written with the usual calls of "struct c_gen",
+ * such as "declare_function", so existing emitters work unchanged.
+ */
+#ifndef C_SHARDS_H
+#define C_SHARDS_H
+
+#include <c_gen.h>
+
+/*
+ * a translation unit being generated as shards,
+ * named "prefix_0.c", "prefix_1.c" and so on,
+ * with the header of prototypes named "prefix.h"
+ */
+struct c_shards {
+	/* the generators of the shards */
+	struct c_gen *shards;
+	/* the number of bytes of functions written to each shard */
+	size_t *loads;
+	/* the number of shards */
+	size_t n_shards;
+	/* the generator of the header of prototypes */
+	struct c_gen header;
+	/* the name of the header, as included by the shards */
+	char *header_name;
+	/* the generator of the prelude, which collects it in memory */
+	struct c_gen prelude;
+	/* nonzero once the prelude has been copied to every shard */
+	int prelude_done;
+	/* the shard of the function being written, or NULL if none is */
+	struct c_gen *current;
+	/* the start of the function being written, in "current" */
+	struct line_gen_checkpoint start;
+};
+
+/*
+ * Open the files of the shards, and of their header
+ * shards:	the struct in which to write the initialized values
+ * prefix:	the path of the files, without the shard number and suffix
+ * n_shards:	the number of shards, which must not be 0
+ * returns	0 iff successful;
+ *		-1 if opening a file or allocating failed, which will set errno,
+ *		   or "n_shards" is 0, which sets errno to EINVAL
+ */
+int c_shards_open(struct c_shards *shards, const char *prefix,
+		  size_t n_shards);
+
+/*
+ * Get the generator of the prelude, to write the includes and declarations
+ * that every shard starts with, before the first function is started
+ * shards:	the shards whose prelude to write
+ * returns	the generator of the prelude
+ */
+static inline struct c_gen *c_shards_prelude(struct c_shards *shards)
+{
+	return &shards->prelude;
+}
+
+/*
+ * Start writing a function to the shard with the fewest bytes of functions,
+ * copying the prelude to every shard first if this is the first function.
+ * The function is kept in the shard's staging buffer until it is ended,
+ * as by a checkpoint, so it must not reserve holes.
+ * Its prototype is added to the header by "declare_function",
+ * so it must be declared with it, on the returned generator itself,
+ * rather than in a fragment or snippet.
+ * shards:	the shards to write the function to
+ * returns	the generator to write the function with,
+ *		or NULL if a function is already being written,
+ *		which sets errno to EINVAL,
+ *		or copying the prelude failed, with errno set
+ */
+struct c_gen *c_shards_start_function(struct c_shards *shards);
+
+/*
+ * Finish writing a function, adding its size to its shard
+ * shards:	the shards the function is written to
+ * returns	0 iff successful;
+ *		-1 if no function is being written,
+ *		   which sets errno to EINVAL,
+ *		   or writing the function failed, with errno set
+ *		-2 if the function failed to be written for a reason
+ *		   other than a system call, as latched in its shard
+ */
+int c_shards_end_function(struct c_shards *shards);
+
+/*
+ * Close the files of the shards and of the header,
+ * and release the shards.
+ * A function that is still being written is ended first.
+ * shards:	the shards to close
+ * returns	0 iff successful, otherwise the first failure,
+ *		of ending a function or as by "close_c_gen"
+ */
+int c_shards_close(struct c_shards *shards);
+
+#endif /* C_SHARDS_H */
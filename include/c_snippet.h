@@ -0,0 +1,162 @@
+/*
+ * Prerendered snippets of C code, such as error-check ladders,
+ * which are recorded once, and then replayed any number of times
+ * into a "struct c_gen" at any indentation depth,
+ * instead of going through the calls that generated them again.
+ * A snippet is prerendered at every depth up to MAX_C_INDENTS
+ * in the default indentation style, and then replayed with a single copy.
+ * In other styles, it is replayed with one copy of the indentation
+ * and one of the text per line.
+ */
+#ifndef C_SNIPPET_H
+#define C_SNIPPET_H
+
+#include <c_gen.h>
+
+/* snippets log at the threshold of "struct c_gen" */
+#pragma push_macro("LOG_THRESHOLD")
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/* a line of a snippet */
+struct c_snippet_line {
+	size_t start; /* the offset of the line in the snippet's text */
+	size_t len; /* the length of the line, including its line break */
+	size_t depth; /* the indentation depth, relative to the snippet */
+	int indented; /* 0 iff the line is blank, and so is not indented */
+};
+
+/*
+ * a recorded snippet
+ */
+struct c_snippet {
+	char *text; /* the text of every line, without indentation */
+	struct c_snippet_line *lines; /* the lines, in order */
+	size_t n_lines; /* the number of lines */
+	size_t len; /* the number of bytes of text */
+	size_t n_indented; /* the number of lines that are indented */
+	size_t depth_sum; /* the sum of the depths of the indented lines */
+	size_t max_depth; /* the deepest indentation of any line */
+	size_t end_depth; /* the indentation depth after the snippet */
+	int end_on_new_line; /* the line state after the snippet */
+	/*
+	 * the whole snippet indented at each depth from 0,
+	 * with INDENT_CHAR and INDENT_WIDTH, one depth after another
+	 */
+	char *rendered;
+	/* the number of depths in "rendered" */
+	size_t n_rendered;
+	/* the offset of each depth in "rendered", and the end of the last */
+	size_t rendered_at[MAX_C_INDENTS + 2];
+};
+
+/*
+ * Generate the text of a snippet.
+ * out:		the generator recording the snippet, at depth 0
+ * arg:		the argument passed to "c_snippet_record"
+ * returns	0 iff successful, nonzero otherwise
+ */
+typedef int (*c_snippet_recorder)(struct c_gen *out, void *arg);
+
+/*
+ * Record a snippet, by calling a function that generates it
+ * at indentation depth 0, and on a new line.
+ * The snippet must only break lines with "finish_line"
+ * and the functions that call it, such as "open_block",
+ * and must not close blocks it did not open.
+ * snippet:	the struct in which to record the snippet
+ * recorder:	the function that generates the snippet
+ * arg:		passed to "recorder"
+ * returns	0 iff successful;
+ *		-1 if the recorder, or allocating failed,
+ *		   with errno set if allocating failed
+ */
+int c_snippet_record(struct c_snippet *snippet, c_snippet_recorder recorder,
+		     void *arg);
+
+/*
+ * Release a recorded snippet
+ * snippet:	the snippet to release
+ */
+void c_snippet_free(struct c_snippet *snippet);
+
+/*
+ * Write a recorded snippet at the current indentation depth,
+ * which gives the same text as calling its recorder on "out".
+ * If "out" is not on a new line, the first line of the snippet continues it.
+ * The prerendered snippet is used if "out" is on a new line,
+ * and indented in the default style.
+ * snippet:	the snippet to write
+ * out:		the generator to write to
+ * returns	0 iff successful;
+ *		-1 if writing failed, with errno set
+ *		-2 if a line would be indented past "max_indent",
+ *		   in which case nothing is written.
+ *		Failures are latched in "out", as by "line_gen_fail".
+ */
+static inline int c_snippet_emit(const struct c_snippet *snippet,
+				 struct c_gen *out)
+{
+	struct line_gen *base = &out->base_gen;
+	size_t line_i;
+
+	if (base->indent + snippet->max_depth > base->max_indent) {
+		printlg(DEBUG_LEVEL, "Snippet would exceed maximum of %u.\n",
+			(unsigned) base->max_indent);
+		return line_gen_fail(base, -2);
+	}
+	if (line_gen_cover_indent(base, base->indent + snippet->max_depth)) {
+		return line_gen_fail(base, -1);
+	}
+
+	if (base->on_new_line && base->indent < snippet->n_rendered &&
+	    base->indent_char == INDENT_CHAR &&
+	    base->indent_width == INDENT_WIDTH) {
+		size_t start = snippet->rendered_at[base->indent];
+
+		if (line_gen_append(base, snippet->rendered + start,
+				    snippet->rendered_at[base->indent + 1] -
+				    start)) {
+			return -1;
+		}
+		LINE_GEN_COUNT(base, n_indent_bytes,
+			       (snippet->n_indented * base->indent +
+				snippet->depth_sum) * INDENT_WIDTH);
+		LINE_GEN_COUNT(base, n_lines, snippet->n_lines -
+			       (snippet->n_lines > 0 &&
+				!snippet->end_on_new_line));
+		if (snippet->n_lines > 0) {
+			base->on_new_line = snippet->end_on_new_line;
+		}
+		base->indent += snippet->end_depth;
+		return 0;
+	}
+
+	for (line_i = 0; line_i < snippet->n_lines; line_i++) {
+		const struct c_snippet_line *line = &snippet->lines[line_i];
+
+		if (base->on_new_line && line->indented) {
+			size_t indent_len = (base->indent + line->depth) *
+					    base->indent_width;
+
+			if (line_gen_append(base, base->indent_run,
+					    indent_len)) {
+				return -1;
+			}
+			LINE_GEN_COUNT(base, n_indent_bytes, indent_len);
+		}
+		if (line_gen_append(base, snippet->text + line->start,
+				    line->len)) {
+			return -1;
+		}
+		base->on_new_line = line_i + 1 < snippet->n_lines ||
+				    snippet->end_on_new_line;
+		LINE_GEN_COUNT(base, n_lines, base->on_new_line);
+	}
+	base->indent += snippet->end_depth;
+
+	return 0;
+}
+
+#pragma pop_macro("LOG_THRESHOLD")
+#endif /* C_SNIPPET_H */
@@ -7,8 +7,40 @@
 
 #include <stdio.h>
 
+/*
+ * the position of the first difference between two files
+ */
+struct file_diff {
+	/*
+	 * the byte offset of the first difference,
+	 * which is the length of the shorter file
+	 * if it is the start of the longer one
+	 */
+	size_t offset;
+	/* the line of the first difference, counting from 1 */
+	size_t line;
+	/* the column of the first difference, counting from 1 */
+	size_t column;
+};
+
+/*
+ * Compare the contents of two files from their current positions,
+ * and find the first difference.
+ * Regular files are mapped into memory,
+ * and other files, such as pipes, are read in large blocks.
+ * in_0:	the first file to read
+ * in_1:	the second file to read
+ * diff:	set to the position of the first difference,
+ *		if the files differ, and "diff" is not NULL
+ * returns	1 iff the files are equal;
+ *		0 if they differ;
+ *		-1 if reading either file failed, which will set errno
+ */
+int files_compare(FILE *in_0, FILE *in_1, struct file_diff *diff);
+
 /*
  * Check if two files have the same contents.
+ * The position of the first difference, if any, is logged.
  * in_0:	the first file to read
  * in_1:	the second file to read
  * returns	1 iff the files are equal, 0 otherwise
@@ -0,0 +1,87 @@
+/*
+ * A cache of generated fragments of C code in a local folder,
+ * keyed by a hash of whatever the fragment is generated from,
+ * so that fragments whose inputs did not change since the last run
+ * are copied from the folder instead of being emitted again.
+ * Cached fragments are stored relative to indentation depth 0,
+ * and re-indented to the depth of the generator they are spliced into.
+ * The folder is bounded in size, by evicting the least recently used
+ * fragments first.
+ * A cache must only be used by one thread at a time.
+ */
+#ifndef FRAG_CACHE_H
+#define FRAG_CACHE_H
+
+#include <c_frag.h>
+
+/* a single cached fragment */
+struct frag_cache_entry {
+	unsigned long long key; /* the hash of the fragment's inputs */
+	size_t size; /* the size of the fragment's file */
+	unsigned long long used_ns; /* when the fragment was last used */
+};
+
+/*
+ * an open cache folder
+ */
+struct frag_cache {
+	char *dir; /* the path of the folder */
+	size_t max_bytes; /* the largest total size of the cached files */
+	size_t n_bytes; /* the total size of the cached files */
+	/* the cached fragments, sorted by key */
+	struct frag_cache_entry *entries;
+	size_t n_entries; /* the number of entries in "entries" */
+	size_t cap; /* the capacity of "entries" */
+	size_t n_hits; /* the fragments copied from the cache */
+	size_t n_misses; /* the fragments emitted and then cached */
+	size_t n_evictions; /* the fragments evicted to bound the size */
+};
+
+/*
+ * Open a cache folder, creating it if needed,
+ * and evict fragments from it until it fits the size bound
+ * cache:	the struct in which to write the initialized values
+ * dir:		the path of the folder
+ * max_bytes:	the largest total size of the cached files
+ * returns	0 iff successful;
+ *		-1 if the folder could not be created or read,
+ *		   or allocating failed, which will set errno
+ */
+int frag_cache_open(struct frag_cache *cache, const char *dir,
+		    size_t max_bytes);
+
+/*
+ * Release a cache, keeping its folder
+ * cache:	the cache to release
+ */
+void frag_cache_close(struct frag_cache *cache);
+
+/*
+ * Write a fragment, from the cache if it holds the key,
+ * and otherwise by calling the emitter, and then caching its output.
+ * The output is the same as calling the emitter on "out",
+ * as long as the fragment only breaks lines with "finish_line"
+ * and the functions that call it, such as "open_block",
+ * and does not close blocks it did not open.
+ * Cached fragments are checked against "max_indent"
+ * with the deepest depth that their emitter reached.
+ * cache:	the cache to look up
+ * out:		the generator to write the fragment to
+ * key:		the hash of everything the fragment's text depends on,
+ *		except the indentation depth and style of "out"
+ * emitter:	the function that emits the fragment, on a miss
+ * frag_i:	passed to "emitter"
+ * arg:		passed to "emitter"
+ * returns	0 iff successful;
+ *		-1 if the emitter, or writing to "out" failed,
+ *		   with errno set if a system call failed
+ *		-2 if the fragment would be indented past "max_indent",
+ *		   or closed blocks it did not open.
+ *		Failing to store a fragment in the cache is not a failure.
+ *		Failures are latched in "out", as by "line_gen_fail".
+ */
+int frag_cache_emit(struct frag_cache *cache, struct c_gen *out,
+		    unsigned long long key, c_frag_emitter emitter,
+		    size_t frag_i, void *arg);
+
+#endif /* FRAG_CACHE_H */
@@ -1,60 +1,315 @@
 /*
- * A generic wrapper around the FILE stream to keep track of indentation,
- * which helps create properly-formatted code.
+ * A generic wrapper around an output sink, such as a FILE stream,
+ * to keep track of indentation, which helps create properly-formatted code.
  */
 #ifndef FORMAT_GEN_H
 #define FORMAT_GEN_H
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 
 #include <logger.h>
+#include <line_sink.h>
+
+#ifdef LINE_GEN_STATS
+#include <time.h>
+#endif
 
 /*
- * the indentation tab character,
- * which will be printed once per indentation depth
+ * the default indentation character,
+ * which will be printed INDENT_WIDTH times per indentation depth
  */
 #define INDENT_CHAR	'\t'
+/* the default number of indentation characters per indentation depth */
+#define INDENT_WIDTH	1
 /* the line break string */
 #define LINE_BREAK_STR "\n"
 /* the length of the line break string */
-#define LINE_BREAK_LEN	strlen(LINE_BREAK_STR)
+#define LINE_BREAK_LEN	(sizeof(LINE_BREAK_STR) - 1)
+/*
+ * the default size of the staging buffer,
+ * which collects the written text before it is written to the sink
+ */
+#ifndef LINE_GEN_BUF_SIZE
+#define LINE_GEN_BUF_SIZE	(256 * 1024)
+#endif
+
+/*
+ * the minimum level of the log statements of "struct line_gen",
+ * below which they are compiled out
+ */
+#ifndef LINE_GEN_LOG_LEVEL
+#define LINE_GEN_LOG_LEVEL	DISP_LEVEL
+#endif
+#pragma push_macro("LOG_THRESHOLD")
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	LINE_GEN_LOG_LEVEL
+
+/*
+ * a string with a known length, which need not be 0-terminated
+ */
+struct line_gen_str {
+	const char *str; /* the first character of the string */
+	size_t len; /* the number of characters in the string */
+};
+
+/* a "struct line_gen_str" of a string literal, sized at compile time */
+#define LINE_GEN_LIT(lit)	((struct line_gen_str) {lit, sizeof(lit) - 1})
+/* a "struct line_gen_str" of a 0-terminated string, sized with strlen */
+#define LINE_GEN_STR(text)	((struct line_gen_str) {text, strlen(text)})
+
+#ifdef LINE_GEN_STATS
+/*
+ * counters of the work done by a "struct line_gen",
+ * kept only if LINE_GEN_STATS is defined
+ */
+struct line_gen_stats {
+	/* the number of line breaks written by "finish_line" */
+	size_t n_lines;
+	/* the number of bytes written, including indentation and line breaks */
+	size_t n_bytes;
+	/* the number of bytes written to indent lines */
+	size_t n_indent_bytes;
+	/* the number of successful calls to "indent" */
+	size_t n_indents;
+	/* the number of successful calls to "less_indent" and "unindent" */
+	size_t n_unindents;
+	/* the deepest indentation reached */
+	size_t max_depth;
+	/* the number of writes to the sink, eg. system calls */
+	size_t n_sink_writes;
+	/* the number of flushes of the sink */
+	size_t n_sink_flushes;
+	/* the time spent writing to and flushing the sink, in nanoseconds */
+	unsigned long long sink_ns;
+};
+
+/* add to a counter of a "struct line_gen" */
+#define LINE_GEN_COUNT(gen, counter, n)	((gen)->stats.counter += (n))
+#else
+#define LINE_GEN_COUNT(gen, counter, n)	((void) 0)
+#endif /* LINE_GEN_STATS */
+
+/*
+ * a segment of the staged text, which is split into a list of segments
+ * once a hole is reserved in it:
+ * a chunk of text, optionally followed by a hole,
+ * which is a placeholder for text that is only known later
+ */
+struct line_gen_hole {
+	/* the next segment, or NULL if this is the last */
+	struct line_gen_hole *next;
+	/* the text before the hole, which owns it */
+	char *text;
+	/* the number of bytes of "text" */
+	size_t len;
+	/* 0 if there is no hole after "text", but just more text */
+	int is_hole;
+	/* nonzero once the hole is filled */
+	int filled;
+	/* the text of the hole, once it is filled */
+	char *fill;
+	/* the number of bytes of "fill" */
+	size_t fill_len;
+	/* the indentation depth, column and line state at the hole */
+	size_t indent;
+	size_t col;
+	int on_new_line;
+};
 
 /*
- * the basic wrapper that keeps track of the FILE stream,
+ * the basic wrapper that keeps track of the output sink,
  * as well as the current indentation depth, up to a chosen limit,
  * and if the indentation still needs to be written for the current line
  */
 struct line_gen {
-	/* the FILE stream to write to */
-	FILE *out_stream;
+	/* the sink to write to, eg. a FILE stream */
+	struct line_sink sink;
+	/*
+	 * the staging buffer, which holds text not yet written to the sink,
+	 * or NULL if every write goes straight to the sink
+	 */
+	char *buf;
+	/* the capacity of "buf" */
+	size_t buf_size;
+	/* the number of bytes in "buf" waiting to be flushed */
+	size_t buf_used;
 	/* current indentation depth. default of 0 */
 	size_t indent;
 	/* the maximum indentation depth */
 	size_t max_indent;
+	/*
+	 * the deepest indentation depth covered by "line_gen_cover_indent"
+	 * since initialization, ie. reached or about to be reached
+	 */
+	size_t deepest;
+	/* the character repeated to indent a line */
+	char indent_char;
+	/* the number of "indent_char" characters per indentation depth */
+	size_t indent_width;
+	/*
+	 * a run of "indent_char" characters, long enough for the deepest
+	 * indentation reached so far, so that a line is indented with a slice
+	 */
+	char *indent_run;
+	/* the number of characters in "indent_run" */
+	size_t indent_run_len;
 	/*
 	 * Have we not written to the line yet?
 	 * If so we'll need to indent on the next write.
 	 */
 	int on_new_line;
+	/*
+	 * the number of bytes written to the current line so far,
+	 * indentation included, ie. since the last line break
+	 */
+	size_t col;
+	/*
+	 * the return code of the first call that failed, or 0 if none has,
+	 * ie. -1 for a failed write or allocation,
+	 * or -2 for indentation past the maximum or below 0
+	 */
+	int error;
+	/* the errno of the first failure, if "error" is -1 */
+	int error_errno;
+	/*
+	 * Is the struct in sticky-error mode?
+	 * If so, nothing more is written to the sink once "error" is set.
+	 */
+	int sticky;
+	/*
+	 * the number of checkpoints taken and not yet rolled back or committed,
+	 * while which the staging buffer grows instead of being written out
+	 */
+	size_t n_checkpoints;
+	/*
+	 * the segments of text staged before the staging buffer,
+	 * while any hole is reserved, or NULL if none is
+	 */
+	struct line_gen_hole *holes;
+	/* the last segment in "holes" */
+	struct line_gen_hole *last_hole;
+#ifdef LINE_GEN_STATS
+	/* the work done so far */
+	struct line_gen_stats stats;
+#endif
+};
+
+/*
+ * the state of a "struct line_gen" to which it can be rolled back
+ */
+struct line_gen_checkpoint {
+	/* the number of staged bytes */
+	size_t buf_used;
+	/* the indentation depth */
+	size_t indent;
+	/* the column and line state */
+	size_t col;
+	int on_new_line;
+	/* the latched failure, and its errno */
+	int error;
+	int error_errno;
+	/* the number of checkpoints taken before this one */
+	size_t depth;
 };
 
 /*
  * Initializes "struct line_gen" with the default values,
- * and sets the "out_stream" field
+ * sets the "sink" field,
+ * and allocates a staging buffer of the given size
  * to_open:	the struct in which to write the initialized values
  * max_indent:	the desired "max_indent" field value
- * out_stream:	the desired "out_stream" field value
+ * sink:	the sink to copy into the "sink" field
+ * buf_size:	the size of the staging buffer, or 0 to write to the sink
+ *		on every call
+ * returns	0 iff successful;
+ *		-1 if allocating the staging buffer failed,
+ *		   which will set errno.
+ *		   The struct is then initialized without a buffer.
  */
-static inline void init_line_gen(struct line_gen *to_open,
-				 size_t max_indent, FILE *out_stream)
+static inline int init_line_gen_sink(struct line_gen *to_open,
+				     size_t max_indent,
+				     const struct line_sink *sink,
+				     size_t buf_size)
 {
-	to_open->out_stream = out_stream;
+	int ret = 0;
+
+	to_open->sink = *sink;
+	to_open->buf = NULL;
+	to_open->buf_size = 0;
+	to_open->buf_used = 0;
 	to_open->indent = 0;
 	to_open->max_indent = max_indent;
+	to_open->deepest = 0;
+	to_open->indent_char = INDENT_CHAR;
+	to_open->indent_width = INDENT_WIDTH;
+	to_open->indent_run = NULL;
+	to_open->indent_run_len = 0;
 	to_open->on_new_line = 1;
+	to_open->col = 0;
+	to_open->error = 0;
+	to_open->error_errno = 0;
+	to_open->sticky = 0;
+	to_open->n_checkpoints = 0;
+	to_open->holes = NULL;
+	to_open->last_hole = NULL;
+#ifdef LINE_GEN_STATS
+	memset(&to_open->stats, 0, sizeof(to_open->stats));
+#endif
+
+	if (buf_size > 0) {
+		if ((to_open->buf = malloc(buf_size)) == NULL) {
+			printlg(DEBUG_LEVEL,
+				"Could not allocate staging buffer.\n");
+			ret = -1;
+		} else {
+			to_open->buf_size = buf_size;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Initializes "struct line_gen" with the default values,
+ * sets the "sink" field to write to a FILE stream,
+ * and allocates a staging buffer of the given size
+ * to_open:	the struct in which to write the initialized values
+ * max_indent:	the desired "max_indent" field value
+ * out_stream:	the stream for the "sink" field to write to
+ * buf_size:	the size of the staging buffer, or 0 to write to the stream
+ *		on every call
+ * returns	0 iff successful;
+ *		-1 if allocating the staging buffer failed,
+ *		   which will set errno.
+ *		   The struct is then initialized without a buffer.
+ */
+static inline int init_line_gen_buf(struct line_gen *to_open,
+				    size_t max_indent, FILE *out_stream,
+				    size_t buf_size)
+{
+	struct line_sink sink;
+
+	line_sink_stdio(&sink, out_stream);
+	return init_line_gen_sink(to_open, max_indent, &sink, buf_size);
+}
+
+/*
+ * Initializes "struct line_gen" with the default values,
+ * and sets the "sink" field to write to a FILE stream.
+ * A staging buffer of LINE_GEN_BUF_SIZE bytes is used if it can be allocated,
+ * and otherwise, text is written to the stream on every call.
+ * to_open:	the struct in which to write the initialized values
+ * max_indent:	the desired "max_indent" field value
+ * out_stream:	the stream for the "sink" field to write to
+ */
+static inline void init_line_gen(struct line_gen *to_open,
+				 size_t max_indent, FILE *out_stream)
+{
+	init_line_gen_buf(to_open, max_indent, out_stream, LINE_GEN_BUF_SIZE);
 }
 
 /*
@@ -76,24 +331,710 @@ static inline int open_line_gen(struct line_gen *to_open,
 	}
 
 	init_line_gen(to_open, max_indent, out_stream);
+	/* the staging buffer makes the stream's own buffer redundant */
+	if (to_open->buf != NULL) {
+		setvbuf(out_stream, NULL, _IONBF, 0);
+	}
+
+	return 0;
+}
+
+/*
+ * Initializes "struct line_gen" with the default values,
+ * and writes to the file in the path through a shared memory mapping,
+ * which is preallocated to the expected size of the output.
+ * The staging buffer is copied into the mapping when full,
+ * without any system call unless the mapping needs to grow.
+ * to_open:	the struct in which to write the initialized values
+ * max_indent:	the desired "max_indent" field value
+ * path:	the path of the file to open
+ * size_hint:	the expected size of the output, or 0 if unknown
+ * returns	0 iff successful;
+ *		-1 if opening or mapping the file failed, which will set errno.
+ */
+static inline int open_line_gen_mmap(struct line_gen *to_open,
+				     size_t max_indent, const char *path,
+				     size_t size_hint)
+{
+	struct line_sink sink;
+
+	if (line_sink_mmap(&sink, path, size_hint)) {
+		printlg(DEBUG_LEVEL, "Could not map output file.\n");
+		return -1;
+	}
+
+	init_line_gen_sink(to_open, max_indent, &sink, LINE_GEN_BUF_SIZE);
 
 	return 0;
 }
 
+/*
+ * Initializes "struct line_gen" with the default values,
+ * and generates the file in the path in memory,
+ * only replacing the file when the struct is closed,
+ * and only if the generated contents differ from the existing ones,
+ * as by "line_sink_if_changed"
+ * to_open:	the struct in which to write the initialized values
+ * max_indent:	the desired "max_indent" field value
+ * path:	the path of the file to write
+ * update:	where to report whether the file was replaced,
+ *		when the struct is closed, or NULL
+ * returns	0 iff successful;
+ *		-1 if allocating the sink failed, which will set errno.
+ */
+static inline int open_line_gen_if_changed(struct line_gen *to_open,
+					   size_t max_indent, const char *path,
+					   struct line_sink_update *update)
+{
+	struct line_sink sink;
+
+	if (line_sink_if_changed(&sink, path, update)) {
+		printlg(DEBUG_LEVEL, "Could not open output file.\n");
+		return -1;
+	}
+
+	init_line_gen_sink(to_open, max_indent, &sink, LINE_GEN_BUF_SIZE);
+
+	return 0;
+}
+
+#ifdef LINE_GEN_STATS
+/*
+ * Read the monotonic clock, to time the sink
+ * returns	the time in nanoseconds
+ */
+static inline unsigned long long line_gen_now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+
+/*
+ * Latch a failure, if it is the first,
+ * so that it can be queried later with "line_gen_error".
+ * Called by the functions below wherever a failure originates.
+ * to_fail:	the struct in which to latch the failure
+ * error:	the return code of the failure, -1 or -2
+ * returns	"error", to be returned by the failing call
+ */
+static inline int line_gen_fail(struct line_gen *to_fail, int error)
+{
+	if (to_fail->error == 0) {
+		to_fail->error = error;
+		to_fail->error_errno = error == -1 ? errno : 0;
+	}
+
+	return error;
+}
+
+/*
+ * Get the first failure since the struct was initialized,
+ * like "ferror" does for a FILE stream
+ * to_check:	the struct to check
+ * returns	0 if no call has failed;
+ *		-1 if a write or allocation failed,
+ *		   and sets errno to what it was then
+ *		-2 if indentation would have exceeded the maximum,
+ *		   or gone below 0
+ */
+static inline int line_gen_error(struct line_gen *to_check)
+{
+	if (to_check->error == -1) {
+		errno = to_check->error_errno;
+	}
+
+	return to_check->error;
+}
+
+/*
+ * Forget the latched failure, so that writing to the sink can resume
+ * to_clear:	the struct whose failure to forget
+ */
+static inline void line_gen_clear_error(struct line_gen *to_clear)
+{
+	to_clear->error = 0;
+	to_clear->error_errno = 0;
+}
+
+/*
+ * Turn sticky-error mode on or off.
+ * In sticky-error mode, the return codes of the writing functions
+ * can be ignored: once a call fails,
+ * nothing more is written to the sink, including text already staged,
+ * and "close_line_gen" aborts the sink and returns the first failure.
+ * to_set:	the struct whose mode to set
+ * sticky:	nonzero to turn sticky-error mode on, 0 to turn it off
+ */
+static inline void line_gen_set_sticky(struct line_gen *to_set, int sticky)
+{
+	to_set->sticky = sticky;
+}
+
+/*
+ * Move the column past bytes written to the output,
+ * restarting it after the last line break in them
+ * to_track:	contains the column
+ * bytes:	the bytes written
+ * len:		the number of bytes written
+ */
+static inline void line_gen_track_col(struct line_gen *to_track,
+				      const char *bytes, size_t len)
+{
+	size_t byte_i = len;
+
+	/* most writes hold no line break, which memchr finds out fastest */
+	if (memchr(bytes, LINE_BREAK_STR[0], len) == NULL) {
+		to_track->col += len;
+		return;
+	}
+	while (bytes[byte_i - 1] != LINE_BREAK_STR[0]) {
+		byte_i--;
+	}
+	to_track->col = len - byte_i;
+}
+
+/*
+ * Write bytes to the sink, counting and timing the write
+ * if LINE_GEN_STATS is defined
+ * to_write:	contains the sink
+ * bytes:	the bytes to write
+ * len:		the number of bytes to write
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static inline int line_gen_sink_write(struct line_gen *to_write,
+				      const char *bytes, size_t len)
+{
+#ifdef LINE_GEN_STATS
+	unsigned long long start = line_gen_now_ns();
+	int ret = to_write->sink.ops->write(&to_write->sink, bytes, len);
+
+	to_write->stats.sink_ns += line_gen_now_ns() - start;
+	to_write->stats.n_sink_writes++;
+
+	return ret;
+#else
+	return to_write->sink.ops->write(&to_write->sink, bytes, len);
+#endif
+}
+
+/*
+ * Flush the sink, counting and timing the flush
+ * if LINE_GEN_STATS is defined
+ * to_flush:	contains the sink
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static inline int line_gen_sink_flush(struct line_gen *to_flush)
+{
+#ifdef LINE_GEN_STATS
+	unsigned long long start = line_gen_now_ns();
+	int ret = to_flush->sink.ops->flush(&to_flush->sink);
+
+	to_flush->stats.sink_ns += line_gen_now_ns() - start;
+	to_flush->stats.n_sink_flushes++;
+
+	return ret;
+#else
+	return to_flush->sink.ops->flush(&to_flush->sink);
+#endif
+}
+
+/*
+ * Write out the segments before the first hole that is not filled yet,
+ * and then the staging buffer, if every hole is filled.
+ * Called by "line_gen_drain" while any hole is reserved.
+ * to_drain:	contains the segments, staging buffer and sink
+ * returns	0 iff successful;
+ *		-1 if writing to the sink failed, which will set errno,
+ *		   or an earlier call failed in sticky-error mode.
+ *		   The segments that were to be written are still released.
+ */
+int line_gen_drain_holes(struct line_gen *to_drain);
+
+/*
+ * Move the staging buffer to the end of the segments,
+ * and start a new one with room for at least the given number of bytes.
+ * Called instead of draining the staging buffer
+ * while a hole that is not filled yet holds the text back.
+ * to_split:	contains the segments and staging buffer
+ * len:		the number of bytes the new staging buffer must hold
+ * returns	0 iff successful;
+ *		-1 if allocating failed, which will set errno
+ */
+int line_gen_detach_chunk(struct line_gen *to_split, size_t len);
+
+/*
+ * Write out the contents of the staging buffer to the sink,
+ * without flushing the sink itself.
+ * A space at the end of the text stays staged,
+ * so that a line break written next can still replace it.
+ * While a checkpoint is held, nothing is written, and the text stays staged.
+ * While a hole is reserved, nothing past the first hole that is not filled
+ * is written.
+ * to_drain:	contains the staging buffer and sink
+ * returns	0 iff successful;
+ *		-1 if writing to the sink failed, which will set errno,
+ *		   or an earlier call failed in sticky-error mode.
+ *		   The staging buffer is still emptied.
+ */
+static inline int line_gen_drain(struct line_gen *to_drain)
+{
+	size_t to_write = to_drain->buf_used, held;
+
+	if (to_drain->n_checkpoints > 0) {
+		return 0;
+	}
+	if (to_drain->holes != NULL) {
+		return line_gen_drain_holes(to_drain);
+	}
+	to_drain->buf_used = 0;
+	if (to_drain->sticky && to_drain->error) {
+		return -1;
+	}
+	held = to_write > 0 && to_drain->buf[to_write - 1] == ' ';
+	if (to_write > held &&
+	    line_gen_sink_write(to_drain, to_drain->buf, to_write - held)) {
+		printlg(DEBUG_LEVEL, "Could not drain staging buffer.\n");
+		return line_gen_fail(to_drain, -1);
+	}
+	if (held) {
+		to_drain->buf[0] = ' ';
+		to_drain->buf_used = 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Write bytes straight to the sink, after the staged text,
+ * once the staging buffer is drained, and too small for them.
+ * A space at the end of the bytes is staged instead,
+ * as by "line_gen_drain".
+ * to_write:	contains the staging buffer and sink
+ * bytes:	the bytes to write
+ * len:		the number of bytes to write
+ * returns	0 iff successful;
+ *		-1 if writing to the sink failed, which will set errno
+ */
+static inline int line_gen_write_through(struct line_gen *to_write,
+					 const char *bytes, size_t len)
+{
+	size_t held = to_write->buf_size > 0 && len > 0 &&
+		      bytes[len - 1] == ' ';
+
+	if ((to_write->buf_used > 0 &&
+	     line_gen_sink_write(to_write, to_write->buf,
+				 to_write->buf_used)) ||
+	    (len > held && line_gen_sink_write(to_write, bytes, len - held))) {
+		printlg(DEBUG_LEVEL, "Could not write past buffer.\n");
+		to_write->buf_used = 0;
+		return line_gen_fail(to_write, -1);
+	}
+	to_write->buf_used = held;
+	if (held) {
+		to_write->buf[0] = ' ';
+	}
+	line_gen_track_col(to_write, bytes, len);
+	LINE_GEN_COUNT(to_write, n_bytes, len);
+
+	return 0;
+}
+
+/*
+ * Write out the contents of the staging buffer to the sink,
+ * and flush the sink.
+ * Must be called before writing to the sink without the "struct line_gen".
+ * to_flush:	contains the staging buffer and sink
+ * returns	0 iff successful;
+ *		-1 if writing to or flushing the sink failed,
+ *		   which will set errno.
+ *		   The staging buffer is still emptied.
+ */
+static inline int line_gen_flush(struct line_gen *to_flush)
+{
+	int ret = line_gen_drain(to_flush);
+
+	/* the space that draining kept staged goes out too */
+	if (to_flush->buf_used > 0 && to_flush->n_checkpoints == 0 &&
+	    to_flush->holes == NULL) {
+		if (ret == 0 && line_gen_sink_write(to_flush, to_flush->buf,
+						    to_flush->buf_used)) {
+			printlg(DEBUG_LEVEL, "Could not drain last space.\n");
+			ret = line_gen_fail(to_flush, -1);
+		}
+		to_flush->buf_used = 0;
+	}
+	if (line_gen_sink_flush(to_flush)) {
+		printlg(DEBUG_LEVEL, "Could not flush sink.\n");
+		ret = line_gen_fail(to_flush, -1);
+	}
+
+	return ret;
+}
+
+/*
+ * Fill every hole that is not filled yet with nothing,
+ * so that all of the text can be written out
+ * to_fill:	contains the segments
+ */
+void line_gen_abandon_holes(struct line_gen *to_fill);
+
 /*
  * Close the "struct line_gen",
  * which should be done before it is deallocated, or falls out of scope.
- * The "out_stream" field will be closed and set to NULL.
- * to_close:	the struct whose FILE stream to close
+ * The staging buffer will be flushed and freed,
+ * and the "sink" field will be closed.
+ * Checkpoints still held are committed,
+ * and holes that are not filled yet are left empty.
+ * In sticky-error mode, if a failure was latched,
+ * the sink is aborted instead of closed,
+ * so that a sink such as "line_sink_if_changed" keeps the old file.
+ * Otherwise, failures of earlier calls can still be queried
+ * with "line_gen_error" after closing.
+ * to_close:	the struct whose sink to close
  * returns	0 iff successful;
- *		-1 if fclose failed, which will set errno
+ *		-1 if flushing or closing the sink failed, which will set errno
+ *		In sticky-error mode, the first failure, of an earlier call
+ *		or of flushing or closing the sink,
+ *		as returned by "line_gen_error"
  */
 static inline int close_line_gen(struct line_gen *to_close)
 {
-	FILE *stream_to_close = to_close->out_stream;
+	int ret, close_errno;
+
+	to_close->n_checkpoints = 0;
+	if (to_close->holes != NULL) {
+		line_gen_abandon_holes(to_close);
+	}
+	ret = line_gen_flush(to_close);
+	close_errno = errno;
+
+	free(to_close->buf);
+	to_close->buf = NULL;
+	to_close->buf_size = 0;
+	free(to_close->indent_run);
+	to_close->indent_run = NULL;
+	to_close->indent_run_len = 0;
+	if (to_close->sticky && line_gen_error(to_close) &&
+	    to_close->sink.ops->abort != NULL) {
+		if (to_close->sink.ops->abort(&to_close->sink)) {
+			line_gen_fail(to_close, -1);
+		}
+	} else if (to_close->sink.ops->close(&to_close->sink)) {
+		ret = line_gen_fail(to_close, -1);
+		close_errno = errno;
+	}
+	if (to_close->sticky) {
+		return line_gen_error(to_close);
+	}
+
+	errno = close_errno;
+	return ret;
+}
+
+/*
+ * Grow the staging buffer geometrically, while a checkpoint is held
+ * to_grow:	contains the staging buffer
+ * len:		the number of bytes for which to make room
+ * returns	0 iff successful;
+ *		-1 if growing the buffer failed, which will set errno
+ */
+static inline int line_gen_grow(struct line_gen *to_grow, size_t len)
+{
+	size_t need = to_grow->buf_used + len;
+	size_t new_size = to_grow->buf_size * 2;
+	char *new_buf;
+
+	if (need <= to_grow->buf_size && to_grow->buf != NULL) {
+		return 0;
+	}
+	if (new_size < need) {
+		new_size = need;
+	}
+	if (new_size < LINE_GEN_BUF_SIZE) {
+		new_size = LINE_GEN_BUF_SIZE;
+	}
+	if ((new_buf = realloc(to_grow->buf, new_size)) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not grow staging buffer.\n");
+		return -1;
+	}
+	to_grow->buf = new_buf;
+	to_grow->buf_size = new_size;
+
+	return 0;
+}
+
+/*
+ * Append bytes to the output as they are, without checking for a new line.
+ * The bytes are staged in the buffer if they fit,
+ * and otherwise written to the sink after draining the buffer,
+ * unless a checkpoint is held, in which case the buffer grows,
+ * or a hole holds the text back, in which case a new buffer is started.
+ * to_write:	contains the staging buffer and sink
+ * bytes:	the bytes to append
+ * len:		the number of bytes to append
+ * returns	0 iff successful;
+ *		-1 if writing to the sink, or growing the buffer failed,
+ *		   which will set errno
+ */
+static inline int line_gen_append(struct line_gen *to_write,
+				  const char *bytes, size_t len)
+{
+	if (len > to_write->buf_size - to_write->buf_used ||
+	    to_write->buf == NULL) {
+		if (to_write->n_checkpoints > 0) {
+			if (line_gen_grow(to_write, len)) {
+				return line_gen_fail(to_write, -1);
+			}
+		} else if (line_gen_drain(to_write)) {
+			return -1;
+		} else if (to_write->holes != NULL) {
+			if (line_gen_detach_chunk(to_write, len)) {
+				return line_gen_fail(to_write, -1);
+			}
+		} else if (to_write->buf == NULL ||
+			   len > to_write->buf_size - to_write->buf_used) {
+			return line_gen_write_through(to_write, bytes, len);
+		}
+	}
+	memcpy(to_write->buf + to_write->buf_used, bytes, len);
+	to_write->buf_used += len;
+	line_gen_track_col(to_write, bytes, len);
+	LINE_GEN_COUNT(to_write, n_bytes, len);
+
+	return 0;
+}
+
+/*
+ * Make room for bytes at the end of the staging buffer,
+ * so that they can be formatted there directly,
+ * and then kept with "line_gen_advance".
+ * The staged text is drained first if there is not enough room,
+ * and the buffer grows if it is still too small,
+ * eg. if every write went straight to the sink before.
+ * to_write:	contains the staging buffer
+ * len:		the largest number of bytes that will be kept
+ * returns	where to write the bytes, or NULL if draining or growing
+ *		the buffer failed, which will set errno,
+ *		and is latched as by "line_gen_fail"
+ */
+static inline char *line_gen_reserve(struct line_gen *to_write, size_t len)
+{
+	if (to_write->buf_size - to_write->buf_used < len) {
+		if (to_write->n_checkpoints == 0) {
+			if (line_gen_drain(to_write)) {
+				return NULL;
+			}
+			if (to_write->holes != NULL &&
+			    line_gen_detach_chunk(to_write, len)) {
+				line_gen_fail(to_write, -1);
+				return NULL;
+			}
+		}
+		if (line_gen_grow(to_write, len)) {
+			line_gen_fail(to_write, -1);
+			return NULL;
+		}
+	}
+
+	return to_write->buf + to_write->buf_used;
+}
+
+/*
+ * Keep bytes written to the room made by "line_gen_reserve",
+ * without checking for a new line
+ * to_write:	contains the staging buffer
+ * len:		the number of bytes written, up to the number reserved
+ */
+static inline void line_gen_advance(struct line_gen *to_write, size_t len)
+{
+	line_gen_track_col(to_write, to_write->buf + to_write->buf_used, len);
+	to_write->buf_used += len;
+	LINE_GEN_COUNT(to_write, n_bytes, len);
+}
+
+/*
+ * Take a checkpoint, to which the output can be rolled back.
+ * Until it is rolled back or committed,
+ * everything written after it is kept in the staging buffer,
+ * which grows as needed, so the sink sees none of it.
+ * Checkpoints nest: one taken after another must be released first,
+ * or is released along with it.
+ * to_save:	the struct whose state to save
+ * checkpoint:	where to save the state
+ */
+static inline void line_gen_checkpoint(struct line_gen *to_save,
+				       struct line_gen_checkpoint *checkpoint)
+{
+	checkpoint->buf_used = to_save->buf_used;
+	checkpoint->indent = to_save->indent;
+	checkpoint->col = to_save->col;
+	checkpoint->on_new_line = to_save->on_new_line;
+	checkpoint->error = to_save->error;
+	checkpoint->error_errno = to_save->error_errno;
+	checkpoint->depth = to_save->n_checkpoints++;
+}
+
+/*
+ * Discard everything written since a checkpoint,
+ * and restore the indentation, line state and latched failure,
+ * by truncating the staging buffer, without touching the text.
+ * Checkpoints taken after it are released too.
+ * to_restore:	the struct whose state to restore
+ * checkpoint:	the state to restore, which is released
+ */
+static inline void line_gen_rollback(struct line_gen *to_restore,
+				     const struct line_gen_checkpoint
+				     *checkpoint)
+{
+	to_restore->buf_used = checkpoint->buf_used;
+	to_restore->indent = checkpoint->indent;
+	to_restore->col = checkpoint->col;
+	to_restore->on_new_line = checkpoint->on_new_line;
+	to_restore->error = checkpoint->error;
+	to_restore->error_errno = checkpoint->error_errno;
+	to_restore->n_checkpoints = checkpoint->depth;
+}
+
+/*
+ * Keep everything written since a checkpoint, and release it.
+ * Checkpoints taken after it are released too.
+ * Once no checkpoint is held, the staged text is written out as usual.
+ * to_keep:	the struct holding the checkpoint
+ * checkpoint:	the checkpoint to release
+ */
+static inline void line_gen_commit(struct line_gen *to_keep,
+				   const struct line_gen_checkpoint *checkpoint)
+{
+	to_keep->n_checkpoints = checkpoint->depth;
+}
+
+/*
+ * Reserve a hole at the current position of the output,
+ * to be filled with text that is only known later, such as the includes
+ * that the rest of the file turns out to need.
+ * The text staged so far is kept as a chunk before the hole,
+ * and a new staging buffer is started after it, so nothing is moved.
+ * Nothing after the first hole that is not filled yet is written out,
+ * so the text after it stays in memory, a chunk per staging buffer.
+ * Must not be called while a checkpoint is held.
+ * to_split:	the struct in which to reserve the hole
+ * returns	the hole, to be filled with "line_gen_fill_begin"
+ *		and "line_gen_fill_end", or NULL if allocating failed,
+ *		which will set errno, and is latched in "to_split"
+ */
+struct line_gen_hole *line_gen_reserve_hole(struct line_gen *to_split);
+
+/*
+ * Start filling a hole, by setting up a generator that collects the text
+ * of the hole in memory, at the indentation depth and line state at the hole,
+ * and with the indentation style and maximum depth of "gen".
+ * to_fill:	the generator in which the hole was reserved
+ * hole:	the hole to fill, which must not be filled yet
+ * filler:	the struct in which to write the initialized values,
+ *		to generate the text of the hole with
+ * returns	0 iff successful;
+ *		-1 if allocating failed, which will set errno
+ */
+int line_gen_fill_begin(const struct line_gen *to_fill,
+			const struct line_gen_hole *hole,
+			struct line_gen *filler);
+
+/*
+ * Finish filling a hole, by closing the generator that collected its text,
+ * and splicing the text into the output of "to_fill",
+ * which then writes out everything up to the next hole that is not filled.
+ * The text of the hole must end at the indentation depth and line state
+ * it started at, so that the text after the hole still lines up.
+ * to_fill:	the generator in which the hole was reserved
+ * hole:	the hole to fill
+ * filler:	the generator set up by "line_gen_fill_begin", which is closed
+ * returns	0 iff successful;
+ *		-1 if generating the text of the hole,
+ *		   or writing to the sink failed, with errno set
+ *		-2 if the text of the hole ended at another depth or line state,
+ *		   in which case the hole is left empty.
+ *		Failures are latched in "to_fill", as by "line_gen_fail".
+ */
+int line_gen_fill_end(struct line_gen *to_fill, struct line_gen_hole *hole,
+		      struct line_gen *filler);
+
+/*
+ * Make sure that the indentation run covers the given depth,
+ * growing it geometrically, up to the maximum depth, if it is too short,
+ * and count the depth in "deepest".
+ * to_grow:	contains the indentation run
+ * depth:	the indentation depth that the run must cover
+ * returns	0 iff the run is long enough;
+ *		-1 if growing the run failed, which will set errno
+ */
+static inline int line_gen_cover_indent(struct line_gen *to_grow, size_t depth)
+{
+	size_t need = depth * to_grow->indent_width;
+	size_t new_len;
+	char *new_run;
+
+	if (depth > to_grow->deepest) {
+		to_grow->deepest = depth;
+	}
+	if (need <= to_grow->indent_run_len) {
+		return 0;
+	}
+
+	new_len = to_grow->indent_run_len * 2;
+	if (new_len > to_grow->max_indent * to_grow->indent_width) {
+		new_len = to_grow->max_indent * to_grow->indent_width;
+	}
+	if (new_len < need) {
+		new_len = need;
+	}
+	if ((new_run = realloc(to_grow->indent_run, new_len)) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not grow indentation run.\n");
+		return -1;
+	}
+	memset(new_run + to_grow->indent_run_len, to_grow->indent_char,
+	       new_len - to_grow->indent_run_len);
+	to_grow->indent_run = new_run;
+	to_grow->indent_run_len = new_len;
+
+	return 0;
+}
+
+/*
+ * Choose how each indentation depth is written, eg. as one tab,
+ * or as a number of spaces. Applies from the next line that is started.
+ * to_style:	contains the indentation settings to change
+ * indent_char:	the character to repeat
+ * width:	the number of times to repeat the character per depth
+ * returns	0 iff successful;
+ *		-1 if rebuilding the indentation run failed,
+ *		   which will set errno.
+ *		   The old style is kept.
+ */
+static inline int line_gen_set_indent(struct line_gen *to_style,
+				      char indent_char, size_t width)
+{
+	char *old_run = to_style->indent_run;
+	size_t old_run_len = to_style->indent_run_len;
+	char old_char = to_style->indent_char;
+	size_t old_width = to_style->indent_width;
+
+	to_style->indent_char = indent_char;
+	to_style->indent_width = width;
+	to_style->indent_run = NULL;
+	to_style->indent_run_len = 0;
+	if (line_gen_cover_indent(to_style, to_style->indent)) {
+		to_style->indent_char = old_char;
+		to_style->indent_width = old_width;
+		to_style->indent_run = old_run;
+		to_style->indent_run_len = old_run_len;
+		return -1;
+	}
+	free(old_run);
 
-	to_close->out_stream = NULL;
-	return fclose(stream_to_close);
+	return 0;
 }
 
 /*
@@ -108,17 +1049,16 @@ static inline int try_start_line(struct line_gen *to_write)
 {
 	if (to_write->on_new_line) {
 		if (to_write->indent) {
-			char tab_buf[to_write->indent];
-			size_t written;
-
-			memset(tab_buf, INDENT_CHAR, to_write->indent);
-			written = fwrite(tab_buf, to_write->indent, 1,
-					 to_write->out_stream);
-			if (written == 0) {
+			if (line_gen_append(to_write, to_write->indent_run,
+					    to_write->indent *
+					    to_write->indent_width)) {
 				printlg(DEBUG_LEVEL,
 					"Could not indent: %d.\n", errno);
 				return -1;
 			}
+			LINE_GEN_COUNT(to_write, n_indent_bytes,
+				       to_write->indent *
+				       to_write->indent_width);
 		}
 		to_write->on_new_line = 0;
 	}
@@ -137,13 +1077,12 @@ static inline int try_start_line(struct line_gen *to_write)
  */
 static inline int finish_line(struct line_gen *to_write)
 {
-	size_t written = fwrite(LINE_BREAK_STR, LINE_BREAK_LEN, 1,
-				to_write->out_stream);
-	if (written == 0) {
+	if (line_gen_append(to_write, LINE_BREAK_STR, LINE_BREAK_LEN)) {
 		printlg(DEBUG_LEVEL, "Could break line.\n");
 		return -1;
 	}
 	to_write->on_new_line = 1;
+	LINE_GEN_COUNT(to_write, n_lines, 1);
 
 	return 0;
 }
@@ -157,7 +1096,8 @@ static inline int finish_line(struct line_gen *to_write)
  * without starting a new line.
  * to_indent:	contains the stream to indent
  * returns	0 iff successfully broke the current line, and started the next;
- *		-1 if writing the new line was necessary, but failed.
+ *		-1 if writing the new line was necessary, but failed,
+ *		   or growing the indentation run failed.
  *		   Indentation stays the same.
  *		-2 if the indentation depth was at the maximum,
  *		   so that indentation cannot be increased.
@@ -170,7 +1110,11 @@ static inline int indent(struct line_gen *to_indent)
 		printlg(DEBUG_LEVEL, "Indentation would exceed maximum of "
 				       "%u.\n",
 			(unsigned) to_indent->max_indent);
-		return -2;
+		return line_gen_fail(to_indent, -2);
+	}
+	if (line_gen_cover_indent(to_indent, to_indent->indent + 1)) {
+		printlg(DEBUG_LEVEL, "Could not cover new indentation.\n");
+		return line_gen_fail(to_indent, -1);
 	}
 	if (!to_indent->on_new_line &&
 	    (finish_line_ret = finish_line(to_indent))) {
@@ -179,6 +1123,12 @@ static inline int indent(struct line_gen *to_indent)
 		return finish_line_ret;
 	}
 	to_indent->indent += 1;
+	LINE_GEN_COUNT(to_indent, n_indents, 1);
+#ifdef LINE_GEN_STATS
+	if (to_indent->indent > to_indent->stats.max_depth) {
+		to_indent->stats.max_depth = to_indent->indent;
+	}
+#endif
 
 	return 0;
 }
@@ -210,7 +1160,7 @@ static inline int less_indent(struct line_gen *to_unindent, size_t less)
 				       "is less than %u, "
 				       "by which we want to decrease it.\n",
 			(unsigned) to_unindent->indent, (unsigned) less);
-		return -2;
+		return line_gen_fail(to_unindent, -2);
 	}
 	if (!to_unindent->on_new_line &&
 	    (finish_line_ret = finish_line(to_unindent))) {
@@ -219,6 +1169,7 @@ static inline int less_indent(struct line_gen *to_unindent, size_t less)
 		return finish_line_ret;
 	}
 	to_unindent->indent -= less;
+	LINE_GEN_COUNT(to_unindent, n_unindents, 1);
 
 	return 0;
 }
@@ -240,26 +1191,188 @@ static inline int unindent(struct line_gen *to_unindent)
 }
 
 /*
- * Write raw text to the current line.
- * text:	the string to write, up to the 0 character
+ * Write raw text of a known length to the current line.
+ * text:	the text to write, which need not be 0-terminated
+ * len:		the number of characters in the text
  * to_write:	contains the stream to write the text to
  * returns	0 iff successfully wrote all bytes.
  *		-1 if failed to start a new line or write the text
  */
-static inline int line_gen_write(const char *text, struct line_gen *to_write)
+static inline int line_gen_write_len(const char *text, size_t len,
+				     struct line_gen *to_write)
 {
 	if (try_start_line(to_write)) {
 		printlg(DEBUG_LEVEL,
 			"Failed to indent before writing raw text.\n");
 		return -1;
 	}
-	if (fwrite(text, strlen(text), 1, to_write->out_stream) == 0) {
+	if (line_gen_append(to_write, text, len)) {
 		printlg(DEBUG_LEVEL, "Failed to write raw text.\n");
 		return -1;
 	}
 	return 0;
 }
 
+/*
+ * Write a string with a known length to the current line,
+ * eg. a constant wrapped in LINE_GEN_LIT, which is sized at compile time.
+ * text:	the string to write
+ * to_write:	contains the stream to write the text to
+ * returns	0 iff successfully wrote all bytes.
+ *		-1 if failed to start a new line or write the text
+ */
+static inline int line_gen_write_str(struct line_gen_str text,
+				     struct line_gen *to_write)
+{
+	return line_gen_write_len(text.str, text.len, to_write);
+}
+
+/*
+ * Write raw text to the current line.
+ * If the length of the text is already known,
+ * "line_gen_write_len" or "line_gen_write_str" avoid measuring it again.
+ * text:	the string to write, up to the 0 character
+ * to_write:	contains the stream to write the text to
+ * returns	0 iff successfully wrote all bytes.
+ *		-1 if failed to start a new line or write the text
+ */
+static inline int line_gen_write(const char *text, struct line_gen *to_write)
+{
+	return line_gen_write_len(text, strlen(text), to_write);
+}
+
+/*
+ * Write the concatenation of several strings to the current line,
+ * copying all of them into the staging buffer at once if they fit.
+ * This is a faster alternative to formats made only of "%s" conversions.
+ * to_write:	contains the stream to write the text to
+ * strs:	the strings to write, in order
+ * n_strs:	the number of strings in "strs"
+ * returns	0 iff successfully wrote all bytes.
+ *		-1 if failed to start a new line or write the text
+ */
+static inline int line_gen_writev(struct line_gen *to_write,
+				  const struct line_gen_str *strs,
+				  size_t n_strs)
+{
+	size_t total = 0;
+	size_t str_i;
+
+	if (try_start_line(to_write)) {
+		printlg(DEBUG_LEVEL,
+			"Failed to indent before writing strings.\n");
+		return -1;
+	}
+
+	for (str_i = 0; str_i < n_strs; str_i++) {
+		total += strs[str_i].len;
+	}
+	if (total <= to_write->buf_size - to_write->buf_used) {
+		char *dest = to_write->buf + to_write->buf_used;
+
+		for (str_i = 0; str_i < n_strs; str_i++) {
+			memcpy(dest, strs[str_i].str, strs[str_i].len);
+			dest += strs[str_i].len;
+		}
+		line_gen_track_col(to_write, to_write->buf + to_write->buf_used,
+				   total);
+		to_write->buf_used += total;
+		LINE_GEN_COUNT(to_write, n_bytes, total);
+		return 0;
+	}
+
+	for (str_i = 0; str_i < n_strs; str_i++) {
+		if (line_gen_append(to_write, strs[str_i].str,
+				    strs[str_i].len)) {
+			printlg(DEBUG_LEVEL, "Failed to write strings.\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Append formatted text to the output, without checking for a new line.
+ * The text is formatted directly into the staging buffer if it fits,
+ * and otherwise into a temporary buffer,
+ * which is written to the sink after draining the staging buffer,
+ * unless a checkpoint is held, in which case the staging buffer grows,
+ * or a hole holds the text back, in which case a new one is started.
+ * to_write:	contains the staging buffer and sink
+ * fmt:		the format of the text to write
+ * args:	the arguments to plug into the format
+ * returns	the number of bytes written, or -1 on error
+ */
+static inline int line_gen_vprintf(struct line_gen *to_write,
+				   const char *fmt, va_list args)
+{
+	size_t space = to_write->buf_size - to_write->buf_used;
+	char *dest = to_write->buf == NULL ? NULL :
+		     to_write->buf + to_write->buf_used;
+	va_list retry_args;
+	int ret;
+
+	va_copy(retry_args, args);
+	ret = vsnprintf(dest, space, fmt, args);
+	if (ret >= 0 && (size_t) ret >= space) {
+		/* did not fit, so retry after making room */
+		if (to_write->n_checkpoints > 0) {
+			if (line_gen_grow(to_write, ret + 1)) {
+				ret = -1;
+			} else {
+				ret = vsnprintf(to_write->buf +
+						to_write->buf_used,
+						to_write->buf_size -
+						to_write->buf_used,
+						fmt, retry_args);
+			}
+		} else if (line_gen_drain(to_write)) {
+			ret = -1;
+		} else if (to_write->holes != NULL) {
+			if (line_gen_detach_chunk(to_write, ret + 1)) {
+				ret = -1;
+			} else {
+				ret = vsnprintf(to_write->buf +
+						to_write->buf_used,
+						to_write->buf_size -
+						to_write->buf_used,
+						fmt, retry_args);
+			}
+		} else if ((size_t) ret < to_write->buf_size -
+					  to_write->buf_used) {
+			ret = vsnprintf(to_write->buf + to_write->buf_used,
+					to_write->buf_size - to_write->buf_used,
+					fmt, retry_args);
+		} else {
+			char *tmp = malloc(ret + 1);
+
+			if (tmp == NULL ||
+			    vsnprintf(tmp, ret + 1, fmt, retry_args) != ret) {
+				printlg(DEBUG_LEVEL,
+					"Could not format text past buffer.\n");
+				ret = line_gen_fail(to_write, -1);
+			} else if (line_gen_write_through(to_write, tmp, ret)) {
+				ret = -1;
+			}
+			free(tmp);
+			va_end(retry_args);
+			return ret;
+		}
+	}
+	va_end(retry_args);
+	if (ret < 0) {
+		line_gen_fail(to_write, -1);
+	} else if (ret > 0) {
+		line_gen_track_col(to_write, to_write->buf + to_write->buf_used,
+				   ret);
+		to_write->buf_used += ret;
+		LINE_GEN_COUNT(to_write, n_bytes, ret);
+	}
+
+	return ret;
+}
+
 /*
  * Write formatted text to the current line.
  * to_write:	contains the stream to write the text to
@@ -282,9 +1395,44 @@ static inline int line_gen_printf(struct line_gen *to_write,
 	}
 
 	va_start(args, fmt);
-	ret = vfprintf(to_write->out_stream, fmt, args);
+	ret = line_gen_vprintf(to_write, fmt, args);
 	va_end(args);
 
 	return ret;
 }
+#ifdef LINE_GEN_STATS
+/*
+ * Write the counters of a "struct line_gen" as tab-separated lines
+ * of a name and a value, eg. for a dashboard to collect.
+ * "bytes_per_sink_write" shows generators that make many small writes.
+ * The counters are kept after "close_line_gen", so they can be dumped then.
+ * to_dump:	the struct whose counters to write
+ * out:		the stream to write them to
+ * returns	0 iff successful, -1 if writing to "out" failed
+ */
+static inline int line_gen_stats_dump(const struct line_gen *to_dump,
+				      FILE *out)
+{
+	const struct line_gen_stats *stats = &to_dump->stats;
+	int ret;
+
+	ret = fprintf(out, "lines\t%lu\nbytes\t%lu\nindent_bytes\t%lu\n"
+		      "indents\t%lu\nunindents\t%lu\nmax_depth\t%lu\n"
+		      "sink_writes\t%lu\nsink_flushes\t%lu\nsink_ns\t%llu\n"
+		      "bytes_per_sink_write\t%.1f\n",
+		      (unsigned long) stats->n_lines,
+		      (unsigned long) stats->n_bytes,
+		      (unsigned long) stats->n_indent_bytes,
+		      (unsigned long) stats->n_indents,
+		      (unsigned long) stats->n_unindents,
+		      (unsigned long) stats->max_depth,
+		      (unsigned long) stats->n_sink_writes,
+		      (unsigned long) stats->n_sink_flushes, stats->sink_ns,
+		      stats->n_sink_writes ?
+		      (double) stats->n_bytes / stats->n_sink_writes : 0.0);
+
+	return ret < 0 ? -1 : 0;
+}
+#endif /* LINE_GEN_STATS */
+#pragma pop_macro("LOG_THRESHOLD")
 #endif /* FORMAT_GEN_H */
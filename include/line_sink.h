@@ -0,0 +1,223 @@
+/*
+ * Output sinks, to which "struct line_gen" hands its formatted text.
+ * A sink is a small table of operations plus the state they work on,
+ * so the same generator code can write to a FILE stream, a raw file
+ * descriptor, a growable memory buffer, or nowhere at all.
+ */
+#ifndef LINE_SINK_H
+#define LINE_SINK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+struct line_sink;
+
+/*
+ * a growable memory buffer
+ */
+struct line_sink_buf {
+	/* the written bytes */
+	char *data;
+	/* the number of written bytes */
+	size_t len;
+	/* the capacity of "data" */
+	size_t cap;
+};
+
+/*
+ * the outcome of writing a file with "line_sink_if_changed",
+ * set when the sink is closed or aborted
+ */
+struct line_sink_update {
+	/*
+	 * 1 iff the file was replaced, 0 if it was left untouched,
+	 * as it always is when the sink is aborted
+	 */
+	int changed;
+	/* the 64-bit FNV-1a hash of the generated bytes */
+	unsigned long long hash;
+};
+
+/*
+ * the operations of a sink.
+ * All of them return 0 iff successful, and -1 on error, with errno set.
+ */
+struct line_sink_ops {
+	/*
+	 * Write all of the bytes, in order, after any written before.
+	 * sink:	the sink to write to
+	 * bytes:	the bytes to write
+	 * len:		the number of bytes to write
+	 */
+	int (*write)(struct line_sink *sink, const char *bytes, size_t len);
+	/*
+	 * Push written bytes past any buffering inside the sink.
+	 * sink:	the sink to flush
+	 */
+	int (*flush)(struct line_sink *sink);
+	/*
+	 * Release the resources behind the sink.
+	 * It will not be written to again.
+	 * sink:	the sink to close
+	 */
+	int (*close)(struct line_sink *sink);
+	/*
+	 * Release the resources behind the sink like "close",
+	 * but discard the bytes that it has not made permanent yet,
+	 * as when generating them failed.
+	 * It may be NULL, for sinks that have nothing to discard,
+	 * in which case "close" is used instead.
+	 * sink:	the sink to abort
+	 */
+	int (*abort)(struct line_sink *sink);
+};
+
+/*
+ * an output sink: the operations, and the state they work on
+ */
+struct line_sink {
+	/* the operations on "state" */
+	const struct line_sink_ops *ops;
+	/* the state of the sink, of which the member depends on "ops" */
+	union {
+		/* the stream of a FILE sink */
+		FILE *stream;
+		/* the descriptor of a raw file descriptor sink */
+		int fd;
+		/* a growable memory buffer */
+		struct line_sink_buf mem;
+		/* a file that is only replaced if its contents change */
+		struct {
+			/* the generated bytes */
+			struct line_sink_buf buf;
+			/* the running hash of "buf" */
+			unsigned long long hash;
+			/* the path of the file, owned by the sink */
+			char *path;
+			/* where to report the outcome, or NULL */
+			struct line_sink_update *update;
+		} changed;
+		/* a file written through a shared memory mapping */
+		struct {
+			/* the descriptor of the mapped file */
+			int fd;
+			/* the start of the mapping */
+			char *map;
+			/* the number of written bytes */
+			size_t len;
+			/* the size of the mapping, and of the file */
+			size_t cap;
+		} map;
+		/* the number of bytes a null sink has discarded */
+		size_t count;
+		/* the state of a sink defined outside of this library */
+		void *ctx;
+	} state;
+};
+
+/*
+ * Make a sink that writes to a FILE stream, and closes it with fclose.
+ * sink:	the sink to initialize
+ * stream:	the stream to write to
+ */
+void line_sink_stdio(struct line_sink *sink, FILE *stream);
+
+/*
+ * Make a sink that writes to a raw POSIX file descriptor,
+ * and closes it with close.
+ * sink:	the sink to initialize
+ * fd:		the file descriptor to write to
+ */
+void line_sink_fd(struct line_sink *sink, int fd);
+
+/*
+ * Make a sink that collects the bytes in a growable memory buffer.
+ * Closing the sink keeps the buffer,
+ * which can then be read with "line_sink_mem_data",
+ * and must be released with "line_sink_mem_take" or "line_sink_mem_free".
+ * sink:	the sink to initialize
+ * cap:		the initial capacity of the buffer, which can be 0
+ * returns	0 iff successful;
+ *		-1 if allocating the buffer failed, which will set errno
+ */
+int line_sink_mem(struct line_sink *sink, size_t cap);
+
+/*
+ * Look at the bytes collected by a memory sink, without copying them.
+ * The pointer is valid until the sink is written to again, or released.
+ * sink:	the memory sink
+ * len:		set to the number of bytes collected
+ * returns	the collected bytes, or NULL if there are none
+ */
+static inline const char *line_sink_mem_data(const struct line_sink *sink,
+					     size_t *len)
+{
+	*len = sink->state.mem.len;
+	return sink->state.mem.data;
+}
+
+/*
+ * Take ownership of the bytes collected by a memory sink,
+ * leaving the sink empty.
+ * sink:	the memory sink
+ * len:		set to the number of bytes collected
+ * returns	the collected bytes, to be released with free,
+ *		or NULL if there are none
+ */
+char *line_sink_mem_take(struct line_sink *sink, size_t *len);
+
+/*
+ * Release the bytes collected by a memory sink.
+ * sink:	the memory sink
+ */
+void line_sink_mem_free(struct line_sink *sink);
+
+/*
+ * Make a sink that writes straight into a shared memory mapping of a file.
+ * The file is created, or truncated, and preallocated to the size hint,
+ * and both are grown geometrically when the written bytes exceed it.
+ * Closing the sink truncates the file to the number of bytes written.
+ * sink:	the sink to initialize
+ * path:	the path of the file to write
+ * size_hint:	the expected size of the output, or 0 if unknown
+ * returns	0 iff successful;
+ *		-1 if opening, preallocating or mapping the file failed,
+ *		   which will set errno
+ */
+int line_sink_mmap(struct line_sink *sink, const char *path, size_t size_hint);
+
+/*
+ * Make a sink that only writes a file if its contents change,
+ * so that its modification time is kept otherwise.
+ * The bytes are collected in memory, and hashed as they are written.
+ * Closing the sink compares them with the existing file,
+ * by size first, and then by contents,
+ * and if they differ, writes them to a temporary file in the same folder,
+ * and renames it over the existing one, so that it is replaced atomically.
+ * Aborting the sink leaves the existing file untouched.
+ * sink:	the sink to initialize
+ * path:	the path of the file to write
+ * update:	where to report the outcome when the sink is closed, or NULL
+ * returns	0 iff successful;
+ *		-1 if allocating the sink failed, which will set errno
+ */
+int line_sink_if_changed(struct line_sink *sink, const char *path,
+			 struct line_sink_update *update);
+
+/*
+ * Make a sink that discards the bytes, and only counts them.
+ * sink:	the sink to initialize
+ */
+void line_sink_null(struct line_sink *sink);
+
+/*
+ * Get the number of bytes a null sink has discarded.
+ * sink:	the null sink
+ * returns	the number of bytes written to the sink
+ */
+static inline size_t line_sink_null_count(const struct line_sink *sink)
+{
+	return sink->state.count;
+}
+
+#endif /* LINE_SINK_H */
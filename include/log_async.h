@@ -0,0 +1,71 @@
+/*
+ * An asynchronous backend for logger.h, used when LOG_ASYNC is defined.
+ * Each logging thread formats its messages into its own ring buffer,
+ * without taking any lock,
+ * and a background thread writes the rings out to their streams.
+ * Messages from one thread keep their order,
+ * but messages from different threads may be interleaved in any order.
+ */
+#ifndef LOG_ASYNC_H
+#define LOG_ASYNC_H
+
+#include <stdio.h>
+#include <stdarg.h>
+
+/* the number of messages each thread's ring buffer holds */
+#define LOG_ASYNC_SLOTS		256
+/*
+ * the largest formatted message, including its tag,
+ * past which messages are cut short
+ */
+#define LOG_ASYNC_TEXT_SIZE	256
+/*
+ * the largest number of ring buffers,
+ * which bounds the memory used at about
+ * LOG_ASYNC_MAX_RINGS * LOG_ASYNC_SLOTS * LOG_ASYNC_TEXT_SIZE bytes.
+ * Rings of exited threads are reused,
+ * and threads without a ring log synchronously.
+ */
+#define LOG_ASYNC_MAX_RINGS	64
+
+/* what a thread does when its ring buffer is full */
+enum log_async_policy {
+	LOG_ASYNC_BLOCK = 0, /* wait for the background thread to make room */
+	LOG_ASYNC_DROP = 1 /* discard the message, and count it as dropped */
+};
+
+/*
+ * Choose what threads do when their ring buffers are full.
+ * The default is LOG_ASYNC_BLOCK.
+ * policy:	the policy for all threads
+ */
+void log_async_set_policy(enum log_async_policy policy);
+
+/*
+ * Queue a tagged message for the background thread,
+ * starting it first if needed.
+ * Messages at FATAL_LEVEL are flushed before returning.
+ * If the background thread cannot run, the message is written directly.
+ * stream:	the stream to which to write the message
+ * level:	the log level, which determines how to tag the message
+ * sep:		the text between the tag and the message
+ * fmt:		the format of the message, following printf semantics
+ * args:	the values to plug into the format
+ */
+void log_async_vwrite(FILE *stream, int level, const char *sep,
+		      const char *fmt, va_list args);
+
+/*
+ * Wait until every message queued so far has been written,
+ * and its stream flushed.
+ * This is also done when the program exits.
+ */
+void log_async_flush(void);
+
+/*
+ * Get the number of messages discarded under LOG_ASYNC_DROP
+ * returns	the number of discarded messages since the program started
+ */
+size_t log_async_dropped(void);
+
+#endif /* LOG_ASYNC_H */
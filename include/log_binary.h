@@ -0,0 +1,101 @@
+/*
+ * A binary backend for logger.h, used when LOG_BINARY is defined.
+ * Instead of formatting its message, a log statement records
+ * the ID of its call site, a timestamp, and the raw values of its arguments.
+ * Each call site is described once in the stream,
+ * by its level, file, line and format string,
+ * and "log_binary_decode" renders the stream as the usual text offline.
+ * Events are collected in a buffer per thread,
+ * which is written to the stream when full, when the thread exits,
+ * after FATAL_LEVEL events, and by "log_binary_flush".
+ */
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* the stream written to if "log_binary_open" is not called first */
+#ifndef LOG_BINARY_PATH
+#define LOG_BINARY_PATH		"log.bin"
+#endif
+/* the largest number of arguments recorded per event */
+#define LOG_BINARY_MAX_ARGS	16
+/* the largest number of characters recorded per string argument */
+#define LOG_BINARY_MAX_STR	1024
+/* the size of the buffer of each thread */
+#define LOG_BINARY_BUF_SIZE	(64 * 1024)
+
+/*
+ * a log statement, of which there is one static instance per call site
+ */
+struct log_site {
+	const char *fmt; /* the format of the message */
+	const char *sep; /* the text between the tag and the message */
+	const char *file; /* the source file of the statement */
+	int line; /* the line of the statement */
+	int level; /* the log level of the statement */
+	/* the stream in which the site was last described, or 0 if none */
+	_Atomic unsigned gen;
+	unsigned id; /* the ID of the site in the stream */
+	/* the number of values in "kinds" */
+	unsigned char n_args;
+	/* how to record each argument, as parsed from "fmt" */
+	unsigned char kinds[LOG_BINARY_MAX_ARGS];
+	/* the most characters recorded of each string argument */
+	unsigned short precs[LOG_BINARY_MAX_ARGS];
+};
+
+/*
+ * the initializer of the "struct log_site" of a statement
+ * site_level:	the log level of the statement
+ * site_sep:	the text between the tag and the message
+ * site_fmt:	the format of the message, a string literal
+ */
+#define LOG_SITE(site_level, site_sep, site_fmt) { \
+	.fmt = site_fmt, .sep = site_sep, .file = __FILE__, \
+	.line = __LINE__, .level = site_level \
+}
+
+/*
+ * Start writing events to a new stream,
+ * after flushing the calling thread's events to the previous one
+ * path:	the path of the file to truncate and write to
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+int log_binary_open(const char *path);
+
+/*
+ * Flush the calling thread's events, and close the stream.
+ * Later events are discarded until "log_binary_open" is called.
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+int log_binary_close(void);
+
+/*
+ * Record an event, describing its call site first if needed
+ * site:	the call site of the event
+ * ...:		the values to plug into the format of the site
+ */
+void log_binary_write(struct log_site *site, ...);
+
+/*
+ * Write the calling thread's buffered events to the stream
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+int log_binary_flush(void);
+
+/*
+ * Render a binary log stream as text,
+ * with each event as "[TAG]: message", as printlg would have written it
+ * in:		the binary log to read
+ * out:		where to write the text
+ * timestamps:	nonzero to start each line with the timestamp of its event,
+ *		relative to the first event, in ticks of the time stamp counter
+ *		where available, or otherwise nanoseconds
+ * returns	0 iff successful, -1 if the stream could not be read
+ *		or is malformed
+ */
+int log_binary_decode(FILE *in, FILE *out, int timestamps);
+
+#endif /* LOG_BINARY_H */
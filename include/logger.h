@@ -8,6 +8,16 @@
 #include <stdarg.h>
 #include <debug_assert.h>
 
+#if defined(LOG_ASYNC) && defined(LOG_BINARY)
+#error "LOG_ASYNC and LOG_BINARY cannot both be defined"
+#endif
+#ifdef LOG_ASYNC
+#include <log_async.h>
+#endif
+#ifdef LOG_BINARY
+#include <log_binary.h>
+#endif
+
 /*
  * logging levels, as represented numerically.
  * Higher values are more severe.
@@ -69,39 +79,90 @@ static inline const char *getTag(size_t level)
 }
 
 /*
- * Print debug tag and current file name and line number,
- * if the level meets the minimum DISP_LEVEL
+ * The minimum level of the log statements that are compiled in.
+ * Statements below it expand to an "if" on a constant that is false,
+ * which the compiler removes as dead code, along with their arguments,
+ * which are never evaluated, but are still type-checked.
+ * Each module sets this to its own threshold, such as LINE_GEN_LOG_LEVEL,
+ * so that its statements can be removed without touching the others',
+ * and a level of N_LEVELS removes every statement of a module.
  */
-#define TAG_LOCATION(level) do { \
-	if (level >= DISP_LEVEL) { \
-		fprintf(LOG_FILE, "[%s] File %s, Line %d\n", getTag(level), \
-			__FILE__, __LINE__); \
+#ifndef LOG_THRESHOLD
+#define LOG_THRESHOLD	DISP_LEVEL
+#endif
+
+#ifdef LOG_BINARY
+/*
+ * Records a message in the binary log, whatever its level,
+ * as declared in log_binary.h.
+ * The format must be a string literal,
+ * and is only checked against the values at compile time.
+ * level:	the log level, which determines how to tag the message
+ * sep:		the text between the tag and the message
+ * fmt:		the format of the message to output,
+ *		following printf semantics
+ * ...:	the values to plug into the format
+ */
+#define log_message(level, sep, fmt, ...) do { \
+	static struct log_site log_site_ = LOG_SITE(level, sep, fmt); \
+	if (0) { \
+		printf(fmt, ##__VA_ARGS__); \
 	} \
+	log_binary_write(&log_site_, ##__VA_ARGS__); \
 } while (0)
-
+#else
 /*
- * Writes to log if specified level meets the minimum DISP_LEVEL
- * level:	the log level,
- *		which determines if the message should even be logged,
- *		and how to tag the message
+ * Writes a tagged message to the log, whatever its level.
+ * If LOG_ASYNC is defined, the message is queued for a background thread
+ * to write, as declared in log_async.h.
+ * level:	the log level, which determines how to tag the message
+ * sep:		the text between the tag and the message
  * fmt:		the format of the message to output,
  *		following printf semantics
  * ...:	the values to plug into the format
  */
-__attribute__((format(printf, 2, 3)))
-static inline void printlg(enum log_level level, char *fmt, ...)
+__attribute__((format(printf, 3, 4)))
+static inline void log_message(enum log_level level, const char *sep,
+			       const char *fmt, ...)
 {
-#pragma GCC diagnostic ignored "-Wtype-limits"
-	if (level >= DISP_LEVEL) {
-#pragma GCC diagnostic warning "-Wtype-limits"
-		va_list args;
+	va_list args;
 
-		fprintf(LOG_FILE, "[%s]: ", getTag(level));
-
-		va_start(args, fmt);
-		vfprintf(LOG_FILE, fmt, args);
-		va_end(args);
-	}
+	va_start(args, fmt);
+#ifdef LOG_ASYNC
+	log_async_vwrite(LOG_FILE, level, sep, fmt, args);
+#else
+	fprintf(LOG_FILE, "[%s]%s", getTag(level), sep);
+	vfprintf(LOG_FILE, fmt, args);
+#endif
+	va_end(args);
 }
+#endif /* LOG_BINARY */
+
+/*
+ * Print debug tag and current file name and line number,
+ * if the level meets the minimum LOG_THRESHOLD
+ */
+#define TAG_LOCATION(level) do { \
+	if ((level) >= LOG_THRESHOLD) { \
+		log_message(level, " ", "File %s, Line %d\n", __FILE__, \
+			    __LINE__); \
+	} \
+} while (0)
+
+/*
+ * Writes to log if specified level meets the minimum LOG_THRESHOLD,
+ * and compiles to nothing otherwise, as long as the level is a constant
+ * level:	the log level,
+ *		which determines if the message should even be logged,
+ *		and how to tag the message
+ * ...:		the format of the message to output,
+ *		following printf semantics,
+ *		and the values to plug into the format
+ */
+#define printlg(level, ...) do { \
+	if ((level) >= LOG_THRESHOLD) { \
+		log_message(level, ": ", __VA_ARGS__); \
+	} \
+} while (0)
 
 #endif /* LOGGER_H */
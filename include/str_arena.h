@@ -0,0 +1,251 @@
+/*
+ * A bump allocator for the short strings that go into generated statements,
+ * such as the conditions of "start_if" and "start_for",
+ * and a builder that composes them in place,
+ * so that they need not be allocated and freed one by one.
+ * Strings stay valid until the arena is reset, eg. between functions,
+ * after which the arena reuses its memory, so that a generation loop
+ * stops allocating once the arena has grown to fit one function.
+ */
+#ifndef STR_ARENA_H
+#define STR_ARENA_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* the size of the first block of an arena */
+#ifndef STR_ARENA_BLOCK_SIZE
+#define STR_ARENA_BLOCK_SIZE	(16 * 1024)
+#endif
+
+/* a block of memory of an arena */
+struct str_arena_block {
+	struct str_arena_block *next; /* the block filled before this one */
+	size_t size; /* the number of bytes of "data" */
+	char data[];
+};
+
+/*
+ * an arena, which allocates strings from the end of its newest block
+ */
+struct str_arena {
+	/* the block being filled, or NULL if none is allocated yet */
+	struct str_arena_block *block;
+	/* the number of bytes used in "block" */
+	size_t used;
+	/* the total size of all blocks */
+	size_t total;
+};
+
+/*
+ * a string being built at the end of an arena.
+ * Only one string can be built in an arena at a time,
+ * though finished strings can be appended to the one being built.
+ */
+struct str_builder {
+	/* the arena to build the string in */
+	struct str_arena *arena;
+	/* the offset of the string in the arena's current block */
+	size_t start;
+	/* nonzero once appending failed, after which appending does nothing */
+	int failed;
+};
+
+/*
+ * Initialize an empty arena, which allocates nothing until it is used
+ * to_init:	the arena to initialize
+ */
+static inline void str_arena_init(struct str_arena *to_init)
+{
+	to_init->block = NULL;
+	to_init->used = 0;
+	to_init->total = 0;
+}
+
+/*
+ * Release all of the memory of an arena, leaving it empty
+ * to_free:	the arena to release
+ */
+void str_arena_free(struct str_arena *to_free);
+
+/*
+ * Invalidate every string in an arena, so that its memory is reused.
+ * If the arena spans several blocks, they are replaced by one block
+ * of their total size, so that as many strings fit without growing again.
+ * to_reset:	the arena to reset
+ */
+void str_arena_reset(struct str_arena *to_reset);
+
+/*
+ * Start a new block for an arena, which is big enough for
+ * the string being built, moved to its start, and the given number of bytes.
+ * Called by "str_build_append" when the current block is full.
+ * to_grow:	the arena to grow
+ * start:	the offset of the string being built, which is updated
+ * len:		the number of bytes to make room for after the string
+ * returns	0 iff successful;
+ *		-1 if allocating failed, which will set errno
+ */
+int str_arena_grow(struct str_arena *to_grow, size_t *start, size_t len);
+
+/*
+ * Start building a string at the end of an arena
+ * builder:	the builder to initialize
+ * arena:	the arena to build the string in
+ */
+static inline void str_build_start(struct str_builder *builder,
+				   struct str_arena *arena)
+{
+	builder->arena = arena;
+	builder->start = arena->used;
+	builder->failed = 0;
+}
+
+/*
+ * Append bytes to the string being built, growing the arena if needed
+ * builder:	the builder of the string
+ * bytes:	the bytes to append
+ * len:		the number of bytes to append
+ * returns	0 iff successful;
+ *		-1 if allocating failed, which will set errno,
+ *		   or an earlier call failed
+ */
+static inline int str_build_append(struct str_builder *builder,
+				   const char *bytes, size_t len)
+{
+	struct str_arena *arena = builder->arena;
+
+	if (builder->failed) {
+		return -1;
+	}
+	/* always leave room for the terminating null character */
+	if (arena->block == NULL || arena->block->size - arena->used <= len) {
+		if (str_arena_grow(arena, &builder->start, len + 1)) {
+			builder->failed = 1;
+			return -1;
+		}
+	}
+	memcpy(arena->block->data + arena->used, bytes, len);
+	arena->used += len;
+
+	return 0;
+}
+
+/* append a string literal, sized at compile time */
+#define str_build_lit(builder, lit)	\
+	str_build_append(builder, lit, sizeof(lit) - 1)
+
+/*
+ * Append a 0-terminated string to the string being built
+ * builder:	the builder of the string
+ * str:		the string to append
+ * returns	0 iff successful, -1 otherwise, as by "str_build_append"
+ */
+static inline int str_build_str(struct str_builder *builder, const char *str)
+{
+	return str_build_append(builder, str, strlen(str));
+}
+
+/*
+ * Append a C identifier to the string being built,
+ * after checking that it is one
+ * builder:	the builder of the string
+ * name:	the identifier to append
+ * returns	0 iff successful;
+ *		-1 if "name" is not a valid identifier, which sets errno
+ *		   to EINVAL, or appending failed, as by "str_build_append"
+ */
+static inline int str_build_ident(struct str_builder *builder,
+				  const char *name)
+{
+	size_t len;
+
+	for (len = 0; name[len] != '\0'; len++) {
+		char c = name[len];
+
+		if (!(c == '_' || (c >= 'a' && c <= 'z') ||
+		      (c >= 'A' && c <= 'Z') ||
+		      (len > 0 && c >= '0' && c <= '9'))) {
+			break;
+		}
+	}
+	if (len == 0 || name[len] != '\0') {
+		errno = EINVAL;
+		builder->failed = 1;
+		return -1;
+	}
+
+	return str_build_append(builder, name, len);
+}
+
+/*
+ * Append an unsigned integer in decimal to the string being built
+ * builder:	the builder of the string
+ * value:	the integer to append
+ * returns	0 iff successful, -1 otherwise, as by "str_build_append"
+ */
+static inline int str_build_uint(struct str_builder *builder,
+				 unsigned long long value)
+{
+	/* enough for the decimal digits of a 64-bit integer */
+	char digits[20];
+	size_t pos = sizeof(digits);
+
+	do {
+		digits[--pos] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	return str_build_append(builder, digits + pos, sizeof(digits) - pos);
+}
+
+/*
+ * Append a signed integer in decimal to the string being built
+ * builder:	the builder of the string
+ * value:	the integer to append
+ * returns	0 iff successful, -1 otherwise, as by "str_build_append"
+ */
+static inline int str_build_int(struct str_builder *builder, long long value)
+{
+	if (value < 0) {
+		str_build_lit(builder, "-");
+		/* negated as unsigned, so that the smallest value fits */
+		return str_build_uint(builder, -(unsigned long long) value);
+	}
+
+	return str_build_uint(builder, value);
+}
+
+/*
+ * Append a subexpression in parentheses to the string being built,
+ * eg. one finished earlier by another builder on the same arena
+ * builder:	the builder of the string
+ * expr:	the subexpression to append
+ * returns	0 iff successful, -1 otherwise, as by "str_build_append"
+ */
+static inline int str_build_sub(struct str_builder *builder, const char *expr)
+{
+	str_build_lit(builder, "(");
+	str_build_str(builder, expr);
+	return str_build_lit(builder, ")");
+}
+
+/*
+ * Finish building a string, by terminating it with a null character
+ * builder:	the builder of the string
+ * returns	the string, which stays valid until the arena is reset,
+ *		or NULL if any call to append to it failed, with errno set
+ */
+static inline char *str_build_finish(struct str_builder *builder)
+{
+	struct str_arena *arena = builder->arena;
+
+	if (str_build_append(builder, "", 1)) {
+		return NULL;
+	}
+
+	return arena->block->data + builder->start;
+}
+
+#endif /* STR_ARENA_H */
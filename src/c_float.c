@@ -0,0 +1,614 @@
+/*
+ * Floating point literals with the fewest digits that read back
+ * as the same value, found with Grisu3, as described in
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers"
+ * by Florian Loitsch.
+ * Grisu3 gives up on about 0.5% of doubles, for which the digits are
+ * found by trying every precision of printf instead.
+ */
+#include <c_gen.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/* the literals of the values that are not finite, from math.h */
+#define INFINITY_STR	"INFINITY"
+#define NAN_STR		"NAN"
+/* zero, which needs a decimal point to not be an integer */
+#define ZERO_STR	"0.0"
+/* the suffix of float literals */
+#define FLOAT_SUFFIX	'f'
+
+/* the most significant digits that tell apart every float and double */
+#define FLOAT_MAX_DIGITS	9
+#define DOUBLE_MAX_DIGITS	17
+
+/* the smallest binary exponent of the scaled value, as by Grisu */
+#define MIN_TARGET_EXP	(-60)
+
+/* the first decimal exponent in "cached_powers", and the step between them */
+#define CACHED_POWERS_OFFSET	348
+#define CACHED_POWERS_STEP	8
+/* 1 / log2(10) */
+#define INV_LOG2_10	0.30102999566398114
+
+/*
+ * a floating point number as an integer significand and binary exponent,
+ * whose value is f * 2^e
+ */
+struct diy_fp {
+	uint64_t f;
+	int e;
+};
+
+/* a power of ten, rounded to a 64-bit significand */
+struct cached_power {
+	uint64_t f; /* the significand, with its top bit set */
+	int e; /* the binary exponent */
+	int dec_exp; /* the decimal exponent */
+};
+
+/* every eighth power of ten that Grisu may scale a double by */
+static const struct cached_power cached_powers[] = {
+	{0xfa8fd5a0081c0288ULL, -1220, -348},
+	{0xbaaee17fa23ebf76ULL, -1193, -340},
+	{0x8b16fb203055ac76ULL, -1166, -332},
+	{0xcf42894a5dce35eaULL, -1140, -324},
+	{0x9a6bb0aa55653b2dULL, -1113, -316},
+	{0xe61acf033d1a45dfULL, -1087, -308},
+	{0xab70fe17c79ac6caULL, -1060, -300},
+	{0xff77b1fcbebcdc4fULL, -1034, -292},
+	{0xbe5691ef416bd60cULL, -1007, -284},
+	{0x8dd01fad907ffc3cULL, -980, -276},
+	{0xd3515c2831559a83ULL, -954, -268},
+	{0x9d71ac8fada6c9b5ULL, -927, -260},
+	{0xea9c227723ee8bcbULL, -901, -252},
+	{0xaecc49914078536dULL, -874, -244},
+	{0x823c12795db6ce57ULL, -847, -236},
+	{0xc21094364dfb5637ULL, -821, -228},
+	{0x9096ea6f3848984fULL, -794, -220},
+	{0xd77485cb25823ac7ULL, -768, -212},
+	{0xa086cfcd97bf97f4ULL, -741, -204},
+	{0xef340a98172aace5ULL, -715, -196},
+	{0xb23867fb2a35b28eULL, -688, -188},
+	{0x84c8d4dfd2c63f3bULL, -661, -180},
+	{0xc5dd44271ad3cdbaULL, -635, -172},
+	{0x936b9fcebb25c996ULL, -608, -164},
+	{0xdbac6c247d62a584ULL, -582, -156},
+	{0xa3ab66580d5fdaf6ULL, -555, -148},
+	{0xf3e2f893dec3f126ULL, -529, -140},
+	{0xb5b5ada8aaff80b8ULL, -502, -132},
+	{0x87625f056c7c4a8bULL, -475, -124},
+	{0xc9bcff6034c13053ULL, -449, -116},
+	{0x964e858c91ba2655ULL, -422, -108},
+	{0xdff9772470297ebdULL, -396, -100},
+	{0xa6dfbd9fb8e5b88fULL, -369, -92},
+	{0xf8a95fcf88747d94ULL, -343, -84},
+	{0xb94470938fa89bcfULL, -316, -76},
+	{0x8a08f0f8bf0f156bULL, -289, -68},
+	{0xcdb02555653131b6ULL, -263, -60},
+	{0x993fe2c6d07b7facULL, -236, -52},
+	{0xe45c10c42a2b3b06ULL, -210, -44},
+	{0xaa242499697392d3ULL, -183, -36},
+	{0xfd87b5f28300ca0eULL, -157, -28},
+	{0xbce5086492111aebULL, -130, -20},
+	{0x8cbccc096f5088ccULL, -103, -12},
+	{0xd1b71758e219652cULL, -77, -4},
+	{0x9c40000000000000ULL, -50, 4},
+	{0xe8d4a51000000000ULL, -24, 12},
+	{0xad78ebc5ac620000ULL, 3, 20},
+	{0x813f3978f8940984ULL, 30, 28},
+	{0xc097ce7bc90715b3ULL, 56, 36},
+	{0x8f7e32ce7bea5c70ULL, 83, 44},
+	{0xd5d238a4abe98068ULL, 109, 52},
+	{0x9f4f2726179a2245ULL, 136, 60},
+	{0xed63a231d4c4fb27ULL, 162, 68},
+	{0xb0de65388cc8ada8ULL, 189, 76},
+	{0x83c7088e1aab65dbULL, 216, 84},
+	{0xc45d1df942711d9aULL, 242, 92},
+	{0x924d692ca61be758ULL, 269, 100},
+	{0xda01ee641a708deaULL, 295, 108},
+	{0xa26da3999aef774aULL, 322, 116},
+	{0xf209787bb47d6b85ULL, 348, 124},
+	{0xb454e4a179dd1877ULL, 375, 132},
+	{0x865b86925b9bc5c2ULL, 402, 140},
+	{0xc83553c5c8965d3dULL, 428, 148},
+	{0x952ab45cfa97a0b3ULL, 455, 156},
+	{0xde469fbd99a05fe3ULL, 481, 164},
+	{0xa59bc234db398c25ULL, 508, 172},
+	{0xf6c69a72a3989f5cULL, 534, 180},
+	{0xb7dcbf5354e9beceULL, 561, 188},
+	{0x88fcf317f22241e2ULL, 588, 196},
+	{0xcc20ce9bd35c78a5ULL, 614, 204},
+	{0x98165af37b2153dfULL, 641, 212},
+	{0xe2a0b5dc971f303aULL, 667, 220},
+	{0xa8d9d1535ce3b396ULL, 694, 228},
+	{0xfb9b7cd9a4a7443cULL, 720, 236},
+	{0xbb764c4ca7a44410ULL, 747, 244},
+	{0x8bab8eefb6409c1aULL, 774, 252},
+	{0xd01fef10a657842cULL, 800, 260},
+	{0x9b10a4e5e9913129ULL, 827, 268},
+	{0xe7109bfba19c0c9dULL, 853, 276},
+	{0xac2820d9623bf429ULL, 880, 284},
+	{0x80444b5e7aa7cf85ULL, 907, 292},
+	{0xbf21e44003acdd2dULL, 933, 300},
+	{0x8e679c2f5e44ff8fULL, 960, 308},
+	{0xd433179d9c8cb841ULL, 986, 316},
+	{0x9e19db92b4e31ba9ULL, 1013, 324},
+	{0xeb96bf6ebadf77d9ULL, 1039, 332},
+	{0xaf87023b9bf0ee6bULL, 1066, 340},
+};
+
+/* the powers of ten that fit in 32 bits */
+static const uint32_t small_powers[10] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+	1000000000
+};
+
+/*
+ * the bits of an IEEE 754 binary floating point format,
+ * that Grisu needs to find the neighbors of a value
+ */
+struct float_format {
+	int frac_bits; /* the number of explicit significand bits */
+	int exp_bias; /* the bias of the exponent, counting "frac_bits" */
+	int max_digits; /* the most significant digits of a value */
+};
+
+static const struct float_format float_format = {23, 127 + 23,
+						 FLOAT_MAX_DIGITS};
+static const struct float_format double_format = {52, 1023 + 52,
+						  DOUBLE_MAX_DIGITS};
+
+/*
+ * Shift a number left until the top bit of its significand is set
+ * to_shift:	the number, which must not be 0
+ * returns	the same value, normalized
+ */
+static inline struct diy_fp normalize(struct diy_fp to_shift)
+{
+	while (!(to_shift.f & 0xffc0000000000000ULL)) {
+		to_shift.f <<= 10;
+		to_shift.e -= 10;
+	}
+	while (!(to_shift.f & 0x8000000000000000ULL)) {
+		to_shift.f <<= 1;
+		to_shift.e--;
+	}
+
+	return to_shift;
+}
+
+/*
+ * Multiply two numbers, rounding the product to 64 bits
+ * x:		the first factor
+ * y:		the second factor
+ * returns	the product, exact to within half of its last bit
+ */
+static inline struct diy_fp multiply(struct diy_fp x, struct diy_fp y)
+{
+	uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+	uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t mid = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff);
+	struct diy_fp product;
+
+	/* round the bits that are cut off */
+	mid += 1U << 31;
+	product.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+	product.e = x.e + y.e + 64;
+
+	return product;
+}
+
+/*
+ * Remove the digits that are still too far from the value,
+ * and check that the result is the closest shortest digits
+ * buf:		the digits
+ * len:		the number of digits
+ * dist_high:	the distance from the value to the upper end of the interval
+ * unsafe:	the width of the interval, including imprecision
+ * rest:	the distance from the digits to the upper end of the interval
+ * ten_kappa:	the weight of the last digit
+ * unit:	the imprecision of the values
+ * returns	nonzero iff the digits are known to be correct
+ */
+static int round_weed(char *buf, int len, uint64_t dist_high, uint64_t unsafe,
+		      uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+{
+	uint64_t small_dist = dist_high - unit;
+	uint64_t big_dist = dist_high + unit;
+
+	while (rest < small_dist && unsafe - rest >= ten_kappa &&
+	       (rest + ten_kappa < small_dist ||
+		small_dist - rest >= rest + ten_kappa - small_dist)) {
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+	if (rest < big_dist && unsafe - rest >= ten_kappa &&
+	    (rest + ten_kappa < big_dist ||
+	     big_dist - rest > rest + ten_kappa - big_dist)) {
+		return 0;
+	}
+
+	return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+/*
+ * Generate the shortest digits in the interval around a scaled value
+ * low:		the lower end of the interval
+ * w:		the value
+ * high:	the upper end of the interval, with the exponent of "w"
+ * buf:		where to write the digits
+ * len:		where to write the number of digits
+ * kappa:	where to write the decimal exponent of the last digit
+ * returns	nonzero iff the digits are known to be correct
+ */
+static int digit_gen(struct diy_fp low, struct diy_fp w, struct diy_fp high,
+		     char *buf, int *len, int *kappa)
+{
+	uint64_t unit = 1;
+	/* the interval, widened by the imprecision of its ends */
+	uint64_t too_low = low.f - unit, too_high = high.f + unit;
+	uint64_t unsafe = too_high - too_low;
+	int shift = -w.e;
+	uint64_t one = 1ULL << shift;
+	uint32_t integrals = too_high >> shift;
+	uint64_t fractionals = too_high & (one - 1);
+	uint32_t divisor;
+
+	for (*kappa = 0; *kappa < 10 && integrals >= small_powers[*kappa];
+	     (*kappa)++) {
+	}
+	divisor = small_powers[*kappa - 1];
+	*len = 0;
+
+	while (*kappa > 0) {
+		uint64_t rest;
+
+		buf[(*len)++] = '0' + integrals / divisor;
+		integrals %= divisor;
+		(*kappa)--;
+		rest = ((uint64_t) integrals << shift) + fractionals;
+		if (rest < unsafe) {
+			return round_weed(buf, *len, too_high - w.f, unsafe,
+					  rest, (uint64_t) divisor << shift,
+					  unit);
+		}
+		divisor /= 10;
+	}
+
+	for (;;) {
+		fractionals *= 10;
+		unit *= 10;
+		unsafe *= 10;
+		buf[(*len)++] = '0' + (fractionals >> shift);
+		fractionals &= one - 1;
+		(*kappa)--;
+		if (fractionals < unsafe) {
+			return round_weed(buf, *len, (too_high - w.f) * unit,
+					  unsafe, fractionals, one, unit);
+		}
+	}
+}
+
+/*
+ * Find the shortest digits of a positive value with Grisu3
+ * bits:	the bits of the value
+ * format:	the format of the bits
+ * buf:		where to write the digits
+ * len:		where to write the number of digits
+ * dec_exp:	where to write the decimal exponent of the last digit
+ * returns	nonzero iff the digits are known to be the shortest
+ */
+static int grisu3(uint64_t bits, const struct float_format *format,
+		  char *buf, int *len, int *dec_exp)
+{
+	uint64_t hidden = 1ULL << format->frac_bits;
+	int biased = bits >> format->frac_bits;
+	struct diy_fp v = {bits & (hidden - 1), 1 - format->exp_bias};
+	struct diy_fp w, low, high, scale;
+	const struct cached_power *power;
+	double k_min;
+	int k, kappa;
+
+	if (biased > 0) {
+		v.f |= hidden;
+		v.e = biased - format->exp_bias;
+	}
+	w = normalize(v);
+
+	/* the halfway points to the neighbors of the value */
+	high.f = (v.f << 1) + 1;
+	high.e = v.e - 1;
+	high = normalize(high);
+	if (v.f == hidden && biased > 1) {
+		/* the neighbor below is closer, past a power of two */
+		low.f = (v.f << 2) - 1;
+		low.e = v.e - 2;
+	} else {
+		low.f = (v.f << 1) - 1;
+		low.e = v.e - 1;
+	}
+	low.f <<= low.e - high.e;
+	low.e = high.e;
+
+	/* the power of ten that brings the exponent between the bounds */
+	k_min = (MIN_TARGET_EXP - (w.e + 64) + 63) * INV_LOG2_10;
+	k = (int) k_min;
+	if (k < k_min) {
+		k++;
+	}
+	power = &cached_powers[(CACHED_POWERS_OFFSET + k - 1) /
+			       CACHED_POWERS_STEP + 1];
+	scale.f = power->f;
+	scale.e = power->e;
+
+	if (!digit_gen(multiply(low, scale), multiply(w, scale),
+		       multiply(high, scale), buf, len, &kappa)) {
+		return 0;
+	}
+	*dec_exp = kappa - power->dec_exp;
+
+	return 1;
+}
+
+/*
+ * Find the shortest digits of a positive value by trying every precision,
+ * for the values that Grisu3 cannot decide
+ * value:	the value, exactly as a double
+ * format:	the format the digits must read back as
+ * buf:		where to write the digits
+ * len:		where to write the number of digits
+ * dec_exp:	where to write the decimal exponent of the last digit
+ */
+static void printf_digits(double value, const struct float_format *format,
+			  char *buf, int *len, int *dec_exp)
+{
+	/* "d.ddde-ddd" */
+	char str[DOUBLE_MAX_DIGITS + 8];
+	int n_digits;
+
+	for (n_digits = 1;; n_digits++) {
+		snprintf(str, sizeof(str), "%.*e", n_digits - 1, value);
+		if (n_digits == format->max_digits) {
+			break;
+		}
+		if (format == &float_format ?
+		    strtof(str, NULL) == (float) value :
+		    strtod(str, NULL) == value) {
+			break;
+		}
+	}
+
+	buf[0] = str[0];
+	if (n_digits > 1) {
+		memcpy(buf + 1, str + 2, n_digits - 1);
+	}
+	*len = n_digits;
+	/* the exponent follows the digits, the decimal point and the 'e' */
+	*dec_exp = atoi(str + (n_digits > 1 ? n_digits + 2 : 2)) -
+		   (n_digits - 1);
+}
+
+/*
+ * Write the digits of a number as the shortest C literal,
+ * either in positional or exponential notation
+ * dst:		where to write the literal
+ * digits:	the significant digits
+ * len:		the number of digits
+ * dec_exp:	the decimal exponent of the last digit
+ * returns	the number of characters written
+ */
+static size_t write_digits(char *dst, const char *digits, int len,
+			   int dec_exp)
+{
+	/* the number of digits before the decimal point */
+	int point = len + dec_exp;
+	int exp = point - 1;
+	int exp_len = len + (len > 1) + 1 + (exp < 0) +
+		      (abs(exp) >= 100 ? 3 : abs(exp) >= 10 ? 2 : 1);
+	int fixed_len = dec_exp >= 0 ? point + 2 :
+			point > 0 ? len + 1 : 2 - point + len;
+	size_t pos = 0;
+
+	if (fixed_len <= exp_len) {
+		if (point <= 0) {
+			/* "0.00ddd" */
+			dst[pos++] = '0';
+			dst[pos++] = '.';
+			memset(dst + pos, '0', -point);
+			pos += -point;
+			memcpy(dst + pos, digits, len);
+			return pos + len;
+		}
+		if (dec_exp >= 0) {
+			/* "ddd00.0" */
+			memcpy(dst, digits, len);
+			memset(dst + len, '0', dec_exp);
+			pos = point;
+			dst[pos++] = '.';
+			dst[pos++] = '0';
+			return pos;
+		}
+		/* "dd.ddd" */
+		memcpy(dst, digits, point);
+		dst[point] = '.';
+		memcpy(dst + point + 1, digits + point, len - point);
+		return len + 1;
+	}
+
+	/* "d.ddde-dd" */
+	dst[pos++] = digits[0];
+	if (len > 1) {
+		dst[pos++] = '.';
+		memcpy(dst + pos, digits + 1, len - 1);
+		pos += len - 1;
+	}
+	dst[pos++] = 'e';
+	if (exp < 0) {
+		dst[pos++] = '-';
+		exp = -exp;
+	}
+	if (exp >= 100) {
+		dst[pos++] = '0' + exp / 100;
+	}
+	if (exp >= 10) {
+		dst[pos++] = '0' + exp / 10 % 10;
+	}
+	dst[pos++] = '0' + exp % 10;
+
+	return pos;
+}
+
+/*
+ * Write the exact value of a positive double as a hexadecimal literal,
+ * eg. "0x1.8p-3"
+ * dst:		where to write the literal
+ * bits:	the bits of the double
+ * returns	the number of characters written
+ */
+static size_t write_hex(char *dst, uint64_t bits)
+{
+	static const char hex_digits[16] = "0123456789abcdef";
+	uint64_t frac = bits & ((1ULL << 52) - 1);
+	int biased = bits >> 52;
+	int exp = biased > 0 ? biased - 1023 : -1022;
+	size_t pos = 0;
+
+	dst[pos++] = '0';
+	dst[pos++] = 'x';
+	dst[pos++] = biased > 0 ? '1' : '0';
+	if (frac != 0) {
+		dst[pos++] = '.';
+		/* the 52 bits are 13 hexadecimal digits, from the top */
+		while (frac != 0) {
+			dst[pos++] = hex_digits[frac >> 48];
+			frac = (frac << 4) & ((1ULL << 52) - 1);
+		}
+	}
+	dst[pos++] = 'p';
+	if (exp < 0) {
+		dst[pos++] = '-';
+		exp = -exp;
+	}
+	if (exp >= 1000) {
+		dst[pos++] = '0' + exp / 1000;
+	}
+	if (exp >= 100) {
+		dst[pos++] = '0' + exp / 100 % 10;
+	}
+	if (exp >= 10) {
+		dst[pos++] = '0' + exp / 10 % 10;
+	}
+	dst[pos++] = '0' + exp % 10;
+
+	return pos;
+}
+
+/*
+ * Write a float or double as a literal
+ * dst:		where to write the literal
+ * value:	the value, exactly as a double
+ * bits:	the bits of the value in its own format
+ * format:	the format of the value
+ * radix:	whether to write it in decimal or hexadecimal
+ * returns	the number of characters written
+ */
+static size_t format_literal(char *dst, double value, uint64_t bits,
+			     const struct float_format *format,
+			     enum c_array_radix radix)
+{
+	int is_float = format == &float_format;
+	uint64_t sign_bit = 1ULL << (format->frac_bits + (is_float ? 8 : 11));
+	char digits[DOUBLE_MAX_DIGITS + 1];
+	int len, dec_exp;
+	size_t pos = 0;
+
+	if (isnan(value)) {
+		memcpy(dst, NAN_STR, sizeof(NAN_STR) - 1);
+		return sizeof(NAN_STR) - 1;
+	}
+	if (bits & sign_bit) {
+		dst[pos++] = '-';
+		bits &= ~sign_bit;
+		value = -value;
+	}
+	if (isinf(value)) {
+		memcpy(dst + pos, INFINITY_STR, sizeof(INFINITY_STR) - 1);
+		return pos + sizeof(INFINITY_STR) - 1;
+	}
+
+	if (value == 0) {
+		memcpy(dst + pos, ZERO_STR, sizeof(ZERO_STR) - 1);
+		pos += sizeof(ZERO_STR) - 1;
+	} else if (radix == C_ARRAY_HEX) {
+		union {
+			double value;
+			uint64_t bits;
+		} as_double = {.value = value};
+
+		/* every float is a double, so this is exact for both */
+		pos += write_hex(dst + pos, as_double.bits);
+	} else {
+		if (!grisu3(bits, format, digits, &len, &dec_exp)) {
+			printf_digits(value, format, digits, &len, &dec_exp);
+		}
+		while (len > 1 && digits[len - 1] == '0') {
+			len--;
+			dec_exp++;
+		}
+		pos += write_digits(dst + pos, digits, len, dec_exp);
+	}
+
+	if (is_float) {
+		dst[pos++] = FLOAT_SUFFIX;
+	}
+
+	return pos;
+}
+
+size_t format_float_literal(char *dst, float value, enum c_array_radix radix)
+{
+	union {
+		float value;
+		uint32_t bits;
+	} as_float = {.value = value};
+
+	return format_literal(dst, value, as_float.bits, &float_format, radix);
+}
+
+size_t format_double_literal(char *dst, double value,
+			     enum c_array_radix radix)
+{
+	union {
+		double value;
+		uint64_t bits;
+	} as_double = {.value = value};
+
+	return format_literal(dst, value, as_double.bits, &double_format,
+			      radix);
+}
+
+int write_float_literal(struct c_gen *to_write, float value,
+			enum c_array_radix radix)
+{
+	char literal[C_FLOAT_LITERAL_MAX_LEN];
+	size_t len = format_float_literal(literal, value, radix);
+
+	return line_gen_write_len(literal, len, &to_write->base_gen);
+}
+
+int write_double_literal(struct c_gen *to_write, double value,
+			 enum c_array_radix radix)
+{
+	char literal[C_DOUBLE_LITERAL_MAX_LEN];
+	size_t len = format_double_literal(literal, value, radix);
+
+	return line_gen_write_len(literal, len, &to_write->base_gen);
+}
@@ -0,0 +1,370 @@
+#include <c_frag.h>
+#include <logger.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* fragment generation logs at the threshold of "struct c_gen" */
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/*
+ * the size of the staging buffer of each fragment,
+ * which is kept small, since there may be thousands of fragments
+ */
+#define FRAG_BUF_SIZE	4096
+
+/* the output of one fragment */
+struct frag_out {
+	char *data; /* the emitted bytes */
+	size_t len; /* the number of emitted bytes */
+	size_t end_indent; /* the indentation depth after the fragment */
+	size_t deepest; /* the deepest indentation depth of the fragment */
+	int end_on_new_line; /* the line state after the fragment */
+	int ret; /* 0 iff the fragment was emitted successfully */
+#ifdef LINE_GEN_STATS
+	struct line_gen_stats stats; /* the work done by the fragment */
+#endif
+};
+
+/* the fragment indices a worker has yet to emit */
+struct frag_queue {
+	pthread_mutex_t lock; /* guards "next" and "end" */
+	size_t next; /* the next index that the owner will take */
+	size_t end; /* one past the last index, from which thieves take */
+};
+
+/* the state shared by all workers */
+struct frag_pool {
+	const struct line_gen *parent; /* the generator to start from */
+	c_frag_emitter emitter; /* the function that emits each fragment */
+	void *arg; /* the argument to "emitter" */
+	struct frag_out *outs; /* the output of each fragment, by index */
+	struct frag_queue *queues; /* the queue of each worker */
+	size_t n_workers; /* the number of workers and queues */
+};
+
+/* the argument to each worker thread */
+struct frag_worker {
+	struct frag_pool *pool; /* the shared state */
+	size_t worker_i; /* the index of the worker's own queue */
+	pthread_t thread; /* the thread running the worker, unless first */
+	int started; /* nonzero iff "thread" was started */
+};
+
+/*
+ * Emit a single fragment into its own memory sink
+ * pool:	the shared state, including the parent and emitter
+ * frag_i:	the index of the fragment to emit
+ */
+static void emit_frag(struct frag_pool *pool, size_t frag_i)
+{
+	const struct line_gen *parent = pool->parent;
+	struct frag_out *out = &pool->outs[frag_i];
+	struct line_sink sink;
+	struct c_gen frag;
+
+	line_sink_mem(&sink, 0);
+	str_arena_init(&frag.arena);
+	frag.protos = NULL;
+	init_line_gen_sink(&frag.base_gen, parent->max_indent, &sink,
+			   FRAG_BUF_SIZE);
+	frag.base_gen.indent = parent->indent;
+	frag.base_gen.col = parent->col;
+	frag.base_gen.on_new_line = parent->on_new_line;
+	frag.base_gen.sticky = parent->sticky;
+	if (line_gen_set_indent(&frag.base_gen, parent->indent_char,
+				parent->indent_width)) {
+		printlg(ERROR_LEVEL, "Could not set up fragment %u.\n",
+			(unsigned) frag_i);
+		out->ret = -1;
+	} else {
+		out->ret = pool->emitter(&frag, frag_i, pool->arg);
+	}
+	out->end_indent = frag.base_gen.indent;
+	out->deepest = frag.base_gen.deepest;
+	out->end_on_new_line = frag.base_gen.on_new_line;
+	if (close_c_gen(&frag) || line_gen_error(&frag.base_gen)) {
+		out->ret = -1;
+	}
+#ifdef LINE_GEN_STATS
+	out->stats = frag.base_gen.stats;
+#endif
+	out->data = line_sink_mem_take(&frag.base_gen.sink, &out->len);
+}
+
+/*
+ * Take the next fragment index from a worker's own queue
+ * queue:	the worker's queue
+ * frag_i:	set to the taken index
+ * returns	1 iff an index was taken, 0 if the queue is empty
+ */
+static int take_frag(struct frag_queue *queue, size_t *frag_i)
+{
+	int taken = 0;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->next < queue->end) {
+		*frag_i = queue->next++;
+		taken = 1;
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return taken;
+}
+
+/*
+ * Move half of the remaining indices of another worker's queue
+ * to the back of an empty queue
+ * pool:	the shared state, including all queues
+ * thief_i:	the index of the empty queue
+ * returns	1 iff any indices were stolen, 0 if all other queues are empty
+ */
+static int steal_frags(struct frag_pool *pool, size_t thief_i)
+{
+	struct frag_queue *thief = &pool->queues[thief_i];
+	size_t victim_step;
+
+	for (victim_step = 1; victim_step < pool->n_workers; victim_step++) {
+		struct frag_queue *victim =
+			&pool->queues[(thief_i + victim_step) %
+				      pool->n_workers];
+		size_t stolen_start = 0, stolen_end = 0;
+
+		pthread_mutex_lock(&victim->lock);
+		if (victim->next < victim->end) {
+			size_t remaining = victim->end - victim->next;
+
+			stolen_end = victim->end;
+			stolen_start = stolen_end - (remaining + 1) / 2;
+			victim->end = stolen_start;
+		}
+		pthread_mutex_unlock(&victim->lock);
+
+		if (stolen_start < stolen_end) {
+			pthread_mutex_lock(&thief->lock);
+			thief->next = stolen_start;
+			thief->end = stolen_end;
+			pthread_mutex_unlock(&thief->lock);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Emit fragments from a worker's own queue, and then from stolen ones,
+ * until no queue has any left
+ * worker_arg:	the "struct frag_worker" of the worker
+ * returns	NULL
+ */
+static void *run_worker(void *worker_arg)
+{
+	struct frag_worker *worker = worker_arg;
+	struct frag_pool *pool = worker->pool;
+	struct frag_queue *queue = &pool->queues[worker->worker_i];
+
+	do {
+		size_t frag_i;
+
+		while (take_frag(queue, &frag_i)) {
+			emit_frag(pool, frag_i);
+		}
+	} while (steal_frags(pool, worker->worker_i));
+
+	return NULL;
+}
+
+/*
+ * Choose the number of workers
+ * n_frags:	the number of fragments to emit
+ * n_threads:	the requested number of threads, or 0 for one per processor
+ * returns	the number of workers, between 1 and "n_frags",
+ *		and at most one per online processor
+ */
+static size_t count_workers(size_t n_frags, size_t n_threads)
+{
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_workers = n_cpus > 0 ? (size_t) n_cpus : 1;
+
+	if (n_threads == 0 || n_threads > max_workers) {
+		n_threads = max_workers;
+	}
+	if (n_threads > n_frags) {
+		n_threads = n_frags;
+	}
+
+	return n_threads > 0 ? n_threads : 1;
+}
+
+/*
+ * Run the pool on the calling thread and "n_workers - 1" new threads
+ * pool:	the shared state, with the queues filled
+ * workers:	the argument and thread of each worker
+ */
+static void run_pool(struct frag_pool *pool, struct frag_worker *workers)
+{
+	size_t worker_i;
+
+	for (worker_i = 1; worker_i < pool->n_workers; worker_i++) {
+		struct frag_worker *worker = &workers[worker_i];
+
+		worker->started = !pthread_create(&worker->thread, NULL,
+						  run_worker, worker);
+		if (!worker->started) {
+			/* the other workers will steal its fragments */
+			printlg(WARNING_LEVEL,
+				"Could not start fragment worker %u.\n",
+				(unsigned) worker_i);
+		}
+	}
+	run_worker(&workers[0]);
+	for (worker_i = 1; worker_i < pool->n_workers; worker_i++) {
+		if (workers[worker_i].started) {
+			pthread_join(workers[worker_i].thread, NULL);
+		}
+	}
+}
+
+#ifdef LINE_GEN_STATS
+/*
+ * Add the work done by a fragment to the counters of the parent.
+ * The bytes are counted when they are spliced into the parent,
+ * and the fragment's own sink is not the parent's, so neither is added.
+ * parent:	the generator into which the fragment is spliced
+ * frag:	the counters of the fragment
+ */
+static void add_frag_stats(struct line_gen *parent,
+			   const struct line_gen_stats *frag)
+{
+	parent->stats.n_lines += frag->n_lines;
+	parent->stats.n_indent_bytes += frag->n_indent_bytes;
+	parent->stats.n_indents += frag->n_indents;
+	parent->stats.n_unindents += frag->n_unindents;
+	if (frag->max_depth > parent->stats.max_depth) {
+		parent->stats.max_depth = frag->max_depth;
+	}
+}
+#endif
+
+/*
+ * Check that the fragments can be spliced in order, and splice them
+ * parent:	the generator into which to splice the fragments
+ * outs:	the output of each fragment, by index
+ * n_frags:	the number of fragments
+ * order:	the splice order, or NULL for increasing index
+ * returns	0 iff successful;
+ *		-1 if writing to the parent failed, with errno set
+ *		-2 if a fragment other than the last did not end
+ *		   in the state it started in
+ */
+static int splice_frags(struct c_gen *parent, const struct frag_out *outs,
+			size_t n_frags, const size_t *order)
+{
+	struct line_gen *base = &parent->base_gen;
+	size_t pos;
+
+	for (pos = 0; pos + 1 < n_frags; pos++) {
+		const struct frag_out *out = &outs[order ? order[pos] : pos];
+
+		if (out->end_indent != base->indent ||
+		    out->end_on_new_line != base->on_new_line) {
+			printlg(ERROR_LEVEL,
+				"Fragment %u ends at depth %u, "
+				"but the next starts at %u.\n",
+				(unsigned) (order ? order[pos] : pos),
+				(unsigned) out->end_indent,
+				(unsigned) base->indent);
+			return -2;
+		}
+	}
+
+	for (pos = 0; pos < n_frags; pos++) {
+		const struct frag_out *out = &outs[order ? order[pos] : pos];
+
+		if (line_gen_append(base, out->data, out->len)) {
+			printlg(ERROR_LEVEL, "Could not splice fragment %u.\n",
+				(unsigned) (order ? order[pos] : pos));
+			return -1;
+		}
+		base->indent = out->end_indent;
+		base->on_new_line = out->end_on_new_line;
+		if (out->deepest > base->deepest) {
+			base->deepest = out->deepest;
+		}
+#ifdef LINE_GEN_STATS
+		add_frag_stats(base, &out->stats);
+#endif
+	}
+
+	return 0;
+}
+
+int c_gen_fragments(struct c_gen *parent, size_t n_frags, const size_t *order,
+		    c_frag_emitter emitter, void *arg, size_t n_threads)
+{
+	struct frag_pool pool = {
+		.parent = &parent->base_gen,
+		.emitter = emitter,
+		.arg = arg,
+		.n_workers = count_workers(n_frags, n_threads)
+	};
+	struct frag_worker *workers;
+	size_t worker_i, frag_i;
+	int ret = 0;
+
+	if (n_frags == 0) {
+		return 0;
+	}
+
+	pool.outs = calloc(n_frags, sizeof(*pool.outs));
+	pool.queues = calloc(pool.n_workers, sizeof(*pool.queues));
+	workers = calloc(pool.n_workers, sizeof(*workers));
+	if (pool.outs == NULL || pool.queues == NULL || workers == NULL) {
+		printlg(ERROR_LEVEL, "Could not allocate fragment pool.\n");
+		free(pool.outs);
+		free(pool.queues);
+		free(workers);
+		return line_gen_fail(&parent->base_gen, -1);
+	}
+
+	/* give each worker an even, contiguous share to start with */
+	for (worker_i = 0; worker_i < pool.n_workers; worker_i++) {
+		struct frag_queue *queue = &pool.queues[worker_i];
+
+		pthread_mutex_init(&queue->lock, NULL);
+		queue->next = worker_i * n_frags / pool.n_workers;
+		queue->end = (worker_i + 1) * n_frags / pool.n_workers;
+		workers[worker_i].pool = &pool;
+		workers[worker_i].worker_i = worker_i;
+	}
+
+	run_pool(&pool, workers);
+
+	for (frag_i = 0; frag_i < n_frags && ret == 0; frag_i++) {
+		if (pool.outs[frag_i].ret) {
+			printlg(ERROR_LEVEL, "Fragment %u failed.\n",
+				(unsigned) frag_i);
+			ret = -1;
+		}
+	}
+	if (ret == 0) {
+		ret = splice_frags(parent, pool.outs, n_frags, order);
+	}
+
+	for (worker_i = 0; worker_i < pool.n_workers; worker_i++) {
+		pthread_mutex_destroy(&pool.queues[worker_i].lock);
+	}
+	for (frag_i = 0; frag_i < n_frags; frag_i++) {
+		free(pool.outs[frag_i].data);
+	}
+	free(pool.outs);
+	free(pool.queues);
+	free(workers);
+
+	/* so that the failure is seen in sticky-error mode */
+	return ret ? line_gen_fail(&parent->base_gen, ret) : 0;
+}
@@ -2,40 +2,52 @@
 
 #include <c_gen.h>
 
-int declare_function(struct c_gen *to_declare, const char *type,
-		     const char *name, size_t n_args, ...)
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/*
+ * Write the declaration of a function, up to its closing parenthesis
+ * to_declare:	contains the stream for writing the declaration
+ * type:	the return type
+ * name:	the function name
+ * n_args:	number of function arguments
+ * args:	the "struct typed_var *" instances of the arguments
+ * returns	0 iff successful
+ *		-1 if writing a line failed, with errno set
+ */
+static int write_declaration(struct line_gen *to_declare, const char *type,
+			     const char *name, size_t n_args, va_list args)
 {
-	va_list args;
+	const struct line_gen_str head[] = {
+		LINE_GEN_STR(type), LINE_GEN_LIT(VAR_DEC_SEP),
+		LINE_GEN_STR(name), LINE_GEN_LIT(PAREN_OPEN)
+	};
 	size_t arg_i;
 	int ret;
 
-	if ((ret = line_gen_write(type, &to_declare->base_gen))) {
-		printlg(ERROR_LEVEL,
-			"Could not write function return type.\n");
-		return ret;
-	}
-	if ((ret = line_gen_write(" ", &to_declare->base_gen))) {
-		printlg(ERROR_LEVEL,
-			"Could not write space after function return type.\n");
-		return ret;
-	}
-	if ((ret = line_gen_write(name, &to_declare->base_gen))) {
-		printlg(ERROR_LEVEL,
-			"Could not write function name.\n");
-		return ret;
-	}
-	if ((ret = line_gen_write(PAREN_OPEN, &to_declare->base_gen))) {
+	if ((ret = line_gen_writev(to_declare, head, 4))) {
 		printlg(ERROR_LEVEL,
-			"Could not start arguments.\n");
+			"Could not write function return type, name "
+			"and start of arguments.\n");
 		return ret;
 	}
 
-	va_start(args, n_args);
 	for (arg_i = 0; arg_i < n_args; arg_i++) {
 		struct typed_var *arg = va_arg(args, struct typed_var *);
+		const struct line_gen_str arg_dec[] = {
+			LINE_GEN_STR(arg->type), LINE_GEN_LIT(VAR_DEC_SEP),
+			LINE_GEN_STR(arg->name)
+		};
+
 		if (arg_i > 0) {
-			if ((ret = line_gen_write(NEW_ARG,
-						  &to_declare->base_gen))) {
+			if ((ret = line_gen_write_str(LINE_GEN_LIT(NEW_ARG),
+						      to_declare))) {
 				printlg(ERROR_LEVEL,
 					"Could not write delimiter before "
 					"%u.\n",
@@ -43,8 +55,7 @@ int declare_function(struct c_gen *to_declare, const char *type,
 				return ret;
 			}
 		}
-		if (line_gen_printf(&to_declare->base_gen, VAR_DEC_FMT,
-					   arg->type, arg->name) <= 0) {
+		if ((ret = line_gen_writev(to_declare, arg_dec, 3))) {
 			printlg(ERROR_LEVEL,
 				"Could not write argument %u, (" VAR_DEC_FMT
 				").\n",
@@ -52,9 +63,9 @@ int declare_function(struct c_gen *to_declare, const char *type,
 			return ret;
 		}
 	}
-	va_end(args);
 
-	if ((ret = line_gen_write(PAREN_CLOSE, &to_declare->base_gen))) {
+	if ((ret = line_gen_write_str(LINE_GEN_LIT(PAREN_CLOSE),
+				      to_declare))) {
 		printlg(ERROR_LEVEL,
 			"Could not close arguments.\n");
 		return ret;
@@ -62,3 +73,719 @@ int declare_function(struct c_gen *to_declare, const char *type,
 
 	return 0;
 }
+
+/*
+ * Find the return type of the prototype of a function
+ * type:	the return type of the function, with any specifiers
+ * returns	the type without INLINE_KW at its start,
+ *		or NULL if the function is static, so it has no prototype
+ */
+static const char *proto_type(const char *type)
+{
+	for (;;) {
+		if (!strncmp(type, STATIC_KW " ", sizeof(STATIC_KW))) {
+			return NULL;
+		}
+		if (strncmp(type, INLINE_KW " ", sizeof(INLINE_KW))) {
+			return type;
+		}
+		type += sizeof(INLINE_KW);
+	}
+}
+
+int declare_function(struct c_gen *to_declare, const char *type,
+		     const char *name, size_t n_args, ...)
+{
+	const char *proto;
+	va_list args;
+	int ret;
+
+	va_start(args, n_args);
+	ret = write_declaration(&to_declare->base_gen, type, name, n_args,
+				args);
+	va_end(args);
+	if (ret || to_declare->protos == NULL ||
+	    (proto = proto_type(type)) == NULL) {
+		return ret;
+	}
+
+	va_start(args, n_args);
+	ret = write_declaration(&to_declare->protos->base_gen, proto, name,
+				n_args, args);
+	va_end(args);
+	if (ret || (ret = end_statement(to_declare->protos))) {
+		printlg(ERROR_LEVEL, "Could not write prototype of %s.\n",
+			name);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* the two decimal digits of every number below 100, one after another */
+static const char digit_pairs[200] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* the hexadecimal digits */
+static const char hex_digits[16] = "0123456789abcdef";
+
+/* the properties of an element type of "emit_array" */
+struct array_kind {
+	const char *name; /* the name of the type in the generated code */
+	size_t size; /* the size of an element */
+	int is_signed; /* nonzero if the type is signed */
+	size_t max_digits; /* the most decimal digits of an element */
+	/*
+	 * the macro of the smallest value of a signed type,
+	 * whose magnitude need not fit in the type as a literal,
+	 * or NULL if the type is unsigned, or promoted to "int",
+	 * in which its smallest value is written as a plain literal
+	 */
+	const char *min_name;
+};
+
+static const struct array_kind array_kinds[N_C_ARRAY_TYPES] = {
+	[C_ARRAY_U8] = {"uint8_t", 1, 0, 3, NULL},
+	[C_ARRAY_U16] = {"uint16_t", 2, 0, 5, NULL},
+	[C_ARRAY_U32] = {"uint32_t", 4, 0, 10, NULL},
+	[C_ARRAY_U64] = {"uint64_t", 8, 0, 20, NULL},
+	[C_ARRAY_I8] = {"int8_t", 1, 1, 3, NULL},
+	[C_ARRAY_I16] = {"int16_t", 2, 1, 5, NULL},
+	[C_ARRAY_I32] = {"int32_t", 4, 1, 10, "INT32_MIN"},
+	[C_ARRAY_I64] = {"int64_t", 8, 1, 19, "INT64_MIN"},
+	[C_ARRAY_FLOAT] = {"float", 4, 1, 0, NULL},
+	[C_ARRAY_DOUBLE] = {"double", 8, 1, 0, NULL}
+};
+
+/*
+ * Write an unsigned integer in decimal, two digits at a time
+ * dst:		where to write the digits
+ * value:	the integer to write
+ * returns	the number of digits written
+ */
+static inline size_t format_dec(char *dst, unsigned long long value)
+{
+	unsigned long long rest = value;
+	size_t len = 1, pos;
+
+	while (rest >= 100) {
+		rest /= 100;
+		len += 2;
+	}
+	len += rest >= 10;
+
+	pos = len;
+	while (value >= 100) {
+		pos -= 2;
+		memcpy(dst + pos, digit_pairs + 2 * (value % 100), 2);
+		value /= 100;
+	}
+	if (value >= 10) {
+		memcpy(dst, digit_pairs + 2 * value, 2);
+	} else {
+		dst[0] = '0' + value;
+	}
+
+	return len;
+}
+
+/*
+ * Write an unsigned integer in hexadecimal, with a "0x" prefix
+ * dst:		where to write the digits
+ * value:	the integer to write
+ * n_digits:	the number of digits, padded with zeros
+ * returns	the number of characters written
+ */
+static inline size_t format_hex(char *dst, unsigned long long value,
+				size_t n_digits)
+{
+	size_t pos;
+
+	dst[0] = '0';
+	dst[1] = 'x';
+	for (pos = n_digits + 1; pos > 1; pos--) {
+		dst[pos] = hex_digits[value & 0xf];
+		value >>= 4;
+	}
+
+	return n_digits + 2;
+}
+
+/*
+ * Write a single element of "emit_array"
+ * dst:		where to write the element,
+ *		with room for its longest, and one more byte
+ * type:	the type of the element
+ * data:	the elements
+ * elem_i:	the index of the element to write
+ * radix:	the radix of the element
+ * returns	the number of characters written
+ */
+static inline size_t format_elem(char *dst, enum c_array_type type,
+				 const void *data, size_t elem_i,
+				 enum c_array_radix radix)
+{
+	unsigned long long value;
+	size_t len = 0;
+	long long signed_value;
+
+	switch (type) {
+	case C_ARRAY_U8:
+		value = ((const uint8_t *) data)[elem_i];
+		break;
+	case C_ARRAY_U16:
+		value = ((const uint16_t *) data)[elem_i];
+		break;
+	case C_ARRAY_U32:
+		value = ((const uint32_t *) data)[elem_i];
+		break;
+	case C_ARRAY_U64:
+		value = ((const uint64_t *) data)[elem_i];
+		if (radix == C_ARRAY_DEC && value > INT64_MAX) {
+			/* too big for any signed type, so mark it unsigned */
+			len = format_dec(dst, value);
+			dst[len] = 'u';
+			return len + 1;
+		}
+		break;
+	case C_ARRAY_FLOAT:
+		return format_float_literal(dst, ((const float *) data)[elem_i],
+					    radix);
+	case C_ARRAY_DOUBLE:
+		return format_double_literal(dst,
+					     ((const double *) data)[elem_i],
+					     radix);
+	default:
+		switch (type) {
+		case C_ARRAY_I8:
+			signed_value = ((const int8_t *) data)[elem_i];
+			break;
+		case C_ARRAY_I16:
+			signed_value = ((const int16_t *) data)[elem_i];
+			break;
+		case C_ARRAY_I32:
+			signed_value = ((const int32_t *) data)[elem_i];
+			break;
+		default:
+			signed_value = ((const int64_t *) data)[elem_i];
+			break;
+		}
+		if (signed_value >= 0) {
+			value = signed_value;
+			break;
+		}
+		/* negated as unsigned, so that the smallest value fits */
+		value = -(unsigned long long) signed_value;
+		if (array_kinds[type].min_name != NULL &&
+		    value == 1ULL << (8 * array_kinds[type].size - 1)) {
+			len = strlen(array_kinds[type].min_name);
+			memcpy(dst, array_kinds[type].min_name, len);
+			return len;
+		}
+		dst[len++] = '-';
+		break;
+	}
+
+	if (radix == C_ARRAY_HEX) {
+		return len + format_hex(dst + len, value,
+					2 * array_kinds[type].size);
+	}
+	return len + format_dec(dst + len, value);
+}
+
+/*
+ * Get the longest an element of "emit_array" can be
+ * type:	the type of the element
+ * radix:	the radix of the element
+ * returns	the number of characters
+ */
+static size_t max_elem_len(enum c_array_type type, enum c_array_radix radix)
+{
+	const struct array_kind *kind = &array_kinds[type];
+	size_t len;
+
+	if (type == C_ARRAY_FLOAT) {
+		return C_FLOAT_LITERAL_MAX_LEN;
+	}
+	if (type == C_ARRAY_DOUBLE) {
+		return C_DOUBLE_LITERAL_MAX_LEN;
+	}
+	if (radix == C_ARRAY_HEX) {
+		len = kind->is_signed + 2 + 2 * kind->size;
+	} else {
+		/* unsigned 64-bit integers get a suffix instead of a sign */
+		len = 1 + kind->max_digits;
+	}
+	if (kind->min_name != NULL && strlen(kind->min_name) > len) {
+		len = strlen(kind->min_name);
+	}
+
+	return len;
+}
+
+/* the number of elements of an array whose length is not known ahead */
+#define UNKNOWN_LEN	((size_t) -1)
+
+/*
+ * the layout of the lines of elements of an array
+ */
+struct array_lines {
+	enum c_array_type type; /* the type of the elements */
+	enum c_array_radix radix; /* the radix of the elements */
+	/* the longest an element can be, with the comma and space after it */
+	size_t max_len;
+	size_t indent_len; /* the number of indentation characters per line */
+	size_t per_line; /* the number of elements per line */
+};
+
+/*
+ * Write the start of the definition of an array, up to its open brace
+ * to_emit:	the generator to write to
+ * kind:	the type of the elements
+ * name:	the name of the array
+ * n_elems:	the number of elements, or UNKNOWN_LEN to leave it out
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+static int start_array(struct c_gen *to_emit, const struct array_kind *kind,
+		       const char *name, size_t n_elems)
+{
+	char n_elems_str[20];
+	const struct line_gen_str head[] = {
+		LINE_GEN_LIT(STATIC_KW " const "), LINE_GEN_STR(kind->name),
+		LINE_GEN_LIT(VAR_DEC_SEP), LINE_GEN_STR(name),
+		LINE_GEN_LIT("["),
+		{n_elems_str, n_elems == UNKNOWN_LEN ? 0 :
+			      format_dec(n_elems_str, n_elems)},
+		LINE_GEN_LIT("] = ")
+	};
+
+	return line_gen_writev(&to_emit->base_gen, head,
+			       sizeof(head) / sizeof(head[0]));
+}
+
+/*
+ * Start the definition of an array, up to the line of its first elements,
+ * and lay out the lines of elements
+ * to_emit:	the generator to write to
+ * name:	the name of the array
+ * n_elems:	the number of elements, or UNKNOWN_LEN to leave it out
+ * lines:	the layout to fill in,
+ *		with the type, radix and requested elements per line set
+ * returns	0 iff successful;
+ *		-1 if writing failed, with errno set
+ *		-2 if indenting the elements would exceed the maximum depth
+ */
+static int open_array(struct c_gen *to_emit, const char *name, size_t n_elems,
+		      struct array_lines *lines)
+{
+	struct line_gen *base = &to_emit->base_gen;
+	int ret;
+
+	if ((ret = start_array(to_emit, &array_kinds[lines->type], name,
+			       n_elems))) {
+		printlg(ERROR_LEVEL, "Could not start array %s.\n", name);
+		return ret;
+	}
+	if ((ret = open_block(to_emit))) {
+		printlg(ERROR_LEVEL, "Could not open array %s.\n", name);
+		return ret;
+	}
+	if (line_gen_cover_indent(base, base->indent)) {
+		return line_gen_fail(base, -1);
+	}
+
+	/* each element is followed by a comma, and a space or line break */
+	lines->max_len = max_elem_len(lines->type, lines->radix) + 2;
+	lines->indent_len = base->indent * base->indent_width;
+	if (lines->per_line == 0) {
+		size_t indent_cols = lines->indent_len *
+				     (base->indent_char == '\t' ?
+				      C_TAB_WIDTH : 1);
+
+		/* the last element of a line has no space after it */
+		lines->per_line = indent_cols < MAX_C_CHARS_PER_LINE ?
+				  (MAX_C_CHARS_PER_LINE - indent_cols + 1) /
+				  lines->max_len : 0;
+		if (lines->per_line == 0) {
+			lines->per_line = 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Write lines of elements of an array, formatted in the staging buffer.
+ * Every call but the last for an array must write whole lines.
+ * base:	the generator to write to
+ * lines:	the layout of the lines
+ * data:	the elements, as an array of the matching C type
+ * n_elems:	the number of elements to write
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+static int write_elems(struct line_gen *base, const struct array_lines *lines,
+		       const void *data, size_t n_elems)
+{
+	size_t elem_i;
+
+	for (elem_i = 0; elem_i < n_elems;) {
+		size_t line_len = n_elems - elem_i < lines->per_line ?
+				  n_elems - elem_i : lines->per_line;
+		size_t line_end = elem_i + line_len, pos;
+		char *dst;
+
+		if ((dst = line_gen_reserve(base, lines->indent_len +
+					    line_len * lines->max_len)) ==
+		    NULL) {
+			return -1;
+		}
+		memcpy(dst, base->indent_run, lines->indent_len);
+		pos = lines->indent_len;
+		for (; elem_i < line_end; elem_i++) {
+			pos += format_elem(dst + pos, lines->type, data,
+					   elem_i, lines->radix);
+			dst[pos++] = ',';
+			dst[pos++] = ' ';
+		}
+		dst[pos - 1] = LINE_BREAK_STR[0];
+		line_gen_advance(base, pos);
+		LINE_GEN_COUNT(base, n_indent_bytes, lines->indent_len);
+		LINE_GEN_COUNT(base, n_lines, 1);
+	}
+
+	return 0;
+}
+
+/*
+ * Close the definition of an array, after its last elements
+ * to_emit:	the generator to write to
+ * name:	the name of the array
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+static int close_array(struct c_gen *to_emit, const char *name)
+{
+	int ret;
+
+	if ((ret = _close_block(to_emit)) || (ret = end_statement(to_emit))) {
+		printlg(ERROR_LEVEL, "Could not close array %s.\n", name);
+		return ret;
+	}
+
+	return 0;
+}
+
+int emit_array(struct c_gen *to_emit, const char *name,
+	       enum c_array_type type, const void *data, size_t n_elems,
+	       size_t per_line, enum c_array_radix radix)
+{
+	struct array_lines lines = {
+		.type = type, .radix = radix, .per_line = per_line
+	};
+	int ret;
+
+	if (type >= N_C_ARRAY_TYPES || n_elems == 0) {
+		printlg(ERROR_LEVEL, "Invalid array %s.\n", name);
+		errno = EINVAL;
+		return line_gen_fail(&to_emit->base_gen, -1);
+	}
+	if ((ret = open_array(to_emit, name, n_elems, &lines))) {
+		return ret;
+	}
+	if (write_elems(&to_emit->base_gen, &lines, data, n_elems)) {
+		printlg(ERROR_LEVEL, "Could not write elements of array %s.\n",
+			name);
+		return -1;
+	}
+
+	return close_array(to_emit, name);
+}
+
+/* the most bytes of a file that "embed_file" maps at once */
+#define EMBED_WINDOW_SIZE	(16 * 1024 * 1024)
+/* the size of the buffer "embed_file" reads unmappable files into */
+#define EMBED_READ_SIZE		(64 * 1024)
+/* the alignment of the bytes embedded with ".incbin" */
+#define INCBIN_ALIGN		"16"
+/* the suffix of the name of the length of an embedded file */
+#define EMBED_LEN_SUFFIX	"_len"
+
+/*
+ * Write the bytes of a file through a memory mapping, a window at a time
+ * base:	the generator to write to
+ * lines:	the layout of the lines of bytes
+ * fd:		the file to embed
+ * size:	the size of the file
+ * returns	0 iff successful;
+ *		1 if the file cannot be mapped, and nothing was written
+ *		-1 if mapping a later window, or writing failed,
+ *		   with errno set
+ */
+static int embed_mapped(struct line_gen *base, const struct array_lines *lines,
+			int fd, size_t size)
+{
+	/* windows start on a page, and end on a line */
+	size_t step = sysconf(_SC_PAGESIZE) * lines->per_line;
+	size_t window = EMBED_WINDOW_SIZE / step * step, offset;
+
+	if (window == 0) {
+		window = step;
+	}
+	for (offset = 0; offset < size; offset += window) {
+		size_t len = size - offset < window ? size - offset : window;
+		void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd,
+				 offset);
+		int ret;
+
+		if (map == MAP_FAILED) {
+			printlg(DEBUG_LEVEL, "Could not map bytes at %lu.\n",
+				(unsigned long) offset);
+			return offset == 0 ? 1 : -1;
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+		ret = write_elems(base, lines, map, len);
+		munmap(map, len);
+		if (ret) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Write the bytes of a file by reading it a buffer at a time
+ * base:	the generator to write to
+ * lines:	the layout of the lines of bytes
+ * fd:		the file to embed
+ * n_read:	set to the number of bytes read
+ * returns	0 iff successful;
+ *		-1 if allocating, reading or writing failed, with errno set
+ */
+static int embed_read(struct line_gen *base, const struct array_lines *lines,
+		      int fd, size_t *n_read)
+{
+	/* every buffer but the last holds whole lines */
+	size_t buf_size = EMBED_READ_SIZE / lines->per_line * lines->per_line;
+	size_t used = 0;
+	uint8_t *buf;
+	int ret = 0;
+
+	*n_read = 0;
+	if (buf_size == 0) {
+		buf_size = lines->per_line;
+	}
+	if ((buf = malloc(buf_size)) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not allocate read buffer.\n");
+		return -1;
+	}
+
+	for (;;) {
+		ssize_t got = read(fd, buf + used, buf_size - used);
+
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got < 0) {
+			printlg(DEBUG_LEVEL, "Could not read bytes at %lu.\n",
+				(unsigned long) *n_read);
+			ret = -1;
+			break;
+		}
+		used += got;
+		if (used == buf_size || (got == 0 && used > 0)) {
+			if (write_elems(base, lines, buf, used)) {
+				ret = -1;
+				break;
+			}
+			*n_read += used;
+			used = 0;
+		}
+		if (got == 0) {
+			break;
+		}
+	}
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Write the length of an embedded file
+ * to_emit:	the generator to write to
+ * name:	the name of the array holding the file
+ * len:		the length of the file
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+static int write_embed_len(struct c_gen *to_emit, const char *name, size_t len)
+{
+	char len_str[20];
+	const struct line_gen_str len_def[] = {
+		LINE_GEN_LIT(STATIC_KW " const size_t "), LINE_GEN_STR(name),
+		LINE_GEN_LIT(EMBED_LEN_SUFFIX " = "),
+		{len_str, format_dec(len_str, len)}
+	};
+	int ret;
+
+	if ((ret = line_gen_writev(&to_emit->base_gen, len_def,
+				   sizeof(len_def) / sizeof(len_def[0]))) ||
+	    (ret = end_statement(to_emit))) {
+		printlg(ERROR_LEVEL, "Could not write length of %s.\n", name);
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Embed a file as a byte array
+ * to_emit:	the generator to write to
+ * name:	the name of the array
+ * lines:	the layout of the lines of bytes to fill in,
+ *		as by "open_array"
+ * fd:		the file to embed
+ * size:	the size of the file, or UNKNOWN_LEN if it is not known
+ * returns	0 iff successful, or an error as by "embed_file"
+ */
+static int embed_array(struct c_gen *to_emit, const char *name,
+		       struct array_lines *lines, int fd, size_t size)
+{
+	static const uint8_t zero = 0;
+	struct line_gen *base = &to_emit->base_gen;
+	size_t n_bytes = size;
+	int ret;
+
+	if ((ret = open_array(to_emit, name, size, lines))) {
+		return ret;
+	}
+	ret = size == UNKNOWN_LEN ? 1 : embed_mapped(base, lines, fd, size);
+	if (ret == 1) {
+		ret = embed_read(base, lines, fd, &n_bytes);
+	}
+	if (ret == 0 && size != UNKNOWN_LEN && n_bytes != size) {
+		printlg(ERROR_LEVEL, "%s changed while embedding it.\n", name);
+		errno = EIO;
+		ret = -1;
+	}
+	/* an initializer cannot be empty */
+	if (ret == 0 && n_bytes == 0) {
+		ret = write_elems(base, lines, &zero, 1);
+	}
+	if (ret) {
+		printlg(ERROR_LEVEL, "Could not embed %s.\n", name);
+		return line_gen_fail(base, -1);
+	}
+	if ((ret = close_array(to_emit, name))) {
+		return ret;
+	}
+
+	return write_embed_len(to_emit, name, n_bytes);
+}
+
+/*
+ * Embed a file with an ".incbin" directive
+ * to_emit:	the generator to write to
+ * name:	the name of the symbol
+ * path:	the path of the file, as the assembler should open it
+ * size:	the size of the file, or UNKNOWN_LEN if it is not known
+ * returns	0 iff successful, or an error as by "embed_file"
+ */
+static int embed_incbin(struct c_gen *to_emit, const char *name,
+			const char *path, size_t size)
+{
+	struct line_gen *base = &to_emit->base_gen;
+	const struct line_gen_str asm_lines[][3] = {
+		{LINE_GEN_LIT("\".section .rodata\\n\""), LINE_GEN_LIT(""),
+		 LINE_GEN_LIT("")},
+		{LINE_GEN_LIT("\".global "), LINE_GEN_STR(name),
+		 LINE_GEN_LIT("\\n\"")},
+		{LINE_GEN_LIT("\".balign " INCBIN_ALIGN "\\n\""),
+		 LINE_GEN_LIT(""), LINE_GEN_LIT("")},
+		{LINE_GEN_LIT("\""), LINE_GEN_STR(name),
+		 LINE_GEN_LIT(":\\n\"")},
+		{LINE_GEN_LIT("\".incbin \\\""), LINE_GEN_STR(path),
+		 LINE_GEN_LIT("\\\"\\n\"")},
+		{LINE_GEN_LIT("\".previous\\n\""), LINE_GEN_LIT(""),
+		 LINE_GEN_LIT("")}
+	};
+	const struct line_gen_str decl[] = {
+		LINE_GEN_LIT("extern const uint8_t "), LINE_GEN_STR(name),
+		LINE_GEN_LIT("[]")
+	};
+	size_t line_i;
+	int ret;
+
+	/* the path is quoted twice, so keep it free of escapes */
+	if (size == UNKNOWN_LEN || strpbrk(path, "\"\\\n") != NULL) {
+		printlg(ERROR_LEVEL, "Cannot embed %s with .incbin.\n", path);
+		errno = EINVAL;
+		return line_gen_fail(base, -1);
+	}
+
+	if ((ret = line_gen_write("__asm__(", base)) ||
+	    (ret = indent(base))) {
+		printlg(ERROR_LEVEL, "Could not start asm for %s.\n", name);
+		return ret;
+	}
+	for (line_i = 0; line_i < sizeof(asm_lines) / sizeof(asm_lines[0]);
+	     line_i++) {
+		if ((ret = line_gen_writev(base, asm_lines[line_i], 3)) ||
+		    (ret = finish_line(base))) {
+			printlg(ERROR_LEVEL, "Could not write asm for %s.\n",
+				name);
+			return ret;
+		}
+	}
+	if ((ret = unindent(base)) ||
+	    (ret = line_gen_write(")", base)) ||
+	    (ret = end_statement(to_emit)) ||
+	    (ret = line_gen_writev(base, decl, 3)) ||
+	    (ret = end_statement(to_emit))) {
+		printlg(ERROR_LEVEL, "Could not declare %s.\n", name);
+		return ret;
+	}
+
+	return write_embed_len(to_emit, name, size);
+}
+
+int embed_file(struct c_gen *to_emit, const char *name, const char *path,
+	       enum c_embed_mode mode, size_t per_line,
+	       enum c_array_radix radix)
+{
+	struct array_lines lines = {
+		.type = C_ARRAY_U8, .radix = radix, .per_line = per_line
+	};
+	struct stat file_stat;
+	size_t size = UNKNOWN_LEN;
+	int fd, ret;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &file_stat)) {
+		int open_errno = errno;
+
+		printlg(ERROR_LEVEL, "Could not open %s to embed.\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		errno = open_errno;
+		return line_gen_fail(&to_emit->base_gen, -1);
+	}
+
+	if (mode == C_EMBED_INCBIN) {
+		if (S_ISREG(file_stat.st_mode)) {
+			size = file_stat.st_size;
+		}
+		ret = embed_incbin(to_emit, name, path, size);
+	} else {
+		/* files like those in /proc have a size of 0, but have bytes */
+		if (S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+			size = file_stat.st_size;
+		}
+		ret = embed_array(to_emit, name, &lines, fd, size);
+	}
+	close(fd);
+
+	return ret;
+}
@@ -0,0 +1,288 @@
+#include <c_shards.h>
+#include <logger.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+/* the shards log at the threshold of "struct c_gen" */
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/* the suffixes of the files of the shards and of the header */
+#define SHARD_SUFFIX	".c"
+#define HEADER_SUFFIX	".h"
+/* the most characters of the number of a shard, with its separator */
+#define MAX_SHARD_NUM_LEN	21
+/* the lines around the header, which keep it from being included twice */
+#define IFNDEF_FMT	"#ifndef %s"
+#define DEFINE_FMT	"#define %s"
+#define ENDIF_FMT	"#endif /* %s */"
+
+/*
+ * Write the name of the include guard of the header,
+ * ie. its file name in upper case, with every other character as '_'
+ * guard:	where to write the name, of "strlen(header_name) + 2" characters
+ * header_name:	the file name of the header
+ */
+static void guard_name(char *guard, const char *header_name)
+{
+	size_t char_i = 0;
+
+	/* identifiers cannot start with a digit */
+	if (isdigit((unsigned char) header_name[0])) {
+		guard[char_i++] = '_';
+	}
+	for (; *header_name != '\0'; header_name++) {
+		guard[char_i++] = isalnum((unsigned char) *header_name) ?
+				  toupper((unsigned char) *header_name) : '_';
+	}
+	guard[char_i] = '\0';
+}
+
+/*
+ * Write the start or the end of the include guard of the header
+ * shards:	the shards whose header to write to
+ * end:		nonzero to write the end of the guard, after the prototypes
+ * returns	0 iff successful, -1 if writing failed, with errno set
+ */
+static int write_guard(struct c_shards *shards, int end)
+{
+	struct line_gen *header = &shards->header.base_gen;
+	char guard[strlen(shards->header_name) + 2];
+
+	guard_name(guard, shards->header_name);
+	if (end) {
+		return finish_line(header) ||
+		       line_gen_printf(header, ENDIF_FMT, guard) < 0 ||
+		       finish_line(header) ? -1 : 0;
+	}
+
+	return line_gen_printf(header, IFNDEF_FMT, guard) < 0 ||
+	       finish_line(header) ||
+	       line_gen_printf(header, DEFINE_FMT, guard) < 0 ||
+	       finish_line(header) || finish_line(header) ? -1 : 0;
+}
+
+/*
+ * Close and release every shard opened so far
+ * shards:	the shards to close
+ * n_open:	the number of shards opened
+ * returns	the first failure of closing a shard, or 0
+ */
+static int close_shards(struct c_shards *shards, size_t n_open)
+{
+	size_t shard_i;
+	int ret = 0, close_ret;
+
+	for (shard_i = 0; shard_i < n_open; shard_i++) {
+		if ((close_ret = close_c_gen(&shards->shards[shard_i])) &&
+		    ret == 0) {
+			ret = close_ret;
+		}
+	}
+	free(shards->shards);
+	free(shards->loads);
+	shards->shards = NULL;
+	shards->loads = NULL;
+
+	return ret;
+}
+
+int c_shards_open(struct c_shards *shards, const char *prefix,
+		  size_t n_shards)
+{
+	size_t prefix_len = strlen(prefix), shard_i;
+	char path[prefix_len + MAX_SHARD_NUM_LEN + sizeof(SHARD_SUFFIX)];
+	const char *base_name = strrchr(prefix, '/');
+	struct line_sink sink;
+
+	if (n_shards == 0) {
+		printlg(ERROR_LEVEL, "Cannot write 0 shards.\n");
+		errno = EINVAL;
+		return -1;
+	}
+	base_name = base_name == NULL ? prefix : base_name + 1;
+	shards->n_shards = n_shards;
+	shards->prelude_done = 0;
+	shards->current = NULL;
+	shards->shards = calloc(n_shards, sizeof(*shards->shards));
+	shards->loads = calloc(n_shards, sizeof(*shards->loads));
+	shards->header_name = malloc(strlen(base_name) +
+				     sizeof(HEADER_SUFFIX));
+	if (shards->shards == NULL || shards->loads == NULL ||
+	    shards->header_name == NULL) {
+		printlg(ERROR_LEVEL, "Could not allocate shards.\n");
+		goto free_shards;
+	}
+	sprintf(shards->header_name, "%s" HEADER_SUFFIX, base_name);
+
+	for (shard_i = 0; shard_i < n_shards; shard_i++) {
+		sprintf(path, "%s_%lu" SHARD_SUFFIX, prefix,
+			(unsigned long) shard_i);
+		if (open_c_gen(&shards->shards[shard_i], path)) {
+			printlg(ERROR_LEVEL, "Could not open %s.\n", path);
+			goto close_shards;
+		}
+	}
+	sprintf(path, "%s" HEADER_SUFFIX, prefix);
+	if (open_c_gen(&shards->header, path)) {
+		printlg(ERROR_LEVEL, "Could not open %s.\n", path);
+		goto close_shards;
+	}
+	if (line_sink_mem(&sink, 0)) {
+		printlg(ERROR_LEVEL, "Could not allocate prelude.\n");
+		goto close_header;
+	}
+	init_c_gen_sink(&shards->prelude, &sink);
+	if (write_guard(shards, 0)) {
+		printlg(ERROR_LEVEL, "Could not start %s.\n", path);
+		goto close_prelude;
+	}
+
+	return 0;
+
+close_prelude:
+	close_c_gen(&shards->prelude);
+	line_sink_mem_free(&shards->prelude.base_gen.sink);
+close_header:
+	close_c_gen(&shards->header);
+close_shards:
+	{
+		int open_errno = errno;
+
+		close_shards(shards, shard_i);
+		errno = open_errno;
+	}
+free_shards:
+	free(shards->shards);
+	free(shards->loads);
+	free(shards->header_name);
+	shards->shards = NULL;
+	shards->loads = NULL;
+	shards->header_name = NULL;
+	return -1;
+}
+
+/*
+ * Copy the prelude to the start of every shard,
+ * followed by the inclusion of the header
+ * shards:	the shards to copy the prelude to
+ * returns	0 iff successful;
+ *		-1 if writing failed, with errno set
+ *		-2 if writing the prelude failed for another reason
+ */
+static int copy_prelude(struct c_shards *shards)
+{
+	struct line_gen *prelude = &shards->prelude.base_gen;
+	int on_new_line = prelude->on_new_line;
+	int ret = close_c_gen(&shards->prelude);
+	size_t len, shard_i;
+	const char *text = line_sink_mem_data(&prelude->sink, &len);
+
+	if (ret == 0) {
+		ret = line_gen_error(prelude);
+	}
+	shards->prelude_done = 1;
+	for (shard_i = 0; ret == 0 && shard_i < shards->n_shards; shard_i++) {
+		struct c_gen *shard = &shards->shards[shard_i];
+
+		if (len > 0 &&
+		    line_gen_write_len(text, len, &shard->base_gen)) {
+			ret = -1;
+			break;
+		}
+		/* the prelude already indented any line it left open */
+		shard->base_gen.on_new_line = on_new_line;
+		if ((!on_new_line && finish_line(&shard->base_gen)) ||
+		    include_local(shard, shards->header_name) ||
+		    finish_line(&shard->base_gen)) {
+			ret = -1;
+		}
+	}
+	line_sink_mem_free(&prelude->sink);
+	if (ret) {
+		printlg(ERROR_LEVEL, "Could not copy prelude to shards.\n");
+	}
+
+	return ret;
+}
+
+struct c_gen *c_shards_start_function(struct c_shards *shards)
+{
+	size_t shard_i, least_i = 0;
+
+	if (shards->current != NULL) {
+		printlg(ERROR_LEVEL, "Function already started in shard.\n");
+		errno = EINVAL;
+		return NULL;
+	}
+	if (!shards->prelude_done && copy_prelude(shards)) {
+		return NULL;
+	}
+
+	for (shard_i = 1; shard_i < shards->n_shards; shard_i++) {
+		if (shards->loads[shard_i] < shards->loads[least_i]) {
+			least_i = shard_i;
+		}
+	}
+	shards->current = &shards->shards[least_i];
+	shards->current->protos = &shards->header;
+	line_gen_checkpoint(&shards->current->base_gen, &shards->start);
+
+	return shards->current;
+}
+
+int c_shards_end_function(struct c_shards *shards)
+{
+	struct line_gen *shard;
+	size_t len;
+	int ret;
+
+	if (shards->current == NULL) {
+		printlg(ERROR_LEVEL, "No function started in shard.\n");
+		errno = EINVAL;
+		return -1;
+	}
+	shard = &shards->current->base_gen;
+	len = shard->buf_used - shards->start.buf_used;
+	shards->loads[shards->current - shards->shards] += len;
+	shards->current->protos = NULL;
+	shards->current = NULL;
+
+	if ((ret = line_gen_error(shard))) {
+		printlg(ERROR_LEVEL, "Could not write function to shard.\n");
+	}
+	line_gen_commit(shard, &shards->start);
+
+	return ret;
+}
+
+int c_shards_close(struct c_shards *shards)
+{
+	int ret = 0, close_ret;
+
+	if (shards->current != NULL) {
+		printlg(WARNING_LEVEL, "Ending function left in shard.\n");
+		ret = c_shards_end_function(shards);
+	}
+	if (!shards->prelude_done && (close_ret = copy_prelude(shards)) &&
+	    ret == 0) {
+		ret = close_ret;
+	}
+	if ((close_ret = close_shards(shards, shards->n_shards)) && ret == 0) {
+		ret = close_ret;
+	}
+	if ((close_ret = write_guard(shards, 1)) && ret == 0) {
+		ret = close_ret;
+	}
+	if ((close_ret = close_c_gen(&shards->header)) && ret == 0) {
+		ret = close_ret;
+	}
+	free(shards->header_name);
+	shards->header_name = NULL;
+
+	return ret;
+}
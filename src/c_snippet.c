@@ -0,0 +1,212 @@
+#include <c_snippet.h>
+#include <logger.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* snippets log at the threshold of "struct c_gen" */
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/*
+ * the character indenting the recorded text, one per depth,
+ * which is not expected at the start of any line of C code,
+ * so that the depth of each line can be read back from the text
+ */
+#define RECORD_INDENT_CHAR	'\001'
+
+/*
+ * Count the lines of recorded text
+ * text:	the recorded text
+ * len:		the number of bytes of text
+ * returns	the number of lines, including an unfinished last line
+ */
+static size_t count_lines(const char *text, size_t len)
+{
+	const char *end = text + len;
+	size_t n_lines = 0;
+
+	while (text < end) {
+		const char *line_end = memchr(text, LINE_BREAK_STR[0],
+					      end - text);
+
+		n_lines++;
+		if (line_end == NULL) {
+			break;
+		}
+		text = line_end + LINE_BREAK_LEN;
+	}
+
+	return n_lines;
+}
+
+/*
+ * Split recorded text into lines, moving the text of each line
+ * after the text of the one before, without its indentation
+ * snippet:	the snippet to fill in, with the recorded text in "text",
+ *		and room for every line in "lines"
+ * len:		the number of bytes of recorded text
+ */
+static void split_lines(struct c_snippet *snippet, size_t len)
+{
+	char *text = snippet->text;
+	size_t read_pos = 0, write_pos = 0;
+
+	snippet->n_lines = 0;
+	snippet->n_indented = 0;
+	snippet->depth_sum = 0;
+	snippet->max_depth = snippet->end_depth;
+	while (read_pos < len) {
+		struct c_snippet_line *line =
+			&snippet->lines[snippet->n_lines++];
+		const char *line_end;
+		size_t depth = 0, line_len;
+
+		while (read_pos + depth < len &&
+		       text[read_pos + depth] == RECORD_INDENT_CHAR) {
+			depth++;
+		}
+		read_pos += depth;
+		line_end = memchr(text + read_pos, LINE_BREAK_STR[0],
+				  len - read_pos);
+		line_len = line_end == NULL ? len - read_pos :
+			   (size_t) (line_end - (text + read_pos)) +
+			   LINE_BREAK_LEN;
+
+		line->start = write_pos;
+		line->len = line_len;
+		line->depth = depth;
+		line->indented = depth > 0 || line_end != text + read_pos;
+		if (line->indented) {
+			snippet->n_indented++;
+			snippet->depth_sum += depth;
+		}
+		if (depth > snippet->max_depth) {
+			snippet->max_depth = depth;
+		}
+
+		memmove(text + write_pos, text + read_pos, line_len);
+		read_pos += line_len;
+		write_pos += line_len;
+	}
+	snippet->len = write_pos;
+}
+
+/*
+ * Render a snippet at every depth it can be written at without
+ * going past MAX_C_INDENTS, in the default indentation style
+ * snippet:	the snippet to render, split into lines
+ * returns	0 iff successful, -1 if allocating failed
+ */
+static int render(struct c_snippet *snippet)
+{
+	size_t depth, line_i, total = 0;
+	char *dst;
+
+	snippet->n_rendered = snippet->max_depth <= MAX_C_INDENTS ?
+			      MAX_C_INDENTS - snippet->max_depth + 1 : 0;
+	for (depth = 0; depth < snippet->n_rendered; depth++) {
+		snippet->rendered_at[depth] = total;
+		total += snippet->len + (snippet->n_indented * depth +
+					 snippet->depth_sum) * INDENT_WIDTH;
+	}
+	snippet->rendered_at[snippet->n_rendered] = total;
+	if (total == 0) {
+		return 0;
+	}
+	if ((snippet->rendered = malloc(total)) == NULL) {
+		return -1;
+	}
+
+	dst = snippet->rendered;
+	for (depth = 0; depth < snippet->n_rendered; depth++) {
+		for (line_i = 0; line_i < snippet->n_lines; line_i++) {
+			const struct c_snippet_line *line =
+				&snippet->lines[line_i];
+
+			if (line->indented) {
+				size_t indent_len = (depth + line->depth) *
+						    INDENT_WIDTH;
+
+				memset(dst, INDENT_CHAR, indent_len);
+				dst += indent_len;
+			}
+			memcpy(dst, snippet->text + line->start, line->len);
+			dst += line->len;
+		}
+	}
+
+	return 0;
+}
+
+int c_snippet_record(struct c_snippet *snippet, c_snippet_recorder recorder,
+		     void *arg)
+{
+	struct line_sink sink;
+	struct c_gen recording;
+	size_t len;
+	int ret;
+
+	snippet->text = NULL;
+	snippet->lines = NULL;
+	snippet->n_lines = 0;
+	snippet->len = 0;
+	snippet->n_indented = 0;
+	snippet->depth_sum = 0;
+	snippet->max_depth = 0;
+	snippet->end_depth = 0;
+	snippet->end_on_new_line = 1;
+	snippet->rendered = NULL;
+	snippet->n_rendered = 0;
+
+	if (line_sink_mem(&sink, 0)) {
+		printlg(ERROR_LEVEL, "Could not allocate snippet.\n");
+		return -1;
+	}
+	init_c_gen_sink(&recording, &sink);
+	if (line_gen_set_indent(&recording.base_gen, RECORD_INDENT_CHAR, 1)) {
+		ret = -1;
+	} else {
+		ret = recorder(&recording, arg);
+	}
+	snippet->end_depth = recording.base_gen.indent;
+	snippet->end_on_new_line = recording.base_gen.on_new_line;
+	if (close_c_gen(&recording) || line_gen_error(&recording.base_gen)) {
+		ret = -1;
+	}
+	snippet->text = line_sink_mem_take(&recording.base_gen.sink, &len);
+	if (ret) {
+		printlg(ERROR_LEVEL, "Could not record snippet.\n");
+		c_snippet_free(snippet);
+		return -1;
+	}
+
+	if (len > 0 &&
+	    (snippet->lines = malloc(count_lines(snippet->text, len) *
+				     sizeof(*snippet->lines))) == NULL) {
+		printlg(ERROR_LEVEL, "Could not allocate snippet lines.\n");
+		c_snippet_free(snippet);
+		return -1;
+	}
+	split_lines(snippet, len);
+	if (render(snippet)) {
+		printlg(ERROR_LEVEL, "Could not allocate rendered snippet.\n");
+		c_snippet_free(snippet);
+		return -1;
+	}
+
+	return 0;
+}
+
+void c_snippet_free(struct c_snippet *snippet)
+{
+	free(snippet->text);
+	free(snippet->lines);
+	free(snippet->rendered);
+	snippet->text = NULL;
+	snippet->lines = NULL;
+	snippet->rendered = NULL;
+	snippet->n_lines = 0;
+	snippet->n_rendered = 0;
+}
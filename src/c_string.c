@@ -0,0 +1,261 @@
+/*
+ * String literals escaped in a single pass, with the runs of bytes
+ * that need no escaping found 16 bytes at a time with SSE2,
+ * where available, and copied in bulk.
+ */
+#include <c_gen.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/* the quote around a string literal */
+#define QUOTE		'"'
+/* the start of an escape sequence */
+#define BACKSLASH	'\\'
+/* the character of the trigraphs, which "??" would start */
+#define QUESTION	'?'
+/* the first printable ASCII character, and the last one, before DEL */
+#define FIRST_PRINTABLE	' '
+#define LAST_PRINTABLE	'~'
+/* the longest escape of a byte, an octal one, eg. "\303" */
+#define MAX_ESCAPE_LEN	4
+/* the fewest characters on a line of a split literal, however deep */
+#define MIN_PIECE_LEN	16
+
+/*
+ * Check whether a byte of a string is not written as is in its literal
+ * c:		the byte
+ * returns	nonzero iff the byte is escaped, or may be
+ */
+static inline int is_rare(unsigned char c)
+{
+	return c < FIRST_PRINTABLE || c > LAST_PRINTABLE || c == QUOTE ||
+	       c == BACKSLASH || c == QUESTION;
+}
+
+/*
+ * Measure the run of bytes at the start of a string
+ * that are written to its literal as they are
+ * bytes:	the string
+ * len:		the most bytes to look at
+ * returns	the number of bytes before the first that "is_rare",
+ *		or "len" if there is none
+ */
+static inline size_t clean_run(const char *bytes, size_t len)
+{
+	size_t byte_i = 0;
+
+#ifdef __SSE2__
+	const __m128i space = _mm_set1_epi8(FIRST_PRINTABLE);
+	const __m128i del = _mm_set1_epi8(LAST_PRINTABLE + 1);
+	const __m128i quote = _mm_set1_epi8(QUOTE);
+	const __m128i backslash = _mm_set1_epi8(BACKSLASH);
+	const __m128i question = _mm_set1_epi8(QUESTION);
+
+	for (; byte_i + sizeof(__m128i) <= len; byte_i += sizeof(__m128i)) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)
+						(bytes + byte_i));
+		/* as signed bytes, those above DEL are negative too */
+		__m128i rare = _mm_cmplt_epi8(chunk, space);
+		int mask;
+
+		rare = _mm_or_si128(rare, _mm_cmpeq_epi8(chunk, del));
+		rare = _mm_or_si128(rare, _mm_cmpeq_epi8(chunk, quote));
+		rare = _mm_or_si128(rare, _mm_cmpeq_epi8(chunk, backslash));
+		rare = _mm_or_si128(rare, _mm_cmpeq_epi8(chunk, question));
+		if ((mask = _mm_movemask_epi8(rare)) != 0) {
+			return byte_i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	while (byte_i < len && !is_rare(bytes[byte_i])) {
+		byte_i++;
+	}
+
+	return byte_i;
+}
+
+/*
+ * Write the escape of a byte that "is_rare"
+ * dst:		where to write the escape,
+ *		with room for MAX_ESCAPE_LEN characters
+ * bytes:	the string
+ * byte_i:	the index of the byte in the string
+ * returns	the number of characters written
+ */
+static inline size_t escape_byte(char *dst, const char *bytes, size_t byte_i)
+{
+	unsigned char c = bytes[byte_i];
+
+	dst[0] = BACKSLASH;
+	switch (c) {
+	case '\n':
+		dst[1] = 'n';
+		return 2;
+	case '\t':
+		dst[1] = 't';
+		return 2;
+	case '\r':
+		dst[1] = 'r';
+		return 2;
+	case QUOTE:
+	case BACKSLASH:
+		dst[1] = c;
+		return 2;
+	case QUESTION:
+		/* "??" followed by some characters is a trigraph */
+		if (byte_i > 0 && bytes[byte_i - 1] == QUESTION) {
+			dst[1] = c;
+			return 2;
+		}
+		dst[0] = c;
+		return 1;
+	default:
+		/* three digits, so that digits after it are not taken in */
+		dst[1] = '0' + (c >> 6);
+		dst[2] = '0' + ((c >> 3) & 7);
+		dst[3] = '0' + (c & 7);
+		return 4;
+	}
+}
+
+/*
+ * Escape the bytes of one line of a literal, up to a line break in them,
+ * or as many as fit
+ * dst:		where to write the escaped bytes,
+ *		with room for "width" characters
+ * bytes:	the string
+ * pos:		the index of the first byte to escape,
+ *		which is updated to the index of the first byte left
+ * len:		the number of bytes of the string
+ * width:	the most characters to write,
+ *		which must be at least MAX_ESCAPE_LEN
+ * returns	the number of characters written
+ */
+static size_t escape_piece(char *dst, const char *bytes, size_t *pos,
+			   size_t len, size_t width)
+{
+	size_t byte_i = *pos, out = 0;
+
+	while (byte_i < len) {
+		size_t room = width - out, run;
+
+		run = clean_run(bytes + byte_i,
+				len - byte_i < room ? len - byte_i : room);
+		memcpy(dst + out, bytes + byte_i, run);
+		out += run;
+		byte_i += run;
+		if (byte_i == len || out + MAX_ESCAPE_LEN > width) {
+			break;
+		}
+
+		out += escape_byte(dst + out, bytes, byte_i);
+		/* the rest of the text starts the next line of the literal */
+		if (bytes[byte_i++] == '\n') {
+			break;
+		}
+	}
+	*pos = byte_i;
+
+	return out;
+}
+
+/*
+ * Measure the columns already taken on the current line
+ * base:	the generator of the line
+ * returns	the number of columns, counting the indentation of the
+ *		current depth at the start of the line as C_TAB_WIDTH columns
+ *		per tab
+ */
+static size_t line_columns(const struct line_gen *base)
+{
+	size_t tabs = base->indent_char != '\t' ? 0 :
+		      base->indent * base->indent_width;
+
+	if (tabs > base->col) {
+		tabs = base->col;
+	}
+
+	return base->col + tabs * (C_TAB_WIDTH - 1);
+}
+
+int emit_string_literal(struct c_gen *to_emit, const char *bytes,
+			size_t len)
+{
+	struct line_gen *base = &to_emit->base_gen;
+	int own_lines = base->on_new_line;
+	size_t depth, indent_len, indent_cols, width, line_cols, pos = 0;
+
+	if (try_start_line(base)) {
+		printlg(ERROR_LEVEL, "Could not indent string literal.\n");
+		return line_gen_fail(base, -1);
+	}
+	line_cols = own_lines ? 0 : line_columns(base);
+	/* a literal that starts a line keeps its depth on the next lines */
+	depth = own_lines || base->indent >= base->max_indent ?
+		base->indent : base->indent + 1;
+	if (line_gen_cover_indent(base, depth)) {
+		return line_gen_fail(base, -1);
+	}
+	indent_len = depth * base->indent_width;
+	indent_cols = indent_len *
+		      (base->indent_char == '\t' ? C_TAB_WIDTH : 1);
+	/* the quotes, and a comma or semicolon after the literal */
+	width = indent_cols + 3 + MIN_PIECE_LEN < MAX_C_CHARS_PER_LINE ?
+		MAX_C_CHARS_PER_LINE - indent_cols - 3 : MIN_PIECE_LEN;
+
+	do {
+		int first = pos == 0;
+		/* room for the line break and indentation before the piece */
+		size_t gap = first && own_lines ? 0 :
+			     LINE_BREAK_LEN + indent_len;
+		size_t piece_len;
+		char *dst, *piece, *line;
+
+		if ((dst = line_gen_reserve(base, gap + 2 + width)) == NULL) {
+			printlg(ERROR_LEVEL,
+				"Could not write string literal.\n");
+			return -1;
+		}
+		piece = dst + gap;
+		piece[0] = QUOTE;
+		piece_len = escape_piece(piece + 1, bytes, &pos, len, width);
+		piece[1 + piece_len] = QUOTE;
+		piece_len += 2;
+
+		line = dst;
+		if (first && (own_lines ||
+			      (pos == len && line_cols + piece_len + 1 <=
+					     MAX_C_CHARS_PER_LINE))) {
+			/* the first piece stays on the current line */
+			gap = 0;
+		} else if (first && base->buf_used > 0 && dst[-1] == ' ') {
+			/*
+			 * leave no space at the end of the line before,
+			 * which stays staged however the buffer was drained
+			 */
+			line--;
+		}
+		if (gap > 0) {
+			memcpy(line, LINE_BREAK_STR, LINE_BREAK_LEN);
+			if (indent_len > 0) {
+				memcpy(line + LINE_BREAK_LEN, base->indent_run,
+				       indent_len);
+			}
+			LINE_GEN_COUNT(base, n_lines, 1);
+			LINE_GEN_COUNT(base, n_indent_bytes, indent_len);
+		}
+		memmove(line + gap, piece, piece_len);
+		line_gen_advance(base, line + gap + piece_len - dst);
+		if (gap > 0) {
+			/* the line break may be where the space was */
+			base->col = indent_len + piece_len;
+		}
+	} while (pos < len);
+
+	return 0;
+}
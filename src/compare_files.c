@@ -1,53 +1,242 @@
 #include <compare_files.h>
 #include <logger.h>
 
-#define FILE_BLOCK_SIZE	1024
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-int files_equal(FILE *in_0, FILE *in_1)
+/*
+ * the minimum level of the log statements of the file comparison,
+ * below which they are compiled out
+ */
+#ifndef COMPARE_FILES_LOG_LEVEL
+#define COMPARE_FILES_LOG_LEVEL	DISP_LEVEL
+#endif
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	COMPARE_FILES_LOG_LEVEL
+
+/* the number of bytes compared with one memcmp, or read at a time */
+#define FILE_BLOCK_SIZE	(64 * 1024)
+
+/* a file mapped into memory, from its current position */
+struct mapped_file {
+	char *map; /* the start of the mapping, or NULL if the file is empty */
+	size_t map_len; /* the length of the mapping */
+	const char *data; /* the contents from the current position */
+	size_t len; /* the number of bytes from the current position */
+};
+
+/* the position reached in text that has been compared so far */
+struct text_pos {
+	size_t offset; /* the number of bytes compared */
+	size_t line; /* the number of line breaks compared */
+	size_t line_start; /* the offset just after the last line break */
+};
+
+/*
+ * Map a regular file into memory
+ * in:		the file to map
+ * mapped:	set to the mapping, if successful
+ * returns	1 iff the file was mapped,
+ *		0 if it cannot be, eg. because it is a pipe
+ */
+static int map_file(FILE *in, struct mapped_file *mapped)
 {
-	size_t total_read = 0;
-	int have_bytes = 1;
-	int ret = 1;
-
-	while (have_bytes) {
-		char buf_0[FILE_BLOCK_SIZE], buf_1[FILE_BLOCK_SIZE];
-		size_t read_0, read_1;
-
-		read_0 = fread(buf_0, 1, FILE_BLOCK_SIZE, in_0);
-		read_1 = fread(buf_1, 1, FILE_BLOCK_SIZE, in_1);
-
-		/* check if a file stopped early */
-		if (read_0 < FILE_BLOCK_SIZE || read_1 < FILE_BLOCK_SIZE) {
-			if (read_0 != read_1) {
-				printlg(INFO_LEVEL,
-					"Unequal length read: %u vs. %u.\n",
-					(unsigned) (total_read + read_0),
-					(unsigned) (total_read + read_1));
-				ret = 0;
-			}
-			if (read_0 == 0) {
-				have_bytes = 0;
-			}
+	int fd = fileno(in);
+	struct stat in_stat;
+	off_t pos;
+
+	if (fd < 0 || fstat(fd, &in_stat) || !S_ISREG(in_stat.st_mode) ||
+	    (pos = ftello(in)) < 0 || pos > in_stat.st_size) {
+		return 0;
+	}
+
+	mapped->map = NULL;
+	mapped->map_len = in_stat.st_size;
+	if (mapped->map_len > 0) {
+		mapped->map = mmap(NULL, mapped->map_len, PROT_READ,
+				   MAP_PRIVATE, fd, 0);
+		if (mapped->map == MAP_FAILED) {
+			printlg(DEBUG_LEVEL, "Could not map file: %d.\n",
+				errno);
+			return 0;
 		}
-		if (have_bytes) {
-			size_t byte_i;
-
-			for (byte_i = 0; byte_i < read_0; byte_i++) {
-				if (buf_0[byte_i] != buf_1[byte_i]) {
-					printlg(INFO_LEVEL,
-						"Mismatch at %u: "
-						"%c != %c.\n",
-						(unsigned)
-						(total_read + byte_i),
-						buf_0[byte_i], buf_1[byte_i]);
-					have_bytes = 0;
-					ret = 0;
-				}
+		madvise(mapped->map, mapped->map_len, MADV_SEQUENTIAL);
+	}
+	mapped->data = mapped->map + pos;
+	mapped->len = mapped->map_len - pos;
+
+	return 1;
+}
+
+/*
+ * Release a mapped file
+ * mapped:	the mapping to release
+ */
+static void unmap_file(struct mapped_file *mapped)
+{
+	if (mapped->map != NULL) {
+		munmap(mapped->map, mapped->map_len);
+	}
+}
+
+/*
+ * Find the first differing byte in two buffers,
+ * comparing whole blocks with memcmp,
+ * and only scanning bytes within the first block that differs
+ * buf_0:	the first buffer
+ * buf_1:	the second buffer
+ * len:		the number of bytes to compare
+ * returns	the offset of the first difference, or "len" if there is none
+ */
+static size_t first_mismatch(const char *buf_0, const char *buf_1, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		size_t block = len - done;
+
+		if (block > FILE_BLOCK_SIZE) {
+			block = FILE_BLOCK_SIZE;
+		}
+		if (memcmp(buf_0 + done, buf_1 + done, block)) {
+			while (buf_0[done] == buf_1[done]) {
+				done++;
 			}
+			return done;
+		}
+		done += block;
+	}
+
+	return len;
+}
+
+/*
+ * Move the position past equal bytes, counting their line breaks
+ * pos:		the position to move
+ * data:	the equal bytes
+ * len:		the number of equal bytes
+ */
+static void advance_pos(struct text_pos *pos, const char *data, size_t len)
+{
+	const char *line_end = data;
+	const char *end = data + len;
+
+	while ((line_end = memchr(line_end, '\n', end - line_end)) != NULL) {
+		line_end++;
+		pos->line++;
+		pos->line_start = pos->offset + (line_end - data);
+	}
+	pos->offset += len;
+}
 
-			total_read += read_0;
+/*
+ * Describe a position as the first difference
+ * pos:		the position of the first difference
+ * diff:	where to describe the difference, or NULL
+ */
+static void set_diff(const struct text_pos *pos, struct file_diff *diff)
+{
+	if (diff != NULL) {
+		diff->offset = pos->offset;
+		diff->line = pos->line + 1;
+		diff->column = pos->offset - pos->line_start + 1;
+	}
+}
+
+/*
+ * Compare two files by reading them in blocks
+ * in_0:	the first file to read
+ * in_1:	the second file to read
+ * diff:	set to the first difference, if the files differ
+ * returns	1 iff the files are equal, 0 if they differ, -1 on error
+ */
+static int stream_compare(FILE *in_0, FILE *in_1, struct file_diff *diff)
+{
+	struct text_pos pos = {0, 0, 0};
+	char *buf_0 = malloc(FILE_BLOCK_SIZE);
+	char *buf_1 = malloc(FILE_BLOCK_SIZE);
+	int ret = -1;
+
+	if (buf_0 == NULL || buf_1 == NULL) {
+		printlg(ERROR_LEVEL, "Could not allocate read buffers.\n");
+		free(buf_0);
+		free(buf_1);
+		return -1;
+	}
+
+	while (1) {
+		size_t read_0 = fread(buf_0, 1, FILE_BLOCK_SIZE, in_0);
+		size_t read_1 = fread(buf_1, 1, FILE_BLOCK_SIZE, in_1);
+		size_t common = read_0 < read_1 ? read_0 : read_1;
+		size_t equal_len;
+
+		if (ferror(in_0) || ferror(in_1)) {
+			printlg(ERROR_LEVEL,
+				"Could not read files to compare.\n");
+			break;
+		}
+
+		equal_len = first_mismatch(buf_0, buf_1, common);
+		advance_pos(&pos, buf_0, equal_len);
+		if (equal_len < common || read_0 != read_1) {
+			set_diff(&pos, diff);
+			ret = 0;
+			break;
+		}
+		if (read_0 == 0) {
+			ret = 1;
+			break;
 		}
 	}
 
+	free(buf_0);
+	free(buf_1);
+
 	return ret;
 }
+
+int files_compare(FILE *in_0, FILE *in_1, struct file_diff *diff)
+{
+	struct mapped_file mapped_0, mapped_1;
+	struct text_pos pos = {0, 0, 0};
+	size_t common, equal_len;
+
+	if (!map_file(in_0, &mapped_0)) {
+		return stream_compare(in_0, in_1, diff);
+	}
+	if (!map_file(in_1, &mapped_1)) {
+		unmap_file(&mapped_0);
+		return stream_compare(in_0, in_1, diff);
+	}
+
+	common = mapped_0.len < mapped_1.len ? mapped_0.len : mapped_1.len;
+	equal_len = first_mismatch(mapped_0.data, mapped_1.data, common);
+	if (equal_len < common || mapped_0.len != mapped_1.len) {
+		advance_pos(&pos, mapped_0.data, equal_len);
+		set_diff(&pos, diff);
+	}
+
+	unmap_file(&mapped_0);
+	unmap_file(&mapped_1);
+
+	return equal_len == common && mapped_0.len == mapped_1.len;
+}
+
+int files_equal(FILE *in_0, FILE *in_1)
+{
+	struct file_diff diff;
+	int ret = files_compare(in_0, in_1, &diff);
+
+	if (ret == 0) {
+		printlg(INFO_LEVEL,
+			"Files differ at byte %lu, line %lu, column %lu.\n",
+			(unsigned long) diff.offset, (unsigned long) diff.line,
+			(unsigned long) diff.column);
+	}
+
+	return ret == 1;
+}
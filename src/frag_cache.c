@@ -0,0 +1,522 @@
+#include <frag_cache.h>
+#include <logger.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* the fragment cache logs at the threshold of "struct c_gen" */
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+/* the suffix of the name of each cached fragment's file */
+#define FRAG_SUFFIX	".frag"
+/* the length of a fragment's file name, ie. the key in hex and the suffix */
+#define FRAG_NAME_LEN	(16 + sizeof(FRAG_SUFFIX) - 1)
+/* the first bytes of every cached fragment's file */
+#define FRAG_MAGIC	"LGFRAG2"
+/* the smallest capacity the entries grow to */
+#define MIN_ENTRIES	64
+/* the size of the staging buffer of a fragment emitted on a miss */
+#define FRAG_BUF_SIZE	4096
+
+/*
+ * the header of a cached fragment's file, which its text follows,
+ * written as is, so it is zeroed first, padding included
+ */
+struct frag_header {
+	char magic[sizeof(FRAG_MAGIC)]; /* FRAG_MAGIC */
+	unsigned long long key; /* the key of the fragment */
+	unsigned long long len; /* the number of bytes of text */
+	unsigned long long end_indent; /* the depth after the fragment */
+	unsigned long long max_depth; /* the deepest depth of the fragment */
+	unsigned long long indent_width; /* the indentation style */
+	char indent_char; /* the indentation style */
+};
+
+/*
+ * Read the realtime clock, which is comparable with file times
+ * returns	the time in nanoseconds
+ */
+static unsigned long long now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*
+ * Write the path of a fragment's file
+ * cache:	the cache holding the fragment
+ * key:		the key of the fragment
+ * path:	where to write the path,
+ *		of "strlen(cache->dir) + FRAG_NAME_LEN + 2" characters
+ */
+static void frag_path(const struct frag_cache *cache, unsigned long long key,
+		      char *path)
+{
+	sprintf(path, "%s/%016llx" FRAG_SUFFIX, cache->dir, key);
+}
+
+/*
+ * Find an entry by key
+ * cache:	the cache to search
+ * key:		the key to find
+ * pos:		set to the position of the entry,
+ *		or to where it would be inserted if there is none
+ * returns	1 iff the entry was found, else 0
+ */
+static int find_entry(const struct frag_cache *cache, unsigned long long key,
+		      size_t *pos)
+{
+	size_t low = 0, high = cache->n_entries;
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+
+		if (cache->entries[mid].key < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	*pos = low;
+
+	return low < cache->n_entries && cache->entries[low].key == key;
+}
+
+/*
+ * Insert an entry, keeping the entries sorted
+ * cache:	the cache to insert into
+ * pos:		the position of the entry, as found by "find_entry"
+ * entry:	the entry to insert
+ * returns	0 iff successful, -1 if allocating failed
+ */
+static int insert_entry(struct frag_cache *cache, size_t pos,
+			const struct frag_cache_entry *entry)
+{
+	if (cache->n_entries == cache->cap) {
+		size_t new_cap = cache->cap < MIN_ENTRIES ?
+				 MIN_ENTRIES : cache->cap * 2;
+		struct frag_cache_entry *new_entries =
+			realloc(cache->entries,
+				new_cap * sizeof(*new_entries));
+
+		if (new_entries == NULL) {
+			return -1;
+		}
+		cache->entries = new_entries;
+		cache->cap = new_cap;
+	}
+	memmove(&cache->entries[pos + 1], &cache->entries[pos],
+		(cache->n_entries - pos) * sizeof(*cache->entries));
+	cache->entries[pos] = *entry;
+	cache->n_entries++;
+	cache->n_bytes += entry->size;
+
+	return 0;
+}
+
+/*
+ * Remove an entry, and its file
+ * cache:	the cache to remove from
+ * pos:		the position of the entry
+ */
+static void remove_entry(struct frag_cache *cache, size_t pos)
+{
+	char path[strlen(cache->dir) + FRAG_NAME_LEN + 2];
+
+	frag_path(cache, cache->entries[pos].key, path);
+	if (unlink(path) && errno != ENOENT) {
+		printlg(WARNING_LEVEL, "Could not remove %s: %d.\n", path,
+			errno);
+	}
+	cache->n_bytes -= cache->entries[pos].size;
+	cache->n_entries--;
+	memmove(&cache->entries[pos], &cache->entries[pos + 1],
+		(cache->n_entries - pos) * sizeof(*cache->entries));
+}
+
+/*
+ * Evict the least recently used fragments
+ * until the cache has room for more bytes
+ * cache:	the cache to evict from
+ * room:	the number of bytes to make room for
+ */
+static void evict(struct frag_cache *cache, size_t room)
+{
+	while (cache->n_entries > 0 && cache->n_bytes + room >
+	       cache->max_bytes) {
+		size_t entry_i, lru_i = 0;
+
+		for (entry_i = 1; entry_i < cache->n_entries; entry_i++) {
+			if (cache->entries[entry_i].used_ns <
+			    cache->entries[lru_i].used_ns) {
+				lru_i = entry_i;
+			}
+		}
+		remove_entry(cache, lru_i);
+		cache->n_evictions++;
+	}
+}
+
+/*
+ * Compare entries by key, for qsort
+ */
+static int compare_entries(const void *entry_0, const void *entry_1)
+{
+	unsigned long long key_0 =
+		((const struct frag_cache_entry *) entry_0)->key;
+	unsigned long long key_1 =
+		((const struct frag_cache_entry *) entry_1)->key;
+
+	return (key_0 > key_1) - (key_0 < key_1);
+}
+
+/*
+ * Make an entry for every fragment's file in the folder
+ * cache:	the cache whose folder to read
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static int scan_dir(struct frag_cache *cache)
+{
+	DIR *dir = opendir(cache->dir);
+	struct dirent *file;
+	int ret = 0;
+
+	if (dir == NULL) {
+		return -1;
+	}
+	while (ret == 0 && (file = readdir(dir)) != NULL) {
+		struct frag_cache_entry entry;
+		struct stat file_stat;
+		char *key_end;
+
+		if (strlen(file->d_name) != FRAG_NAME_LEN ||
+		    strcmp(file->d_name + 16, FRAG_SUFFIX)) {
+			continue;
+		}
+		entry.key = strtoull(file->d_name, &key_end, 16);
+		if (key_end != file->d_name + 16 ||
+		    fstatat(dirfd(dir), file->d_name, &file_stat, 0) ||
+		    !S_ISREG(file_stat.st_mode)) {
+			continue;
+		}
+		entry.size = file_stat.st_size;
+		entry.used_ns = file_stat.st_mtim.tv_sec * 1000000000ULL +
+				file_stat.st_mtim.tv_nsec;
+		ret = insert_entry(cache, cache->n_entries, &entry);
+	}
+	closedir(dir);
+
+	if (cache->n_entries > 0) {
+		qsort(cache->entries, cache->n_entries,
+		      sizeof(*cache->entries), compare_entries);
+	}
+
+	return ret;
+}
+
+int frag_cache_open(struct frag_cache *cache, const char *dir,
+		    size_t max_bytes)
+{
+	cache->max_bytes = max_bytes;
+	cache->n_bytes = 0;
+	cache->entries = NULL;
+	cache->n_entries = 0;
+	cache->cap = 0;
+	cache->n_hits = 0;
+	cache->n_misses = 0;
+	cache->n_evictions = 0;
+
+	if ((cache->dir = strdup(dir)) == NULL) {
+		printlg(ERROR_LEVEL, "Could not copy the cache path.\n");
+		return -1;
+	}
+	if ((mkdir(dir, 0777) && errno != EEXIST) || scan_dir(cache)) {
+		int open_errno = errno;
+
+		printlg(ERROR_LEVEL, "Could not open fragment cache %s: %d.\n",
+			dir, errno);
+		frag_cache_close(cache);
+		errno = open_errno;
+		return -1;
+	}
+	evict(cache, 0);
+
+	return 0;
+}
+
+void frag_cache_close(struct frag_cache *cache)
+{
+	free(cache->dir);
+	free(cache->entries);
+	cache->dir = NULL;
+	cache->entries = NULL;
+	cache->n_entries = 0;
+	cache->cap = 0;
+}
+
+/*
+ * Write text emitted at depth 0 to a generator at its own depth,
+ * indenting every line that is not blank
+ * out:		the generator to write to
+ * header:	the header of the text, with its length and depths
+ * text:	the text, of which every line but the last ends in a line break
+ * returns	0 iff successful;
+ *		-1 if writing failed, with errno set
+ *		-2 if the text would reach past "max_indent"
+ */
+static int splice_text(struct line_gen *out, const struct frag_header *header,
+		       const char *text)
+{
+	const char *end = text + header->len;
+
+	if (header->max_depth > out->max_indent ||
+	    out->indent > out->max_indent - header->max_depth) {
+		printlg(ERROR_LEVEL, "Fragment reaches past depth %u.\n",
+			(unsigned) out->max_indent);
+		return line_gen_fail(out, -2);
+	}
+	if (line_gen_cover_indent(out, out->indent + header->max_depth)) {
+		return line_gen_fail(out, -1);
+	}
+
+	while (text < end) {
+		const char *line_end = memchr(text, LINE_BREAK_STR[0],
+					      end - text);
+		size_t line_len = (line_end == NULL ? end : line_end) - text;
+
+		if (line_len > 0 && line_gen_write_len(text, line_len, out)) {
+			return line_gen_fail(out, -1);
+		}
+		if (line_end == NULL) {
+			break;
+		}
+		if (finish_line(out)) {
+			return line_gen_fail(out, -1);
+		}
+		text = line_end + LINE_BREAK_LEN;
+	}
+	out->indent += header->end_indent;
+
+	return 0;
+}
+
+/*
+ * Read a cached fragment's file
+ * cache:	the cache holding the fragment
+ * key:		the key of the fragment
+ * header:	set to the header of the file
+ * returns	the text of the fragment, to be released with free,
+ *		or NULL if it could not be read, or is malformed
+ */
+static char *read_frag(const struct frag_cache *cache, unsigned long long key,
+		       struct frag_header *header)
+{
+	char path[strlen(cache->dir) + FRAG_NAME_LEN + 2];
+	char *text = NULL;
+	FILE *in;
+
+	frag_path(cache, key, path);
+	if ((in = fopen(path, "rb")) == NULL) {
+		return NULL;
+	}
+	if (fread(header, sizeof(*header), 1, in) == 1 &&
+	    !memcmp(header->magic, FRAG_MAGIC, sizeof(FRAG_MAGIC)) &&
+	    header->key == key &&
+	    (text = malloc(header->len + 1)) != NULL &&
+	    (fread(text, 1, header->len + 1, in) != header->len ||
+	     !feof(in))) {
+		free(text);
+		text = NULL;
+	}
+	fclose(in);
+
+	return text;
+}
+
+/*
+ * Write a fragment's file, through a temporary file
+ * cache:	the cache to write to
+ * header:	the header of the fragment
+ * text:	the text of the fragment
+ * returns	0 iff successful, -1 otherwise
+ */
+static int write_frag(const struct frag_cache *cache,
+		      const struct frag_header *header, const char *text)
+{
+	char path[strlen(cache->dir) + FRAG_NAME_LEN + 2];
+	char tmp_path[sizeof(path) + 32];
+	FILE *out;
+	int ret = 0;
+
+	frag_path(cache, header->key, path);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path,
+		 (long) getpid());
+	if ((out = fopen(tmp_path, "wb")) == NULL) {
+		return -1;
+	}
+	if (fwrite(header, sizeof(*header), 1, out) != 1 ||
+	    (header->len > 0 && fwrite(text, header->len, 1, out) != 1)) {
+		ret = -1;
+	}
+	if (fclose(out) || (ret == 0 && rename(tmp_path, path))) {
+		ret = -1;
+	}
+	if (ret) {
+		unlink(tmp_path);
+	}
+
+	return ret;
+}
+
+/*
+ * Look up a fragment, and write it to a generator if it is cached
+ * in the same indentation style
+ * cache:	the cache to look up
+ * out:		the generator to write the fragment to
+ * key:		the key of the fragment
+ * returns	1 iff the fragment was cached and written,
+ *		0 if it is not cached,
+ *		or the return of "splice_text" if writing it failed
+ */
+static int try_hit(struct frag_cache *cache, struct line_gen *out,
+		   unsigned long long key)
+{
+	char path[strlen(cache->dir) + FRAG_NAME_LEN + 2];
+	struct frag_header header;
+	char *text;
+	size_t pos;
+	int ret;
+
+	if (!find_entry(cache, key, &pos)) {
+		return 0;
+	}
+	if ((text = read_frag(cache, key, &header)) == NULL) {
+		printlg(WARNING_LEVEL,
+			"Dropping unreadable fragment %016llx.\n", key);
+		remove_entry(cache, pos);
+		return 0;
+	}
+	if (header.indent_char != out->indent_char ||
+	    header.indent_width != out->indent_width) {
+		free(text);
+		return 0;
+	}
+
+	/* as deep as the emitter went, so it fails where the emitter would */
+	ret = splice_text(out, &header, text);
+	free(text);
+	if (ret) {
+		return ret;
+	}
+
+	/* keep the use in the file, for the next runs */
+	cache->entries[pos].used_ns = now_ns();
+	frag_path(cache, key, path);
+	utimensat(AT_FDCWD, path, NULL, 0);
+
+	return 1;
+}
+
+/*
+ * Store an emitted fragment, evicting others to make room for it
+ * cache:	the cache to store into
+ * header:	the header of the fragment
+ * text:	the text of the fragment
+ */
+static void store_frag(struct frag_cache *cache,
+		       const struct frag_header *header, const char *text)
+{
+	struct frag_cache_entry entry = {
+		.key = header->key,
+		.size = sizeof(*header) + header->len,
+		.used_ns = now_ns()
+	};
+	size_t pos;
+
+	if (find_entry(cache, entry.key, &pos)) {
+		remove_entry(cache, pos);
+	}
+	if (entry.size > cache->max_bytes) {
+		return;
+	}
+	evict(cache, entry.size);
+	find_entry(cache, entry.key, &pos);
+	if (write_frag(cache, header, text) ||
+	    insert_entry(cache, pos, &entry)) {
+		printlg(WARNING_LEVEL, "Could not cache fragment %016llx.\n",
+			entry.key);
+	}
+}
+
+int frag_cache_emit(struct frag_cache *cache, struct c_gen *out,
+		    unsigned long long key, c_frag_emitter emitter,
+		    size_t frag_i, void *arg)
+{
+	struct line_gen *base = &out->base_gen;
+	struct frag_header header;
+	struct line_sink sink;
+	struct c_gen frag;
+	size_t len;
+	char *text;
+	int ret;
+
+	if ((ret = try_hit(cache, base, key))) {
+		if (ret == 1) {
+			cache->n_hits++;
+			return 0;
+		}
+		return ret;
+	}
+	cache->n_misses++;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FRAG_MAGIC, sizeof(FRAG_MAGIC));
+	header.key = key;
+	header.indent_width = base->indent_width;
+	header.indent_char = base->indent_char;
+	/* emit at depth 0, with as much room to indent as "out" has left */
+	if (line_sink_mem(&sink, 0)) {
+		return line_gen_fail(base, -1);
+	}
+	str_arena_init(&frag.arena);
+	frag.protos = NULL;
+	init_line_gen_sink(&frag.base_gen, base->max_indent - base->indent,
+			   &sink, FRAG_BUF_SIZE);
+	frag.base_gen.sticky = base->sticky;
+	if (line_gen_set_indent(&frag.base_gen, base->indent_char,
+				base->indent_width)) {
+		ret = -1;
+	} else {
+		ret = emitter(&frag, frag_i, arg);
+	}
+	header.end_indent = frag.base_gen.indent;
+	header.max_depth = frag.base_gen.deepest;
+	if ((close_c_gen(&frag) || line_gen_error(&frag.base_gen)) &&
+	    ret == 0) {
+		ret = -1;
+	}
+	text = line_sink_mem_take(&frag.base_gen.sink, &len);
+	if (ret) {
+		printlg(ERROR_LEVEL, "Fragment %u failed.\n",
+			(unsigned) frag_i);
+		free(text);
+		return line_gen_fail(base, ret == -2 ? -2 : -1);
+	}
+	header.len = len;
+
+	if ((ret = splice_text(base, &header, text)) == 0) {
+		store_frag(cache, &header, text);
+	}
+	free(text);
+
+	return ret;
+}
@@ -0,0 +1,255 @@
+#include <line_gen.h>
+#include <logger.h>
+
+#include <stdlib.h>
+#include <errno.h>
+
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	LINE_GEN_LOG_LEVEL
+
+/*
+ * Write some of the text of the segments to the sink
+ * to_drain:	contains the sink
+ * bytes:	the text to write
+ * len:		the number of bytes of text
+ * returns	0 iff successful;
+ *		-1 if writing to the sink failed, which will set errno,
+ *		   or an earlier call failed in sticky-error mode
+ */
+static int write_segment(struct line_gen *to_drain, const char *bytes,
+			 size_t len)
+{
+	if (to_drain->sticky && to_drain->error) {
+		return -1;
+	}
+	if (len > 0 && line_gen_sink_write(to_drain, bytes, len)) {
+		printlg(DEBUG_LEVEL, "Could not drain staged segment.\n");
+		return line_gen_fail(to_drain, -1);
+	}
+
+	return 0;
+}
+
+/*
+ * Move the staging buffer to the end of the segments,
+ * and start a new one of at least the given size
+ * to_split:	contains the segments and staging buffer
+ * seg:		the segment to take the staging buffer,
+ *		with every field but the text and its length set
+ * size:	the smallest size of the new staging buffer
+ * returns	0 iff successful;
+ *		-1 if allocating failed, which will set errno,
+ *		   in which case nothing is changed
+ */
+static int push_segment(struct line_gen *to_split, struct line_gen_hole *seg,
+			size_t size)
+{
+	char *new_buf;
+
+	if (size < to_split->buf_size) {
+		size = to_split->buf_size;
+	}
+	if (size < LINE_GEN_BUF_SIZE) {
+		size = LINE_GEN_BUF_SIZE;
+	}
+	if ((new_buf = malloc(size)) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not allocate staging buffer.\n");
+		return -1;
+	}
+
+	seg->next = NULL;
+	seg->text = to_split->buf;
+	seg->len = to_split->buf_used;
+	if (to_split->last_hole == NULL) {
+		to_split->holes = seg;
+	} else {
+		to_split->last_hole->next = seg;
+	}
+	to_split->last_hole = seg;
+
+	to_split->buf = new_buf;
+	to_split->buf_size = size;
+	to_split->buf_used = 0;
+
+	return 0;
+}
+
+int line_gen_drain_holes(struct line_gen *to_drain)
+{
+	struct line_gen_hole *seg;
+	int ret = 0;
+
+	while ((seg = to_drain->holes) != NULL) {
+		/* the text before a hole goes out before the hole is filled */
+		if (ret == 0) {
+			ret = write_segment(to_drain, seg->text, seg->len);
+		}
+		free(seg->text);
+		seg->text = NULL;
+		seg->len = 0;
+		if (seg->is_hole && !seg->filled) {
+			return ret;
+		}
+
+		if (ret == 0) {
+			ret = write_segment(to_drain, seg->fill, seg->fill_len);
+		}
+		to_drain->holes = seg->next;
+		free(seg->fill);
+		free(seg);
+	}
+	to_drain->last_hole = NULL;
+
+	/* every hole is filled, so the staging buffer is drained as usual */
+	if (ret) {
+		to_drain->buf_used = 0;
+		return ret;
+	}
+	return line_gen_drain(to_drain);
+}
+
+int line_gen_detach_chunk(struct line_gen *to_split, size_t len)
+{
+	struct line_gen_hole *chunk;
+
+	if (to_split->buf_used == 0) {
+		return line_gen_grow(to_split, len);
+	}
+	if ((chunk = malloc(sizeof(*chunk))) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not allocate staged chunk.\n");
+		return -1;
+	}
+	chunk->is_hole = 0;
+	chunk->filled = 1;
+	chunk->fill = NULL;
+	chunk->fill_len = 0;
+	chunk->indent = to_split->indent;
+	chunk->col = to_split->col;
+	chunk->on_new_line = to_split->on_new_line;
+	/* with room for a space carried over from the chunk */
+	if (push_segment(to_split, chunk, len + 1)) {
+		free(chunk);
+		return -1;
+	}
+	/* the space stays staged, as when draining */
+	if (chunk->text[chunk->len - 1] == ' ') {
+		chunk->len--;
+		to_split->buf[0] = ' ';
+		to_split->buf_used = 1;
+	}
+
+	return 0;
+}
+
+struct line_gen_hole *line_gen_reserve_hole(struct line_gen *to_split)
+{
+	struct line_gen_hole *hole;
+
+	if (to_split->n_checkpoints > 0) {
+		printlg(ERROR_LEVEL, "Cannot reserve hole at checkpoint.\n");
+		errno = EINVAL;
+		line_gen_fail(to_split, -1);
+		return NULL;
+	}
+	if ((hole = malloc(sizeof(*hole))) == NULL) {
+		printlg(ERROR_LEVEL, "Could not allocate hole.\n");
+		line_gen_fail(to_split, -1);
+		return NULL;
+	}
+	hole->is_hole = 1;
+	hole->filled = 0;
+	hole->fill = NULL;
+	hole->fill_len = 0;
+	hole->indent = to_split->indent;
+	hole->col = to_split->col;
+	hole->on_new_line = to_split->on_new_line;
+	if (push_segment(to_split, hole, 0)) {
+		printlg(ERROR_LEVEL, "Could not reserve hole.\n");
+		line_gen_fail(to_split, -1);
+		free(hole);
+		return NULL;
+	}
+
+	return hole;
+}
+
+int line_gen_fill_begin(const struct line_gen *to_fill,
+			const struct line_gen_hole *hole,
+			struct line_gen *filler)
+{
+	struct line_sink sink;
+
+	if (line_sink_mem(&sink, 0)) {
+		printlg(ERROR_LEVEL, "Could not allocate hole.\n");
+		return -1;
+	}
+	/* the memory sink buffers the text already */
+	init_line_gen_sink(filler, to_fill->max_indent, &sink, 0);
+	filler->indent = hole->indent;
+	filler->col = hole->col;
+	filler->on_new_line = hole->on_new_line;
+	filler->sticky = to_fill->sticky;
+	if (line_gen_set_indent(filler, to_fill->indent_char,
+				to_fill->indent_width)) {
+		printlg(ERROR_LEVEL, "Could not indent hole.\n");
+		close_line_gen(filler);
+		line_sink_mem_free(&filler->sink);
+		return -1;
+	}
+
+	return 0;
+}
+
+int line_gen_fill_end(struct line_gen *to_fill, struct line_gen_hole *hole,
+		      struct line_gen *filler)
+{
+	size_t end_indent = filler->indent;
+	int end_on_new_line = filler->on_new_line;
+	size_t fill_len;
+	char *fill;
+	int ret;
+
+	/* the failures of the filler, whether or not it was sticky */
+	close_line_gen(filler);
+	ret = line_gen_error(filler);
+	fill = line_sink_mem_take(&filler->sink, &fill_len);
+
+	if (ret == 0 && (end_indent != hole->indent ||
+			 end_on_new_line != hole->on_new_line)) {
+		printlg(ERROR_LEVEL,
+			"Hole ended at depth %u instead of %u.\n",
+			(unsigned) end_indent, (unsigned) hole->indent);
+		ret = -2;
+	}
+
+	hole->filled = 1;
+	if (ret) {
+		printlg(ERROR_LEVEL, "Could not fill hole.\n");
+		free(fill);
+		line_gen_fail(to_fill, ret);
+	} else {
+		hole->fill = fill;
+		hole->fill_len = fill_len;
+		if (filler->deepest > to_fill->deepest) {
+			to_fill->deepest = filler->deepest;
+		}
+	}
+
+	if (line_gen_drain(to_fill) && ret == 0) {
+		ret = -1;
+	}
+
+	return ret;
+}
+
+void line_gen_abandon_holes(struct line_gen *to_fill)
+{
+	struct line_gen_hole *seg;
+
+	for (seg = to_fill->holes; seg != NULL; seg = seg->next) {
+		if (seg->is_hole && !seg->filled) {
+			printlg(WARNING_LEVEL, "Closing unfilled hole.\n");
+			seg->filled = 1;
+		}
+	}
+}
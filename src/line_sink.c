@@ -0,0 +1,570 @@
+#define _GNU_SOURCE
+
+#include <line_sink.h>
+#include <logger.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * the minimum level of the log statements of the sinks,
+ * below which they are compiled out
+ */
+#ifndef LINE_SINK_LOG_LEVEL
+#define LINE_SINK_LOG_LEVEL	DISP_LEVEL
+#endif
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	LINE_SINK_LOG_LEVEL
+
+/* the smallest capacity a memory sink grows to */
+#define MEM_MIN_CAP	4096
+/* the smallest size of a mapped file sink */
+#define MAP_MIN_CAP	(1024 * 1024)
+/* the parameters of the 64-bit FNV-1a hash */
+#define FNV_OFFSET	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+/* the number of names tried for a temporary file before giving up */
+#define MAX_TMP_TRIES	16
+
+static int stdio_write(struct line_sink *sink, const char *bytes, size_t len)
+{
+	if (fwrite(bytes, len, 1, sink->state.stream) == 0) {
+		printlg(DEBUG_LEVEL, "Could not write to stream.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int stdio_flush(struct line_sink *sink)
+{
+	return fflush(sink->state.stream) ? -1 : 0;
+}
+
+static int stdio_close(struct line_sink *sink)
+{
+	FILE *stream_to_close = sink->state.stream;
+
+	sink->state.stream = NULL;
+	return fclose(stream_to_close) ? -1 : 0;
+}
+
+static const struct line_sink_ops stdio_ops = {
+	.write = stdio_write,
+	.flush = stdio_flush,
+	.close = stdio_close
+};
+
+void line_sink_stdio(struct line_sink *sink, FILE *stream)
+{
+	sink->ops = &stdio_ops;
+	sink->state.stream = stream;
+}
+
+static int fd_write(struct line_sink *sink, const char *bytes, size_t len)
+{
+	while (len > 0) {
+		ssize_t written = write(sink->state.fd, bytes, len);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			printlg(DEBUG_LEVEL, "Could not write to %d: %d.\n",
+				sink->state.fd, errno);
+			return -1;
+		}
+		bytes += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
+static int no_flush(struct line_sink *sink)
+{
+	(void) sink;
+	return 0;
+}
+
+static int fd_close(struct line_sink *sink)
+{
+	int fd_to_close = sink->state.fd;
+
+	sink->state.fd = -1;
+	return close(fd_to_close) ? -1 : 0;
+}
+
+static const struct line_sink_ops fd_ops = {
+	.write = fd_write,
+	.flush = no_flush,
+	.close = fd_close
+};
+
+void line_sink_fd(struct line_sink *sink, int fd)
+{
+	sink->ops = &fd_ops;
+	sink->state.fd = fd;
+}
+
+/*
+ * Append bytes to a memory buffer, growing it geometrically
+ * buf:		the buffer to append to
+ * bytes:	the bytes to append
+ * len:		the number of bytes to append
+ * returns	0 iff successful, -1 if growing the buffer failed
+ */
+static int buf_append(struct line_sink_buf *buf, const char *bytes,
+		      size_t len)
+{
+	size_t need = buf->len + len;
+
+	if (need > buf->cap) {
+		size_t new_cap = buf->cap * 2;
+		char *new_data;
+
+		if (new_cap < MEM_MIN_CAP) {
+			new_cap = MEM_MIN_CAP;
+		}
+		if (new_cap < need) {
+			new_cap = need;
+		}
+		if ((new_data = realloc(buf->data, new_cap)) == NULL) {
+			printlg(DEBUG_LEVEL,
+				"Could not grow memory sink to %u.\n",
+				(unsigned) new_cap);
+			return -1;
+		}
+		buf->data = new_data;
+		buf->cap = new_cap;
+	}
+	memcpy(buf->data + buf->len, bytes, len);
+	buf->len = need;
+
+	return 0;
+}
+
+static int mem_write(struct line_sink *sink, const char *bytes, size_t len)
+{
+	return buf_append(&sink->state.mem, bytes, len);
+}
+
+static int no_close(struct line_sink *sink)
+{
+	(void) sink;
+	return 0;
+}
+
+static const struct line_sink_ops mem_ops = {
+	.write = mem_write,
+	.flush = no_flush,
+	.close = no_close
+};
+
+int line_sink_mem(struct line_sink *sink, size_t cap)
+{
+	sink->ops = &mem_ops;
+	sink->state.mem.data = NULL;
+	sink->state.mem.len = 0;
+	sink->state.mem.cap = 0;
+
+	if (cap > 0) {
+		if ((sink->state.mem.data = malloc(cap)) == NULL) {
+			printlg(DEBUG_LEVEL,
+				"Could not allocate memory sink.\n");
+			return -1;
+		}
+		sink->state.mem.cap = cap;
+	}
+
+	return 0;
+}
+
+char *line_sink_mem_take(struct line_sink *sink, size_t *len)
+{
+	char *data = sink->state.mem.data;
+
+	*len = sink->state.mem.len;
+	sink->state.mem.data = NULL;
+	sink->state.mem.len = 0;
+	sink->state.mem.cap = 0;
+
+	return data;
+}
+
+void line_sink_mem_free(struct line_sink *sink)
+{
+	size_t len;
+
+	free(line_sink_mem_take(sink, &len));
+}
+
+/*
+ * Set the size of a file, allocating its blocks if the file system can.
+ * fd:		the file to resize
+ * size:	the new size of the file
+ * returns	0 iff successful;
+ *		-1 on failure, which will set errno
+ */
+static int reserve_file(int fd, size_t size)
+{
+	int err = posix_fallocate(fd, 0, size);
+
+	if (err == 0) {
+		return 0;
+	}
+	if (err != EOPNOTSUPP && err != EINVAL) {
+		errno = err;
+		return -1;
+	}
+
+	/* fall back to a sparse file */
+	return ftruncate(fd, size) ? -1 : 0;
+}
+
+/*
+ * Round a size up to the next whole number of pages
+ * size:	the size to round up
+ * returns	the rounded size
+ */
+static size_t round_to_page(size_t size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	return (size + page - 1) / page * page;
+}
+
+static int map_write(struct line_sink *sink, const char *bytes, size_t len)
+{
+	size_t need = sink->state.map.len + len;
+
+	if (need > sink->state.map.cap) {
+		size_t new_cap = sink->state.map.cap * 2;
+		char *new_map;
+
+		if (new_cap < need) {
+			new_cap = round_to_page(need);
+		}
+		if (reserve_file(sink->state.map.fd, new_cap)) {
+			printlg(DEBUG_LEVEL,
+				"Could not grow mapped file: %d.\n", errno);
+			return -1;
+		}
+#ifdef MREMAP_MAYMOVE
+		new_map = mremap(sink->state.map.map, sink->state.map.cap,
+				 new_cap, MREMAP_MAYMOVE);
+#else
+		new_map = mmap(NULL, new_cap, PROT_READ | PROT_WRITE,
+			       MAP_SHARED, sink->state.map.fd, 0);
+		if (new_map != MAP_FAILED) {
+			munmap(sink->state.map.map, sink->state.map.cap);
+		}
+#endif /* MREMAP_MAYMOVE */
+		if (new_map == MAP_FAILED) {
+			printlg(DEBUG_LEVEL, "Could not grow mapping: %d.\n",
+				errno);
+			return -1;
+		}
+		sink->state.map.map = new_map;
+		sink->state.map.cap = new_cap;
+	}
+	memcpy(sink->state.map.map + sink->state.map.len, bytes, len);
+	sink->state.map.len = need;
+
+	return 0;
+}
+
+static int map_close(struct line_sink *sink)
+{
+	int ret = 0;
+
+	if (munmap(sink->state.map.map, sink->state.map.cap)) {
+		ret = -1;
+	}
+	if (ftruncate(sink->state.map.fd, sink->state.map.len)) {
+		printlg(DEBUG_LEVEL, "Could not trim mapped file: %d.\n",
+			errno);
+		ret = -1;
+	}
+	if (close(sink->state.map.fd)) {
+		ret = -1;
+	}
+	sink->state.map.fd = -1;
+	sink->state.map.map = NULL;
+	sink->state.map.cap = 0;
+
+	return ret;
+}
+
+static const struct line_sink_ops map_ops = {
+	.write = map_write,
+	.flush = no_flush,
+	.close = map_close
+};
+
+int line_sink_mmap(struct line_sink *sink, const char *path, size_t size_hint)
+{
+	size_t cap = round_to_page(size_hint < MAP_MIN_CAP ?
+				   MAP_MIN_CAP : size_hint);
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	char *map;
+
+	if (fd < 0) {
+		printlg(DEBUG_LEVEL, "Could not open %s.\n", path);
+		return -1;
+	}
+	if (reserve_file(fd, cap) ||
+	    (map = mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0)) == MAP_FAILED) {
+		int map_errno = errno;
+
+		printlg(DEBUG_LEVEL, "Could not preallocate or map %s: %d.\n",
+			path, errno);
+		close(fd);
+		errno = map_errno;
+		return -1;
+	}
+
+	sink->ops = &map_ops;
+	sink->state.map.fd = fd;
+	sink->state.map.map = map;
+	sink->state.map.len = 0;
+	sink->state.map.cap = cap;
+
+	return 0;
+}
+
+static int changed_write(struct line_sink *sink, const char *bytes,
+			 size_t len)
+{
+	unsigned long long hash = sink->state.changed.hash;
+	size_t byte_i;
+
+	if (buf_append(&sink->state.changed.buf, bytes, len)) {
+		return -1;
+	}
+	for (byte_i = 0; byte_i < len; byte_i++) {
+		hash = (hash ^ (unsigned char) bytes[byte_i]) * FNV_PRIME;
+	}
+	sink->state.changed.hash = hash;
+
+	return 0;
+}
+
+/*
+ * Check whether a file holds exactly the given bytes,
+ * comparing sizes first, and then the mapped contents
+ * path:	the path of the file
+ * bytes:	the bytes to compare against
+ * len:		the number of bytes
+ * returns	1 iff the file exists and holds exactly the bytes, else 0
+ */
+static int file_holds(const char *path, const char *bytes, size_t len)
+{
+	struct stat old_stat;
+	char *map;
+	int fd, same;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return 0;
+	}
+	if (fstat(fd, &old_stat) || !S_ISREG(old_stat.st_mode) ||
+	    (size_t) old_stat.st_size != len) {
+		close(fd);
+		return 0;
+	}
+	if (len == 0) {
+		close(fd);
+		return 1;
+	}
+
+	map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		printlg(DEBUG_LEVEL, "Could not map %s: %d.\n", path, errno);
+		return 0;
+	}
+	same = memcmp(map, bytes, len) == 0;
+	munmap(map, len);
+
+	return same;
+}
+
+/*
+ * Create a new temporary file next to a path,
+ * with the permissions a new file in the path would have
+ * path:	the path next to which to create the file
+ * tmp_path:	set to the path of the temporary file, to be released with free
+ * returns	the descriptor of the file, or -1 on failure, with errno set
+ */
+static int open_tmp(const char *path, char **tmp_path)
+{
+	static atomic_uint n_tmp_files;
+	size_t tmp_len = strlen(path) + 32;
+	int tmp_i, fd = -1;
+
+	if ((*tmp_path = malloc(tmp_len)) == NULL) {
+		return -1;
+	}
+	for (tmp_i = 0; tmp_i < MAX_TMP_TRIES && fd < 0; tmp_i++) {
+		snprintf(*tmp_path, tmp_len, "%s.%ld.%u.tmp", path,
+			 (long) getpid(), atomic_fetch_add(&n_tmp_files, 1));
+		fd = open(*tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+		if (fd < 0 && errno != EEXIST) {
+			break;
+		}
+	}
+	if (fd < 0) {
+		free(*tmp_path);
+		*tmp_path = NULL;
+	}
+
+	return fd;
+}
+
+/*
+ * Atomically replace a file with the given bytes,
+ * through a temporary file which is renamed over it
+ * path:	the path of the file
+ * bytes:	the new contents of the file
+ * len:		the number of bytes
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static int replace_file(const char *path, const char *bytes, size_t len)
+{
+	struct line_sink tmp_sink;
+	struct stat old_stat;
+	char *tmp_path;
+	int fd, ret = 0;
+
+	if ((fd = open_tmp(path, &tmp_path)) < 0) {
+		printlg(DEBUG_LEVEL, "Could not create a file next to %s.\n",
+			path);
+		return -1;
+	}
+	/* keep the permissions of the file being replaced */
+	if (stat(path, &old_stat) == 0) {
+		fchmod(fd, old_stat.st_mode & 07777);
+	}
+
+	line_sink_fd(&tmp_sink, fd);
+	if (fd_write(&tmp_sink, bytes, len)) {
+		ret = -1;
+	}
+	if (fd_close(&tmp_sink)) {
+		ret = -1;
+	}
+	if (ret == 0 && rename(tmp_path, path)) {
+		printlg(DEBUG_LEVEL, "Could not rename %s: %d.\n", tmp_path,
+			errno);
+		ret = -1;
+	}
+	if (ret) {
+		int write_errno = errno;
+
+		unlink(tmp_path);
+		errno = write_errno;
+	}
+	free(tmp_path);
+
+	return ret;
+}
+
+/*
+ * Release the bytes and the path of a write-if-changed sink
+ * sink:	the sink to release
+ */
+static void changed_release(struct line_sink *sink)
+{
+	free(sink->state.changed.buf.data);
+	free(sink->state.changed.path);
+	sink->state.changed.buf.data = NULL;
+	sink->state.changed.buf.len = 0;
+	sink->state.changed.buf.cap = 0;
+	sink->state.changed.path = NULL;
+}
+
+static int changed_close(struct line_sink *sink)
+{
+	const char *path = sink->state.changed.path;
+	const char *data = sink->state.changed.buf.data;
+	size_t len = sink->state.changed.buf.len;
+	int changed = !file_holds(path, data, len);
+	int ret = 0;
+
+	if (changed && replace_file(path, data, len)) {
+		ret = -1;
+	}
+	if (sink->state.changed.update != NULL) {
+		sink->state.changed.update->changed = changed && ret == 0;
+		sink->state.changed.update->hash = sink->state.changed.hash;
+	}
+	changed_release(sink);
+
+	return ret;
+}
+
+static int changed_abort(struct line_sink *sink)
+{
+	if (sink->state.changed.update != NULL) {
+		sink->state.changed.update->changed = 0;
+		sink->state.changed.update->hash = sink->state.changed.hash;
+	}
+	changed_release(sink);
+
+	return 0;
+}
+
+static const struct line_sink_ops changed_ops = {
+	.write = changed_write,
+	.flush = no_flush,
+	.close = changed_close,
+	.abort = changed_abort
+};
+
+int line_sink_if_changed(struct line_sink *sink, const char *path,
+			 struct line_sink_update *update)
+{
+	char *own_path = strdup(path);
+
+	if (own_path == NULL) {
+		printlg(DEBUG_LEVEL, "Could not copy the path %s.\n", path);
+		return -1;
+	}
+
+	sink->ops = &changed_ops;
+	sink->state.changed.buf.data = NULL;
+	sink->state.changed.buf.len = 0;
+	sink->state.changed.buf.cap = 0;
+	sink->state.changed.hash = FNV_OFFSET;
+	sink->state.changed.path = own_path;
+	sink->state.changed.update = update;
+
+	return 0;
+}
+
+static int null_write(struct line_sink *sink, const char *bytes, size_t len)
+{
+	(void) bytes;
+	sink->state.count += len;
+
+	return 0;
+}
+
+static const struct line_sink_ops null_ops = {
+	.write = null_write,
+	.flush = no_flush,
+	.close = no_close
+};
+
+void line_sink_null(struct line_sink *sink)
+{
+	sink->ops = &null_ops;
+	sink->state.count = 0;
+}
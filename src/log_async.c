@@ -0,0 +1,314 @@
+#include <log_async.h>
+#include <logger.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* how long the background thread sleeps when all rings are empty */
+#define LOG_ASYNC_IDLE_NS	(1000 * 1000)
+/* how long "log_async_flush" sleeps between checks of the rings */
+#define LOG_ASYNC_POLL_NS	(50 * 1000)
+/* the size of a cache line, which separates the producer and consumer */
+#define CACHE_LINE_SIZE		64
+
+/* a single formatted message */
+struct log_record {
+	FILE *stream; /* the stream to which to write the message */
+	size_t len; /* the number of characters in "text" */
+	char text[LOG_ASYNC_TEXT_SIZE]; /* the tagged message */
+};
+
+/*
+ * a single-producer, single-consumer ring buffer of messages,
+ * written by the thread that owns it, and read by the background thread
+ */
+struct log_ring {
+	/* nonzero while a thread writes to the ring */
+	atomic_int owned;
+	/* the number of records ever written, only stored by the owner */
+	_Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+	/* the number of records ever read, only stored by the reader */
+	_Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+	struct log_record records[LOG_ASYNC_SLOTS];
+};
+
+/* every ring buffer, of which the first "n_rings" are set */
+static struct log_ring *rings[LOG_ASYNC_MAX_RINGS];
+static atomic_size_t n_rings;
+/* guards adding to "rings" */
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the ring of the calling thread, or NULL if it has none yet */
+static __thread struct log_ring *own_ring;
+/* releases the ring of an exiting thread */
+static pthread_key_t ring_key;
+
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static pthread_t drainer;
+/* nonzero while the background thread runs */
+static atomic_int draining;
+/* set to make the background thread stop, once the rings are empty */
+static atomic_int stopping;
+
+static atomic_int policy = LOG_ASYNC_BLOCK;
+static atomic_size_t n_dropped;
+
+/*
+ * Sleep for a short while
+ * ns:		the number of nanoseconds to sleep, below one second
+ */
+static void nap(long ns)
+{
+	struct timespec duration = {0, ns};
+
+	nanosleep(&duration, NULL);
+}
+
+/*
+ * Write out the records queued in a ring, and flush their streams
+ * ring:	the ring to read
+ * returns	the number of records written
+ */
+static size_t drain_ring(struct log_ring *ring)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	FILE *last_stream = NULL;
+	size_t pos;
+
+	for (pos = tail; pos != head; pos++) {
+		struct log_record *record =
+			&ring->records[pos % LOG_ASYNC_SLOTS];
+
+		if (record->stream != last_stream && last_stream != NULL) {
+			fflush(last_stream);
+		}
+		last_stream = record->stream;
+		fwrite(record->text, 1, record->len, record->stream);
+	}
+	if (last_stream != NULL) {
+		fflush(last_stream);
+	}
+	atomic_store_explicit(&ring->tail, head, memory_order_release);
+
+	return head - tail;
+}
+
+/*
+ * Write out the records queued in every ring
+ * returns	the number of records written
+ */
+static size_t drain_rings(void)
+{
+	size_t count = atomic_load_explicit(&n_rings, memory_order_acquire);
+	size_t ring_i, n_drained = 0;
+
+	for (ring_i = 0; ring_i < count; ring_i++) {
+		n_drained += drain_ring(rings[ring_i]);
+	}
+
+	return n_drained;
+}
+
+/*
+ * The background thread, which drains the rings until asked to stop
+ * unused:	ignored
+ * returns	NULL
+ */
+static void *run_drainer(void *unused)
+{
+	(void) unused;
+	while (!atomic_load(&stopping)) {
+		if (drain_rings() == 0) {
+			nap(LOG_ASYNC_IDLE_NS);
+		}
+	}
+	drain_rings();
+
+	return NULL;
+}
+
+/*
+ * Stop the background thread at exit, after writing out every ring
+ */
+static void stop_drainer(void)
+{
+	if (atomic_load(&draining)) {
+		atomic_store(&stopping, 1);
+		pthread_join(drainer, NULL);
+		atomic_store(&draining, 0);
+		/* catch messages queued during the last pass */
+		drain_rings();
+	}
+}
+
+/*
+ * Mark the ring of an exiting thread as free to reuse
+ * ring:	the ring of the thread
+ */
+static void release_ring(void *ring)
+{
+	atomic_store_explicit(&((struct log_ring *) ring)->owned, 0,
+			      memory_order_release);
+}
+
+/*
+ * Start the background thread, once
+ */
+static void start_drainer(void)
+{
+	if (pthread_key_create(&ring_key, release_ring)) {
+		return;
+	}
+	if (pthread_create(&drainer, NULL, run_drainer, NULL)) {
+		return;
+	}
+	atomic_store(&draining, 1);
+	atomic_store(&stopping, 0);
+	atexit(stop_drainer);
+}
+
+/*
+ * Give the calling thread a ring, reusing one released by an exited thread
+ * returns	the ring, or NULL if none is free and no more may be made
+ */
+static struct log_ring *claim_ring(void)
+{
+	size_t count = atomic_load_explicit(&n_rings, memory_order_acquire);
+	struct log_ring *ring = NULL;
+	size_t ring_i;
+
+	for (ring_i = 0; ring_i < count && ring == NULL; ring_i++) {
+		int free_ring = 0;
+
+		if (atomic_compare_exchange_strong_explicit(
+				&rings[ring_i]->owned, &free_ring, 1,
+				memory_order_acquire, memory_order_relaxed)) {
+			ring = rings[ring_i];
+		}
+	}
+
+	pthread_mutex_lock(&rings_lock);
+	count = atomic_load_explicit(&n_rings, memory_order_relaxed);
+	if (ring == NULL && count < LOG_ASYNC_MAX_RINGS &&
+	    (ring = aligned_alloc(CACHE_LINE_SIZE, sizeof(*ring))) != NULL) {
+		atomic_init(&ring->owned, 1);
+		atomic_init(&ring->head, 0);
+		atomic_init(&ring->tail, 0);
+		rings[count] = ring;
+		atomic_store_explicit(&n_rings, count + 1,
+				      memory_order_release);
+	}
+	pthread_mutex_unlock(&rings_lock);
+
+	if (ring != NULL) {
+		pthread_setspecific(ring_key, ring);
+	}
+
+	return ring;
+}
+
+/*
+ * Format a tagged message
+ * text:	where to write the message, of LOG_ASYNC_TEXT_SIZE characters
+ * level:	the log level, which determines how to tag the message
+ * sep:		the text between the tag and the message
+ * fmt:		the format of the message, following printf semantics
+ * args:	the values to plug into the format
+ * returns	the number of characters written, without a 0 terminator
+ */
+static size_t format_record(char *text, int level, const char *sep,
+			    const char *fmt, va_list args)
+{
+	int len = snprintf(text, LOG_ASYNC_TEXT_SIZE, "[%s]%s", getTag(level),
+			   sep);
+	int msg_len;
+
+	if (len < 0) {
+		return 0;
+	}
+	msg_len = vsnprintf(text + len, LOG_ASYNC_TEXT_SIZE - len, fmt, args);
+	if (msg_len < 0) {
+		return len;
+	}
+	if (len + msg_len >= LOG_ASYNC_TEXT_SIZE) {
+		/* keep the line break of a cut-short message */
+		len = LOG_ASYNC_TEXT_SIZE - 1;
+		text[len - 1] = '\n';
+		return len;
+	}
+
+	return len + msg_len;
+}
+
+void log_async_set_policy(enum log_async_policy new_policy)
+{
+	atomic_store(&policy, new_policy);
+}
+
+void log_async_vwrite(FILE *stream, int level, const char *sep,
+		      const char *fmt, va_list args)
+{
+	struct log_record *record;
+	size_t head;
+
+	pthread_once(&start_once, start_drainer);
+	if (own_ring == NULL && atomic_load(&draining)) {
+		own_ring = claim_ring();
+	}
+	if (own_ring == NULL || !atomic_load(&draining)) {
+		fprintf(stream, "[%s]%s", getTag(level), sep);
+		vfprintf(stream, fmt, args);
+		return;
+	}
+
+	head = atomic_load_explicit(&own_ring->head, memory_order_relaxed);
+	while (head - atomic_load_explicit(&own_ring->tail,
+					   memory_order_acquire) ==
+	       LOG_ASYNC_SLOTS) {
+		if (atomic_load_explicit(&policy, memory_order_relaxed) ==
+		    LOG_ASYNC_DROP) {
+			atomic_fetch_add_explicit(&n_dropped, 1,
+						  memory_order_relaxed);
+			return;
+		}
+		sched_yield();
+	}
+
+	record = &own_ring->records[head % LOG_ASYNC_SLOTS];
+	record->stream = stream;
+	record->len = format_record(record->text, level, sep, fmt, args);
+	atomic_store_explicit(&own_ring->head, head + 1, memory_order_release);
+
+	if (level >= FATAL_LEVEL) {
+		log_async_flush();
+	}
+}
+
+void log_async_flush(void)
+{
+	size_t count = atomic_load_explicit(&n_rings, memory_order_acquire);
+	size_t heads[LOG_ASYNC_MAX_RINGS];
+	size_t ring_i;
+
+	for (ring_i = 0; ring_i < count; ring_i++) {
+		heads[ring_i] = atomic_load_explicit(&rings[ring_i]->head,
+						     memory_order_acquire);
+	}
+	for (ring_i = 0; ring_i < count; ring_i++) {
+		while (atomic_load(&draining) &&
+		       atomic_load_explicit(&rings[ring_i]->tail,
+					    memory_order_acquire) <
+		       heads[ring_i]) {
+			nap(LOG_ASYNC_POLL_NS);
+		}
+	}
+}
+
+size_t log_async_dropped(void)
+{
+	return atomic_load(&n_dropped);
+}
@@ -0,0 +1,873 @@
+#include <log_binary.h>
+#include <logger.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* the start of every stream, followed by BYTE_ORDER_MARK */
+#define LOG_MAGIC	"LGBINLOG"
+/* written in native byte order, to reject streams from other machines */
+#define BYTE_ORDER_MARK	0x01020304u
+/* the largest event: type, ID, timestamp, and every argument at its largest */
+#define MAX_EVENT_SIZE	(1 + 4 + 8 + \
+			 LOG_BINARY_MAX_ARGS * (4 + LOG_BINARY_MAX_STR))
+/* the longest conversion specification the decoder renders */
+#define MAX_SPEC_LEN	32
+
+/* the first byte of each record after the header */
+enum record_type {
+	EVENT_RECORD = 1, /* ID, timestamp, and argument values */
+	SITE_RECORD = 2 /* ID, level, line, file, separator and format */
+};
+
+/* how an argument is read from the call, and recorded */
+enum arg_kind {
+	ARG_NONE = 0, /* no argument, eg. for "%%" */
+	ARG_INT, /* int, and anything promoted to it */
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_INTMAX,
+	ARG_PTRDIFF,
+	ARG_DOUBLE, /* double, and float, which is promoted to it */
+	ARG_LDOUBLE, /* long double, recorded as a double */
+	ARG_STR, /* a string, recorded as its length and characters */
+	ARG_STR_STAR, /* a string whose precision is the argument before it */
+	ARG_PTR, /* a pointer, recorded as its address */
+	ARG_COUNT /* the pointer of "%n", which is recorded but not printed */
+};
+
+/* a conversion specification in a format string */
+struct fmt_spec {
+	const char *start; /* the '%' */
+	const char *end; /* one past the conversion character */
+	unsigned n_stars; /* the number of '*' widths and precisions */
+	/* the precision, capped at LOG_BINARY_MAX_STR, -1 if none or '*' */
+	int prec;
+	enum arg_kind kind; /* the kind of the converted argument */
+};
+
+/* the events of a thread not yet written to the stream */
+struct thread_buf {
+	size_t len; /* the number of bytes in "data" */
+	unsigned gen; /* the stream the events were recorded for */
+	char data[LOG_BINARY_BUF_SIZE];
+};
+
+/* guards the stream, and describing call sites */
+static pthread_mutex_t stream_lock = PTHREAD_MUTEX_INITIALIZER;
+/* the stream, or -1 if none is open */
+static int out_fd = -1;
+/* nonzero once "log_binary_close" was called, until reopened */
+static int closed;
+/* the number of streams ever opened */
+static unsigned n_gens;
+/* the number of the open stream, or 0 if none is */
+static atomic_uint stream_gen;
+/* the number of call sites given an ID */
+static unsigned n_sites;
+
+/* the buffer of the calling thread, or NULL if it has none yet */
+static __thread struct thread_buf *own_buf;
+/* flushes the buffer of an exiting thread */
+static pthread_key_t buf_key;
+static pthread_once_t buf_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Get the time of an event
+ * returns	the time stamp counter, where available,
+ *		or the monotonic clock in nanoseconds otherwise
+ */
+static inline uint64_t timestamp(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/*
+ * Find the next conversion specification in a format
+ * pos:		where to start looking
+ * spec:	set to the specification found
+ * returns	1 iff one was found, 0 if the format has no more
+ */
+static int next_spec(const char *pos, struct fmt_spec *spec)
+{
+	const char *conv;
+	unsigned n_l = 0;
+	char length = 0;
+	int star_prec = 0;
+
+	if ((spec->start = strchr(pos, '%')) == NULL) {
+		return 0;
+	}
+	conv = spec->start + 1;
+	spec->n_stars = 0;
+	spec->prec = -1;
+	while (*conv != '\0' && strchr("-+ #0'", *conv) != NULL) {
+		conv++;
+	}
+	if (*conv == '*') {
+		spec->n_stars++;
+		conv++;
+	}
+	while (isdigit((unsigned char) *conv)) {
+		conv++;
+	}
+	if (*conv == '.') {
+		conv++;
+		if (*conv == '*') {
+			spec->n_stars++;
+			star_prec = 1;
+			conv++;
+		} else {
+			spec->prec = 0;
+		}
+		while (isdigit((unsigned char) *conv)) {
+			/* which stops growing once it is past the cap */
+			if (!star_prec && spec->prec <= LOG_BINARY_MAX_STR) {
+				spec->prec = spec->prec * 10 + (*conv - '0');
+			}
+			conv++;
+		}
+		if (spec->prec > LOG_BINARY_MAX_STR) {
+			spec->prec = LOG_BINARY_MAX_STR;
+		}
+	}
+	while (*conv != '\0' && strchr("hlLqjzt", *conv) != NULL) {
+		if (*conv == 'l') {
+			n_l++;
+		} else {
+			length = *conv;
+		}
+		conv++;
+	}
+
+	switch (*conv) {
+	case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+		spec->kind = n_l >= 2 || length == 'q' ? ARG_LLONG :
+			     n_l == 1 ? ARG_LONG :
+			     length == 'j' ? ARG_INTMAX :
+			     length == 'z' ? ARG_SIZE :
+			     length == 't' ? ARG_PTRDIFF : ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+	case 'a': case 'A':
+		spec->kind = length == 'L' ? ARG_LDOUBLE : ARG_DOUBLE;
+		break;
+	case 's':
+		spec->kind = star_prec ? ARG_STR_STAR : ARG_STR;
+		break;
+	case 'p':
+		spec->kind = ARG_PTR;
+		break;
+	case 'n':
+		spec->kind = ARG_COUNT;
+		break;
+	default:
+		spec->kind = ARG_NONE;
+		break;
+	}
+	spec->end = *conv != '\0' ? conv + 1 : conv;
+
+	return 1;
+}
+
+/*
+ * Count the arguments of a specification,
+ * which is only recorded if all of them fit
+ * spec:	the specification
+ * returns	the number of arguments it takes
+ */
+static unsigned spec_args(const struct fmt_spec *spec)
+{
+	return spec->n_stars + (spec->kind != ARG_NONE);
+}
+
+/*
+ * Find how to record the arguments of a call site
+ * site:	the call site, whose "kinds", "precs" and "n_args" to set
+ */
+static void parse_site(struct log_site *site)
+{
+	struct fmt_spec spec;
+	const char *pos = site->fmt;
+	unsigned star_i;
+
+	site->n_args = 0;
+	while (next_spec(pos, &spec) &&
+	       site->n_args + spec_args(&spec) <= LOG_BINARY_MAX_ARGS) {
+		for (star_i = 0; star_i < spec.n_stars; star_i++) {
+			site->kinds[site->n_args++] = ARG_INT;
+		}
+		if (spec.kind != ARG_NONE) {
+			site->precs[site->n_args] = spec.prec >= 0 ?
+						    spec.prec :
+						    LOG_BINARY_MAX_STR;
+			site->kinds[site->n_args++] = spec.kind;
+		}
+		pos = spec.end;
+	}
+}
+
+/*
+ * Write a whole buffer to the stream
+ * data:	the bytes to write
+ * len:		the number of bytes
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static int write_all(const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t written = write(out_fd, data, len);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		data += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
+/*
+ * Open a stream, and write its header, with "stream_lock" held
+ * path:	the path of the file to truncate and write to
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static int open_stream(const char *path)
+{
+	char header[sizeof(LOG_MAGIC) - 1 + sizeof(uint32_t)];
+	uint32_t order = BYTE_ORDER_MARK;
+
+	if (out_fd >= 0) {
+		close(out_fd);
+	}
+	atomic_store(&stream_gen, 0);
+	out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (out_fd < 0) {
+		return -1;
+	}
+	memcpy(header, LOG_MAGIC, sizeof(LOG_MAGIC) - 1);
+	memcpy(header + sizeof(LOG_MAGIC) - 1, &order, sizeof(order));
+	if (write_all(header, sizeof(header))) {
+		close(out_fd);
+		out_fd = -1;
+		return -1;
+	}
+	closed = 0;
+	atomic_store(&stream_gen, ++n_gens);
+
+	return 0;
+}
+
+/*
+ * Append a length and a string to a record
+ * pos:		where to append
+ * str:		the string
+ * returns	one past the appended characters
+ */
+static char *put_str(char *pos, const char *str)
+{
+	uint32_t len = strlen(str);
+
+	memcpy(pos, &len, sizeof(len));
+	memcpy(pos + sizeof(len), str, len);
+
+	return pos + sizeof(len) + len;
+}
+
+/*
+ * Describe a call site in the open stream, giving it an ID if it has none,
+ * and opening LOG_BINARY_PATH if no stream was opened yet
+ * site:	the call site to describe
+ * returns	the number of the stream, or 0 if there is none to write to
+ */
+static unsigned describe_site(struct log_site *site)
+{
+	unsigned gen = 0;
+	int open_failed = 0;
+	char *record;
+
+	pthread_mutex_lock(&stream_lock);
+	if (out_fd < 0 && !closed && open_stream(LOG_BINARY_PATH)) {
+		closed = 1;
+		open_failed = 1;
+	}
+	if (out_fd >= 0) {
+		gen = atomic_load(&stream_gen);
+	}
+	if (gen != 0 && atomic_load(&site->gen) != gen) {
+		size_t len = 1 + 4 + 1 + 4 + 3 * 4 + strlen(site->file) +
+			     strlen(site->sep) + strlen(site->fmt);
+		uint32_t id, line = site->line;
+		char *pos;
+
+		if (site->id == 0) {
+			site->id = ++n_sites;
+			parse_site(site);
+		}
+		id = site->id;
+		if ((record = malloc(len)) == NULL) {
+			gen = 0;
+		} else {
+			pos = record;
+			*pos++ = SITE_RECORD;
+			memcpy(pos, &id, sizeof(id));
+			pos += sizeof(id);
+			*pos++ = site->level;
+			memcpy(pos, &line, sizeof(line));
+			pos += sizeof(line);
+			pos = put_str(pos, site->file);
+			pos = put_str(pos, site->sep);
+			put_str(pos, site->fmt);
+			if (write_all(record, len)) {
+				gen = 0;
+			} else {
+				atomic_store_explicit(&site->gen, gen,
+						      memory_order_release);
+			}
+			free(record);
+		}
+	}
+	pthread_mutex_unlock(&stream_lock);
+	/*
+	 * not through "printlg", which would come back here,
+	 * and which has nowhere to log to anyway
+	 */
+	if (open_failed) {
+		fprintf(stderr, "Could not open %s.\n", LOG_BINARY_PATH);
+	}
+
+	return gen;
+}
+
+/*
+ * Write a thread's buffered events to the stream they were recorded for,
+ * or discard them if it was closed since
+ * buf:		the buffer of the thread
+ * returns	0 iff successful, -1 otherwise, with errno set
+ */
+static int flush_buf(struct thread_buf *buf)
+{
+	int ret = 0;
+
+	if (buf->len == 0) {
+		return 0;
+	}
+	pthread_mutex_lock(&stream_lock);
+	if (out_fd >= 0 && buf->gen == atomic_load(&stream_gen)) {
+		ret = write_all(buf->data, buf->len);
+	}
+	pthread_mutex_unlock(&stream_lock);
+	buf->len = 0;
+
+	return ret;
+}
+
+/*
+ * Flush and free the buffer of an exiting thread
+ * buf:		the buffer of the thread
+ */
+static void release_buf(void *buf)
+{
+	flush_buf(buf);
+	free(buf);
+}
+
+/*
+ * Flush the buffer of the thread that calls "exit"
+ */
+static void flush_at_exit(void)
+{
+	log_binary_flush();
+}
+
+static void init_bufs(void)
+{
+	if (!pthread_key_create(&buf_key, release_buf)) {
+		atexit(flush_at_exit);
+	}
+}
+
+/*
+ * Give the calling thread a buffer
+ * returns	the buffer, or NULL if it could not be allocated
+ */
+static struct thread_buf *claim_buf(void)
+{
+	pthread_once(&buf_once, init_bufs);
+	if ((own_buf = malloc(sizeof(*own_buf))) != NULL) {
+		own_buf->len = 0;
+		own_buf->gen = 0;
+		pthread_setspecific(buf_key, own_buf);
+	}
+
+	return own_buf;
+}
+
+int log_binary_open(const char *path)
+{
+	int ret;
+
+	log_binary_flush();
+	pthread_mutex_lock(&stream_lock);
+	ret = open_stream(path);
+	pthread_mutex_unlock(&stream_lock);
+
+	return ret;
+}
+
+int log_binary_close(void)
+{
+	int ret = log_binary_flush();
+
+	pthread_mutex_lock(&stream_lock);
+	atomic_store(&stream_gen, 0);
+	if (out_fd >= 0 && close(out_fd)) {
+		ret = -1;
+	}
+	out_fd = -1;
+	closed = 1;
+	pthread_mutex_unlock(&stream_lock);
+
+	return ret;
+}
+
+void log_binary_write(struct log_site *site, ...)
+{
+	struct thread_buf *buf = own_buf;
+	unsigned gen = atomic_load_explicit(&stream_gen, memory_order_acquire);
+	uint32_t id;
+	uint64_t now = timestamp();
+	va_list args;
+	char *pos;
+	unsigned arg_i;
+	/* the value of the argument before, which may be a precision */
+	int64_t prev_val = -1;
+
+	if (gen == 0 ||
+	    atomic_load_explicit(&site->gen, memory_order_acquire) != gen) {
+		if ((gen = describe_site(site)) == 0) {
+			return;
+		}
+	}
+	if (buf == NULL && (buf = claim_buf()) == NULL) {
+		return;
+	}
+	if ((buf->len > 0 && buf->gen != gen) ||
+	    LOG_BINARY_BUF_SIZE - buf->len < MAX_EVENT_SIZE) {
+		flush_buf(buf);
+	}
+	buf->gen = gen;
+
+	id = site->id;
+	pos = buf->data + buf->len;
+	*pos++ = EVENT_RECORD;
+	memcpy(pos, &id, sizeof(id));
+	pos += sizeof(id);
+	memcpy(pos, &now, sizeof(now));
+	pos += sizeof(now);
+
+	va_start(args, site);
+	for (arg_i = 0; arg_i < site->n_args; arg_i++) {
+		int64_t int_val = 0;
+		double double_val;
+		const char *str_val;
+		uint32_t str_len;
+
+		switch (site->kinds[arg_i]) {
+		case ARG_INT:
+			int_val = va_arg(args, int);
+			break;
+		case ARG_LONG:
+			int_val = va_arg(args, long);
+			break;
+		case ARG_LLONG:
+			int_val = va_arg(args, long long);
+			break;
+		case ARG_SIZE:
+			int_val = va_arg(args, size_t);
+			break;
+		case ARG_INTMAX:
+			int_val = va_arg(args, intmax_t);
+			break;
+		case ARG_PTRDIFF:
+			int_val = va_arg(args, ptrdiff_t);
+			break;
+		case ARG_DOUBLE:
+		case ARG_LDOUBLE:
+			double_val = site->kinds[arg_i] == ARG_DOUBLE ?
+				     va_arg(args, double) :
+				     (double) va_arg(args, long double);
+			memcpy(&int_val, &double_val, sizeof(int_val));
+			break;
+		case ARG_STR:
+		case ARG_STR_STAR:
+			/* a negative precision is taken as none */
+			str_len = site->kinds[arg_i] == ARG_STR ||
+				  prev_val < 0 ||
+				  prev_val > LOG_BINARY_MAX_STR ?
+				  site->precs[arg_i] : prev_val;
+			/* the string need not be 0-terminated within it */
+			if ((str_val = va_arg(args, const char *)) == NULL) {
+				str_val = "(null)";
+			}
+			str_len = strnlen(str_val, str_len);
+			memcpy(pos, &str_len, sizeof(str_len));
+			memcpy(pos + sizeof(str_len), str_val, str_len);
+			pos += sizeof(str_len) + str_len;
+			continue;
+		default:
+			int_val = (uintptr_t) va_arg(args, void *);
+			break;
+		}
+		memcpy(pos, &int_val, sizeof(int_val));
+		pos += sizeof(int_val);
+		prev_val = int_val;
+	}
+	va_end(args);
+	buf->len = pos - buf->data;
+
+	if (site->level >= FATAL_LEVEL) {
+		flush_buf(buf);
+	}
+}
+
+int log_binary_flush(void)
+{
+	return own_buf != NULL ? flush_buf(own_buf) : 0;
+}
+
+/* a call site, as described in the stream being decoded */
+struct decoded_site {
+	int level; /* the log level of the site */
+	char *sep; /* the text between the tag and the message */
+	char *fmt; /* the format of the message */
+};
+
+/* the unread part of a stream being decoded */
+struct reader {
+	const char *pos; /* the next byte to read */
+	const char *end; /* one past the last byte */
+};
+
+/*
+ * Read bytes from a stream being decoded
+ * in:		the stream
+ * dst:		where to copy the bytes
+ * len:		the number of bytes
+ * returns	0 iff successful, -1 if the stream ends first
+ */
+static int get_bytes(struct reader *in, void *dst, size_t len)
+{
+	if ((size_t) (in->end - in->pos) < len) {
+		return -1;
+	}
+	memcpy(dst, in->pos, len);
+	in->pos += len;
+
+	return 0;
+}
+
+/*
+ * Read a length and a string from a stream being decoded
+ * in:		the stream
+ * returns	the string, as a new 0-terminated copy, or NULL on failure
+ */
+static char *get_str(struct reader *in)
+{
+	uint32_t len;
+	char *str;
+
+	if (get_bytes(in, &len, sizeof(len)) ||
+	    (size_t) (in->end - in->pos) < len ||
+	    (str = malloc(len + 1)) == NULL) {
+		return NULL;
+	}
+	get_bytes(in, str, len);
+	str[len] = '\0';
+
+	return str;
+}
+
+/*
+ * Read a whole stream into memory
+ * in:		the stream
+ * len:		set to the number of bytes read
+ * returns	the bytes, or NULL on failure
+ */
+static char *read_all(FILE *in, size_t *len)
+{
+	size_t cap = LOG_BINARY_BUF_SIZE;
+	char *data = malloc(cap);
+
+	*len = 0;
+	while (data != NULL) {
+		char *grown;
+
+		*len += fread(data + *len, 1, cap - *len, in);
+		if (*len < cap) {
+			break;
+		}
+		if ((grown = realloc(data, cap * 2)) == NULL) {
+			free(data);
+			return NULL;
+		}
+		data = grown;
+		cap *= 2;
+	}
+	if (data != NULL && ferror(in)) {
+		free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+/*
+ * Render one conversion specification of an event
+ * in:		the stream, at the arguments of the specification
+ * spec:	the specification
+ * out:		where to write the text
+ * returns	0 iff successful, -1 if the stream ends first
+ */
+static int render_spec(struct reader *in, const struct fmt_spec *spec,
+		       FILE *out)
+{
+	/* with room for the two '*' values a specification can have */
+	char conv[MAX_SPEC_LEN + 2 * 12 + 1];
+	char str_val[LOG_BINARY_MAX_STR + 1];
+	size_t conv_len = 0;
+	const char *pos;
+	int64_t int_val;
+	double double_val;
+	uint32_t str_len;
+
+	if (spec->end - spec->start > MAX_SPEC_LEN) {
+		fwrite(spec->start, 1, spec->end - spec->start, out);
+		return 0;
+	}
+	/* replace each '*' with its recorded value */
+	for (pos = spec->start; pos < spec->end; pos++) {
+		if (*pos == '*') {
+			if (get_bytes(in, &int_val, sizeof(int_val))) {
+				return -1;
+			}
+			if (pos[-1] == '.' && int_val < 0) {
+				/* a negative precision is taken as none */
+				conv_len--;
+			} else {
+				conv_len += sprintf(conv + conv_len, "%d",
+						    (int) int_val);
+			}
+		} else {
+			conv[conv_len++] = *pos;
+		}
+	}
+	conv[conv_len] = '\0';
+
+	switch (spec->kind) {
+	case ARG_NONE:
+		/* "%%" prints '%', and anything unknown prints as it is */
+		if (spec->end - spec->start == 2 && spec->end[-1] == '%') {
+			fputc('%', out);
+		} else {
+			fwrite(spec->start, 1, spec->end - spec->start, out);
+		}
+		return 0;
+	case ARG_STR:
+	case ARG_STR_STAR:
+		if (get_bytes(in, &str_len, sizeof(str_len)) ||
+		    str_len > LOG_BINARY_MAX_STR ||
+		    get_bytes(in, str_val, str_len)) {
+			return -1;
+		}
+		str_val[str_len] = '\0';
+		fprintf(out, conv, str_val);
+		return 0;
+	default:
+		break;
+	}
+
+	if (get_bytes(in, &int_val, sizeof(int_val))) {
+		return -1;
+	}
+	memcpy(&double_val, &int_val, sizeof(double_val));
+	switch (spec->kind) {
+	case ARG_INT:
+		fprintf(out, conv, (int) int_val);
+		break;
+	case ARG_LONG:
+		fprintf(out, conv, (long) int_val);
+		break;
+	case ARG_LLONG:
+		fprintf(out, conv, (long long) int_val);
+		break;
+	case ARG_SIZE:
+		fprintf(out, conv, (size_t) int_val);
+		break;
+	case ARG_INTMAX:
+		fprintf(out, conv, (intmax_t) int_val);
+		break;
+	case ARG_PTRDIFF:
+		fprintf(out, conv, (ptrdiff_t) int_val);
+		break;
+	case ARG_DOUBLE:
+		fprintf(out, conv, double_val);
+		break;
+	case ARG_LDOUBLE:
+		fprintf(out, conv, (long double) double_val);
+		break;
+	case ARG_PTR:
+		fprintf(out, conv, (void *) (uintptr_t) int_val);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Render an event as "[TAG]: message"
+ * in:		the stream, at the arguments of the event
+ * site:	the call site of the event
+ * out:		where to write the text
+ * returns	0 iff successful, -1 if the stream ends first
+ */
+static int render_event(struct reader *in, const struct decoded_site *site,
+			FILE *out)
+{
+	const char *pos = site->fmt;
+	struct fmt_spec spec;
+	unsigned n_args = 0;
+
+	fprintf(out, "[%s]%s", getTag(site->level), site->sep);
+	while (next_spec(pos, &spec)) {
+		fwrite(pos, 1, spec.start - pos, out);
+		if (n_args + spec_args(&spec) > LOG_BINARY_MAX_ARGS) {
+			/* the arguments were not recorded */
+			fputs(spec.start, out);
+			return 0;
+		}
+		n_args += spec_args(&spec);
+		if (render_spec(in, &spec, out)) {
+			return -1;
+		}
+		pos = spec.end;
+	}
+	fputs(pos, out);
+
+	return 0;
+}
+
+int log_binary_decode(FILE *in, FILE *out, int timestamps)
+{
+	struct decoded_site *sites = NULL;
+	size_t n_decoded = 0, len, site_i;
+	uint64_t first_time = 0;
+	int have_first = 0, ret = 0;
+	char magic[sizeof(LOG_MAGIC) - 1];
+	uint32_t order;
+	char *data = read_all(in, &len);
+	struct reader reader = {data, data + len};
+
+	if (data == NULL || get_bytes(&reader, magic, sizeof(magic)) ||
+	    memcmp(magic, LOG_MAGIC, sizeof(magic)) ||
+	    get_bytes(&reader, &order, sizeof(order)) ||
+	    order != BYTE_ORDER_MARK) {
+		free(data);
+		return -1;
+	}
+
+	while (reader.pos < reader.end && ret == 0) {
+		char type = *reader.pos++;
+		uint32_t id, line;
+		uint64_t time;
+		unsigned char level;
+
+		if (get_bytes(&reader, &id, sizeof(id))) {
+			ret = -1;
+		} else if (type == SITE_RECORD && id == 0) {
+			/* IDs start at 1, so this is not a log we wrote */
+			ret = -1;
+		} else if (type == SITE_RECORD) {
+			struct decoded_site *grown;
+			char *file;
+
+			if (id > n_decoded) {
+				grown = realloc(sites, id * sizeof(*sites));
+				if (grown == NULL) {
+					ret = -1;
+					break;
+				}
+				memset(grown + n_decoded, 0,
+				       (id - n_decoded) * sizeof(*sites));
+				sites = grown;
+				n_decoded = id;
+			}
+			free(sites[id - 1].sep);
+			free(sites[id - 1].fmt);
+			if (get_bytes(&reader, &level, sizeof(level)) ||
+			    level >= N_LEVELS ||
+			    get_bytes(&reader, &line, sizeof(line)) ||
+			    (file = get_str(&reader)) == NULL) {
+				ret = -1;
+				break;
+			}
+			free(file);
+			sites[id - 1].level = level;
+			sites[id - 1].sep = get_str(&reader);
+			sites[id - 1].fmt = get_str(&reader);
+			if (sites[id - 1].sep == NULL ||
+			    sites[id - 1].fmt == NULL) {
+				ret = -1;
+			}
+		} else if (type == EVENT_RECORD && id >= 1 &&
+			   id <= n_decoded && sites[id - 1].fmt != NULL &&
+			   !get_bytes(&reader, &time, sizeof(time))) {
+			if (!have_first) {
+				first_time = time;
+				have_first = 1;
+			}
+			if (timestamps) {
+				fprintf(out, "%llu ", (unsigned long long)
+						      (time - first_time));
+			}
+			ret = render_event(&reader, &sites[id - 1], out);
+		} else {
+			ret = -1;
+		}
+	}
+
+	for (site_i = 0; site_i < n_decoded; site_i++) {
+		free(sites[site_i].sep);
+		free(sites[site_i].fmt);
+	}
+	free(sites);
+	free(data);
+
+	return ret;
+}
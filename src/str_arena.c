@@ -0,0 +1,66 @@
+#include <str_arena.h>
+#include <c_gen.h>
+#include <logger.h>
+
+/* the arena logs at the threshold of "struct c_gen" */
+#undef LOG_THRESHOLD
+#define LOG_THRESHOLD	C_GEN_LOG_LEVEL
+
+void str_arena_free(struct str_arena *to_free)
+{
+	struct str_arena_block *block = to_free->block;
+
+	while (block != NULL) {
+		struct str_arena_block *next = block->next;
+
+		free(block);
+		block = next;
+	}
+	str_arena_init(to_free);
+}
+
+void str_arena_reset(struct str_arena *to_reset)
+{
+	struct str_arena_block *block;
+	size_t total = to_reset->total;
+
+	if (to_reset->block != NULL && to_reset->block->next != NULL) {
+		str_arena_free(to_reset);
+		/* if this fails, the next string allocates a block anyway */
+		if ((block = malloc(sizeof(*block) + total)) != NULL) {
+			block->next = NULL;
+			block->size = total;
+			to_reset->block = block;
+			to_reset->total = total;
+		}
+	}
+	to_reset->used = 0;
+}
+
+int str_arena_grow(struct str_arena *to_grow, size_t *start, size_t len)
+{
+	struct str_arena_block *block;
+	size_t partial = to_grow->block == NULL ? 0 : to_grow->used - *start;
+	size_t size = to_grow->block == NULL ? STR_ARENA_BLOCK_SIZE :
+		      to_grow->block->size * 2;
+
+	if (size < partial + len) {
+		size = partial + len;
+	}
+	if ((block = malloc(sizeof(*block) + size)) == NULL) {
+		printlg(DEBUG_LEVEL, "Could not grow string arena.\n");
+		return -1;
+	}
+	block->next = to_grow->block;
+	block->size = size;
+	if (partial > 0) {
+		memcpy(block->data, to_grow->block->data + *start, partial);
+	}
+
+	to_grow->block = block;
+	to_grow->used = partial;
+	to_grow->total += size;
+	*start = 0;
+
+	return 0;
+}
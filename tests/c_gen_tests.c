@@ -1,9 +1,14 @@
 #include "c_gen_tests.h"
 
+#include <c_frag.h>
 #include <logger.h>
 
+#include <stdint.h>
+#include <math.h>
+
 static int hello_world_tester(struct c_gen *out)
 {
+	line_gen_set_sticky(&out->base_gen, 1);
 	include(out, STDIO_H_PATH);
 	finish_line(&out->base_gen);
 	declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
@@ -18,7 +23,7 @@ static int hello_world_tester(struct c_gen *out)
 
 	close_block(out);
 
-	return 1;
+	return !line_gen_error(&out->base_gen);
 }
 
 static struct c_gen_tv hello_world = {
@@ -81,6 +86,7 @@ static struct c_gen_tv deep_block = {
 
 static int struct_use_tester(struct c_gen *out)
 {
+	line_gen_set_sticky(&out->base_gen, 1);
 	include(out, STDIO_H_PATH);
 	finish_line(&out->base_gen);
 
@@ -121,7 +127,7 @@ static int struct_use_tester(struct c_gen *out)
 
 	close_block(out);
 
-	return 1;
+	return !line_gen_error(&out->base_gen);
 }
 
 static struct c_gen_tv struct_use = {
@@ -133,6 +139,7 @@ static int array_use_tester(struct c_gen *out)
 {
 	char char_i;
 
+	line_gen_set_sticky(&out->base_gen, 1);
 	include(out, STDIO_H_PATH);
 	finish_line(&out->base_gen);
 
@@ -161,7 +168,7 @@ static int array_use_tester(struct c_gen *out)
 
 	close_block(out);
 
-	return 1;
+	return !line_gen_error(&out->base_gen);
 }
 
 static struct c_gen_tv array_use = {
@@ -169,6 +176,257 @@ static struct c_gen_tv array_use = {
 	.tester = array_use_tester
 };
 
+/* the number of functions emitted as fragments */
+#define N_FRAG_FUNCS	8
+/* the number of threads emitting the fragments */
+#define N_FRAG_THREADS	4
+
+static int frag_func_emitter(struct c_gen *out, size_t frag_i, void *arg)
+{
+	char name[] = "func_0";
+	char value[] = "0";
+
+	(void) arg;
+	name[sizeof(name) - 2] += frag_i;
+	value[0] += frag_i;
+
+	/* sticky-error mode is inherited from the parent */
+	declare_function(out, INT_TP, name, 0);
+	finish_line(&out->base_gen);
+	open_block(out);
+	return_value(out, value);
+	close_block(out);
+	finish_line(&out->base_gen);
+
+	return line_gen_error(&out->base_gen);
+}
+
+static int fragments_tester(struct c_gen *out)
+{
+	size_t order[N_FRAG_FUNCS];
+	size_t frag_i;
+
+	line_gen_set_sticky(&out->base_gen, 1);
+	include(out, STDIO_H_PATH);
+	finish_line(&out->base_gen);
+
+	/* splice the functions in reverse */
+	for (frag_i = 0; frag_i < N_FRAG_FUNCS; frag_i++) {
+		order[frag_i] = N_FRAG_FUNCS - 1 - frag_i;
+	}
+	if (c_gen_fragments(out, N_FRAG_FUNCS, order, frag_func_emitter, NULL,
+			    N_FRAG_THREADS)) {
+		printlg(ERROR_LEVEL, "Could not emit fragments.\n");
+		return 0;
+	}
+
+	declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+
+	finish_line(&out->base_gen);
+	open_block(out);
+
+	line_gen_write("return func_7() - func_0() - 7", &out->base_gen);
+	end_statement(out);
+
+	close_block(out);
+
+	return !line_gen_error(&out->base_gen);
+}
+
+static struct c_gen_tv fragments = {
+	.expected_file = "fragments.c",
+	.tester = fragments_tester
+};
+
+/* the number of entries of the generated lookup table */
+#define N_TABLE_ENTRIES	40
+/* the number of entries of the arrays of the smallest values of types */
+#define N_MIN_ENTRIES	24
+
+static int table_use_tester(struct c_gen *out)
+{
+	static const int32_t limits[] = {
+		INT32_MIN, -1, 0, 1, INT32_MAX, -2147483647
+	};
+	static const uint64_t sizes[] = {
+		0, 1000000007, UINT64_MAX, (uint64_t) INT64_MAX + 1
+	};
+	static const int64_t offsets[] = {INT64_MIN, -12, INT64_MAX};
+	static const double scales[] = {
+		0.1, -2.5, 1e300, 5e-324, 0, 1e22, 1.5e-7, -INFINITY
+	};
+	static const float ratios[] = {
+		1.0f / 3, -0.0f, 16777216.0f, 3.4028235e38f, 1e-45f, NAN
+	};
+	uint8_t table[N_TABLE_ENTRIES];
+	int16_t deltas[N_TABLE_ENTRIES];
+	int8_t bytes_min[N_MIN_ENTRIES];
+	int16_t shorts_min[N_MIN_ENTRIES];
+	size_t entry_i;
+
+	for (entry_i = 0; entry_i < N_TABLE_ENTRIES; entry_i++) {
+		table[entry_i] = entry_i * 37 + 11;
+		deltas[entry_i] = (int16_t) (entry_i * 1777 - 30000);
+	}
+	/* mostly the smallest values, which fill the lines the most */
+	for (entry_i = 0; entry_i < N_MIN_ENTRIES; entry_i++) {
+		bytes_min[entry_i] = entry_i % 5 == 4 ? INT8_MAX : INT8_MIN;
+		shorts_min[entry_i] = entry_i % 5 == 4 ? -1 : INT16_MIN;
+	}
+
+	line_gen_set_sticky(&out->base_gen, 1);
+	include(out, "stdint.h");
+	include(out, "math.h");
+	finish_line(&out->base_gen);
+
+	emit_array(out, "table", C_ARRAY_U8, table, N_TABLE_ENTRIES, 0,
+		   C_ARRAY_HEX);
+	emit_array(out, "deltas", C_ARRAY_I16, deltas, N_TABLE_ENTRIES, 0,
+		   C_ARRAY_DEC);
+	emit_array(out, "bytes_min", C_ARRAY_I8, bytes_min, N_MIN_ENTRIES, 0,
+		   C_ARRAY_DEC);
+	emit_array(out, "bytes_min_hex", C_ARRAY_I8, bytes_min, N_MIN_ENTRIES,
+		   0, C_ARRAY_HEX);
+	emit_array(out, "shorts_min", C_ARRAY_I16, shorts_min, N_MIN_ENTRIES,
+		   0, C_ARRAY_DEC);
+	emit_array(out, "shorts_min_hex", C_ARRAY_I16, shorts_min,
+		   N_MIN_ENTRIES, 0, C_ARRAY_HEX);
+	emit_array(out, "limits", C_ARRAY_I32, limits,
+		   sizeof(limits) / sizeof(limits[0]), 4, C_ARRAY_DEC);
+	emit_array(out, "limits_hex", C_ARRAY_I32, limits,
+		   sizeof(limits) / sizeof(limits[0]), 2, C_ARRAY_HEX);
+	emit_array(out, "sizes", C_ARRAY_U64, sizes,
+		   sizeof(sizes) / sizeof(sizes[0]), 1, C_ARRAY_DEC);
+	emit_array(out, "offsets", C_ARRAY_I64, offsets,
+		   sizeof(offsets) / sizeof(offsets[0]), 0, C_ARRAY_DEC);
+	emit_array(out, "scales", C_ARRAY_DOUBLE, scales,
+		   sizeof(scales) / sizeof(scales[0]), 0, C_ARRAY_DEC);
+	emit_array(out, "scales_hex", C_ARRAY_DOUBLE, scales,
+		   sizeof(scales) / sizeof(scales[0]), 0, C_ARRAY_HEX);
+	emit_array(out, "ratios", C_ARRAY_FLOAT, ratios,
+		   sizeof(ratios) / sizeof(ratios[0]), 0, C_ARRAY_DEC);
+	emit_array(out, "ratios_hex", C_ARRAY_FLOAT, ratios,
+		   sizeof(ratios) / sizeof(ratios[0]), 0, C_ARRAY_HEX);
+	finish_line(&out->base_gen);
+
+	declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+	finish_line(&out->base_gen);
+	open_block(out);
+	line_gen_write("return scales[1] != ", &out->base_gen);
+	write_double_literal(out, scales[1], C_ARRAY_DEC);
+	line_gen_write(" || ratios[0] != ", &out->base_gen);
+	write_float_literal(out, ratios[0], C_ARRAY_HEX);
+	end_statement(out);
+	close_block(out);
+
+	return !line_gen_error(&out->base_gen);
+}
+
+static struct c_gen_tv table_use = {
+	.expected_file = "table_use.c",
+	.tester = table_use_tester
+};
+
+/* the file embedded by "embed_use_tester", relative to the tests */
+#define EMBEDDED_PATH	"expected/hello_world.c"
+
+static int embed_use_tester(struct c_gen *out)
+{
+	line_gen_set_sticky(&out->base_gen, 1);
+	include(out, "stddef.h");
+	include(out, "stdint.h");
+	include(out, "string.h");
+	finish_line(&out->base_gen);
+
+	embed_file(out, "blob", EMBEDDED_PATH, C_EMBED_ARRAY, 0,
+		   C_ARRAY_HEX);
+	finish_line(&out->base_gen);
+	embed_file(out, "blob_bin", EMBEDDED_PATH, C_EMBED_INCBIN, 0,
+		   C_ARRAY_HEX);
+	finish_line(&out->base_gen);
+
+	declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+	finish_line(&out->base_gen);
+	open_block(out);
+	line_gen_write("return blob_len != blob_bin_len || "
+		       "memcmp(blob, blob_bin, blob_len)", &out->base_gen);
+	end_statement(out);
+	close_block(out);
+
+	return !line_gen_error(&out->base_gen);
+}
+
+static struct c_gen_tv embed_use = {
+	.expected_file = "embed_use.c",
+	.tester = embed_use_tester
+};
+
+/* a string with every kind of escape */
+#define ESCAPED_STR	"say \"hi\" \\ ?\?= \t\001\x7f caf\xc3\xa9 1"
+/* a string with line breaks, and a line too long for one literal */
+#define LINES_STR	"first line\nsecond line\n" \
+			"a line that is much longer than fits on a single " \
+			"line of generated code, so it is split where it is " \
+			"full\n"
+/* a string that fits on a line of its own, but not after a declaration */
+#define OWN_LINE_STR	"this fits on a line of its own, but not after its name"
+
+static int string_use_tester(struct c_gen *out)
+{
+	static const char *const list[] = {"short", LINES_STR};
+	size_t str_i;
+
+	line_gen_set_sticky(&out->base_gen, 1);
+	include(out, "string.h");
+	finish_line(&out->base_gen);
+
+	line_gen_printf(&out->base_gen, STATIC_KW " const " VAR_DEF_FMT,
+			CHAR_TP, "escaped[]");
+	emit_string_literal(out, ESCAPED_STR, sizeof(ESCAPED_STR) - 1);
+	end_statement(out);
+	line_gen_printf(&out->base_gen, STATIC_KW " const " VAR_DEF_FMT,
+			CHAR_TP, "lines[]");
+	emit_string_literal(out, LINES_STR, sizeof(LINES_STR) - 1);
+	end_statement(out);
+	line_gen_printf(&out->base_gen, STATIC_KW " const " VAR_DEF_FMT,
+			CHAR_TP " *const", "list[]");
+	open_block(out);
+	for (str_i = 0; str_i < sizeof(list) / sizeof(list[0]); str_i++) {
+		emit_string_literal(out, list[str_i], strlen(list[str_i]));
+		line_gen_write(",", &out->base_gen);
+		finish_line(&out->base_gen);
+	}
+	_close_block(out);
+	end_statement(out);
+	line_gen_printf(&out->base_gen, STATIC_KW " const " VAR_DEF_FMT,
+			CHAR_TP, "own_line[]");
+	emit_string_literal(out, OWN_LINE_STR, sizeof(OWN_LINE_STR) - 1);
+	end_statement(out);
+	line_gen_printf(&out->base_gen, STATIC_KW " const " VAR_DEF_FMT,
+			CHAR_TP, "empty[]");
+	emit_string_literal(out, "", 0);
+	end_statement(out);
+	finish_line(&out->base_gen);
+
+	declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+	finish_line(&out->base_gen);
+	open_block(out);
+	line_gen_printf(&out->base_gen,
+			"return sizeof(escaped) != %u || "
+			"strcmp(list[1], lines) || empty[0]",
+			(unsigned) sizeof(ESCAPED_STR));
+	end_statement(out);
+	close_block(out);
+
+	return !line_gen_error(&out->base_gen);
+}
+
+static struct c_gen_tv string_use = {
+	.expected_file = "string_use.c",
+	.tester = string_use_tester
+};
+
 struct c_gen_tv *c_gen_tvs[N_C_GEN_TESTS] = {
-	&hello_world, &deep_block, &struct_use, &array_use
+	&hello_world, &deep_block, &struct_use, &array_use, &fragments,
+	&table_use, &embed_use, &string_use
 };
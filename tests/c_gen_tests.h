@@ -15,6 +15,6 @@ struct c_gen_tv {
 	int (*tester)(struct c_gen *out);
 };
 
-#define N_C_GEN_TESTS	4
+#define N_C_GEN_TESTS	8
 /* the tests over which test_cs will run */
 extern struct c_gen_tv *c_gen_tvs[N_C_GEN_TESTS];
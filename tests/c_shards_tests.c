@@ -0,0 +1,247 @@
+#include "c_shards_tests.h"
+#include <c_shards.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the prefix of the files of the shards, which are removed after the test */
+#define SHARDS_PREFIX	"shards_out"
+/* the number of shards */
+#define N_TEST_SHARDS	3
+/* the number of functions, which get longer one after another */
+#define N_TEST_FUNCS	9
+/* the longest name of a function */
+#define MAX_FUNC_NAME	16
+
+/* the text expected at the start of every shard */
+#define PRELUDE		"#include <stdio.h>\n\n#define STEP 3\n\n" \
+			"#include \"" SHARDS_PREFIX ".h\"\n\n"
+/* the text expected in the header */
+#define HEADER_START	"#ifndef SHARDS_OUT_H\n#define SHARDS_OUT_H\n\n"
+#define HEADER_PROTO	"int fn_%u(int x);\n"
+#define HEADER_END	"int twice(int x);\nint main();\n\n" \
+			"#endif /* SHARDS_OUT_H */\n"
+
+/*
+ * Read a whole file
+ * path:	the path of the file
+ * returns	the contents, 0-terminated, to be released with free,
+ *		or NULL if reading failed
+ */
+static char *read_file(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	char *text = NULL;
+	long len;
+
+	if (file == NULL) {
+		return NULL;
+	}
+	if (fseek(file, 0, SEEK_END) == 0 && (len = ftell(file)) >= 0 &&
+	    fseek(file, 0, SEEK_SET) == 0 &&
+	    (text = malloc(len + 1)) != NULL) {
+		if (fread(text, 1, len, file) != (size_t) len) {
+			free(text);
+			text = NULL;
+		} else {
+			text[len] = '\0';
+		}
+	}
+	fclose(file);
+
+	return text;
+}
+
+/*
+ * Write a function, after a comment, that adds STEP to its argument
+ * as many times as its number, plus one
+ * out:		the generator to write to
+ * func_i:	the number of the function
+ * returns	1 iff successful, else return 0
+ */
+static int gen_func(struct c_gen *out, size_t func_i)
+{
+	struct typed_var arg = {INT_TP, "x"};
+	char name[MAX_FUNC_NAME];
+	size_t line_i;
+
+	snprintf(name, sizeof(name), "fn_%u", (unsigned) func_i);
+	line_gen_printf(&out->base_gen, "/* %s { adds } */", name);
+	finish_line(&out->base_gen);
+	declare_function(out, INT_TP, name, 1, &arg);
+	finish_line(&out->base_gen);
+	open_block(out);
+	for (line_i = 0; line_i <= func_i; line_i++) {
+		line_gen_write("x += STEP", &out->base_gen);
+		end_statement(out);
+	}
+	return_value(out, "x");
+	close_block(out);
+	finish_line(&out->base_gen);
+
+	return line_gen_error(&out->base_gen) == 0;
+}
+
+/*
+ * Write the functions, a static helper after a table that is not static,
+ * an inline function, and a main function that calls them,
+ * from whichever shard it lands in
+ * shards:	the shards to write to
+ * max_len:	set to the size of the longest function
+ * returns	1 iff successful, else return 0
+ */
+static int gen_funcs(struct c_shards *shards, size_t *max_len)
+{
+	struct typed_var arg = {INT_TP, "x"};
+	struct c_gen *out;
+	size_t func_i, shard_i, total = 0;
+
+	*max_len = 0;
+	for (func_i = 0; func_i <= N_TEST_FUNCS + 2; func_i++) {
+		size_t new_total = 0;
+
+		if ((out = c_shards_start_function(shards)) == NULL) {
+			return 0;
+		}
+		if (func_i < N_TEST_FUNCS) {
+			gen_func(out, func_i);
+		} else if (func_i == N_TEST_FUNCS) {
+			/* neither gets a prototype */
+			line_gen_write(INT_TP " (*table)[2] = 0",
+				       &out->base_gen);
+			end_statement(out);
+			declare_function(out, STATIC_KW " " INT_TP, "helper",
+					 0);
+			finish_line(&out->base_gen);
+			open_block(out);
+			return_value(out, "STEP");
+			close_block(out);
+			finish_line(&out->base_gen);
+		} else if (func_i == N_TEST_FUNCS + 1) {
+			declare_function(out, INLINE_KW " " INT_TP, "twice", 1,
+					 &arg);
+			finish_line(&out->base_gen);
+			open_block(out);
+			return_value(out, "x * 2");
+			close_block(out);
+			finish_line(&out->base_gen);
+		} else {
+			declare_function(out, INT_TP, MAIN_FUNC_NAME, 0);
+			finish_line(&out->base_gen);
+			open_block(out);
+			line_gen_printf(&out->base_gen,
+					"printf(\"%%d\\n\", fn_%u(0))",
+					N_TEST_FUNCS - 1);
+			end_statement(out);
+			return_value(out, "0");
+			close_block(out);
+		}
+		if (c_shards_end_function(shards)) {
+			return 0;
+		}
+
+		for (shard_i = 0; shard_i < N_TEST_SHARDS; shard_i++) {
+			new_total += shards->loads[shard_i];
+		}
+		if (new_total - total > *max_len) {
+			*max_len = new_total - total;
+		}
+		total = new_total;
+	}
+
+	return 1;
+}
+
+/*
+ * Check that the shards are balanced, ie. that every shard has functions,
+ * and that adding a function to the least loaded one
+ * could not have made it more loaded than any other
+ * shards:	the shards to check
+ * max_len:	the size of the longest function
+ * returns	1 iff successful, else return 0
+ */
+static int check_balance(const struct c_shards *shards, size_t max_len)
+{
+	size_t shard_i, least = shards->loads[0], most = shards->loads[0];
+
+	for (shard_i = 1; shard_i < N_TEST_SHARDS; shard_i++) {
+		if (shards->loads[shard_i] < least) {
+			least = shards->loads[shard_i];
+		}
+		if (shards->loads[shard_i] > most) {
+			most = shards->loads[shard_i];
+		}
+	}
+
+	return least > 0 && most - least <= max_len;
+}
+
+/*
+ * Check the header, and the start of every shard
+ * returns	1 iff successful, else return 0
+ */
+static int check_files(void)
+{
+	char path[sizeof(SHARDS_PREFIX) + 16];
+	char proto[sizeof(HEADER_PROTO) + 16];
+	char *text;
+	const char *pos;
+	size_t shard_i, func_i;
+	int ok = 1;
+
+	if ((text = read_file(SHARDS_PREFIX ".h")) == NULL) {
+		return 0;
+	}
+	ok = !strncmp(text, HEADER_START, sizeof(HEADER_START) - 1);
+	pos = text + sizeof(HEADER_START) - 1;
+	/* the prototypes are in the order of the functions */
+	for (func_i = 0; ok && func_i < N_TEST_FUNCS; func_i++) {
+		snprintf(proto, sizeof(proto), HEADER_PROTO,
+			 (unsigned) func_i);
+		ok = !strncmp(pos, proto, strlen(proto));
+		pos += strlen(proto);
+	}
+	ok = ok && !strcmp(pos, HEADER_END);
+	free(text);
+	remove(SHARDS_PREFIX ".h");
+
+	for (shard_i = 0; shard_i < N_TEST_SHARDS; shard_i++) {
+		snprintf(path, sizeof(path), SHARDS_PREFIX "_%u.c",
+			 (unsigned) shard_i);
+		if ((text = read_file(path)) == NULL) {
+			ok = 0;
+			continue;
+		}
+		/* something follows the prelude in every shard */
+		ok = ok && strlen(text) > sizeof(PRELUDE) - 1 &&
+		     !strncmp(text, PRELUDE, sizeof(PRELUDE) - 1);
+		free(text);
+		remove(path);
+	}
+
+	return ok;
+}
+
+int test_c_shards(void)
+{
+	struct c_shards shards;
+	struct c_gen *prelude;
+	size_t max_len;
+	int ok;
+
+	if (c_shards_open(&shards, SHARDS_PREFIX, N_TEST_SHARDS)) {
+		return 0;
+	}
+	prelude = c_shards_prelude(&shards);
+	include(prelude, STDIO_H_PATH);
+	finish_line(&prelude->base_gen);
+	line_gen_printf(&prelude->base_gen, MACRO_FMT, "STEP", "3");
+	finish_line(&prelude->base_gen);
+	finish_line(&prelude->base_gen);
+
+	ok = gen_funcs(&shards, &max_len) && check_balance(&shards, max_len);
+	ok = c_shards_close(&shards) == 0 && ok;
+
+	return check_files() && ok;
+}
@@ -0,0 +1,16 @@
+/*
+ * tests for generating a translation unit as shards
+ */
+#ifndef C_SHARDS_TESTS_H
+#define C_SHARDS_TESTS_H
+
+/*
+ * Generate functions of different sizes into shards,
+ * and check that every shard starts with the prelude,
+ * that the header has the prototypes of the functions that are not static,
+ * and that the shards are balanced by size
+ * returns	1 iff successful, else return 0
+ */
+int test_c_shards(void);
+
+#endif /* C_SHARDS_TESTS_H */
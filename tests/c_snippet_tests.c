@@ -0,0 +1,145 @@
+#include "c_snippet_tests.h"
+#include <c_snippet.h>
+
+#include <string.h>
+
+/* the depth of the deepest replay, below MAX_C_INDENTS */
+#define MAX_TEST_DEPTH	3
+
+/*
+ * Record an error check, followed by a blank line
+ */
+static int check_recorder(struct c_gen *out, void *arg)
+{
+	(void) arg;
+	line_gen_write("if (ret)", &out->base_gen);
+	open_block(out);
+	line_gen_write("puts(\"failed\")", &out->base_gen);
+	end_statement(out);
+	return_value(out, "ret");
+	close_block(out);
+	finish_line(&out->base_gen);
+	finish_line(&out->base_gen);
+
+	return line_gen_error(&out->base_gen);
+}
+
+/*
+ * Record the start of a switch, which leaves its block open
+ */
+static int switch_recorder(struct c_gen *out, void *arg)
+{
+	(void) arg;
+	line_gen_write("switch (x)", &out->base_gen);
+	open_block(out);
+	line_gen_write("case 0:", &out->base_gen);
+	indent(&out->base_gen);
+	return_value(out, "1");
+	unindent(&out->base_gen);
+	line_gen_write("default:", &out->base_gen);
+	indent(&out->base_gen);
+	line_gen_write("break", &out->base_gen);
+	end_statement(out);
+	unindent(&out->base_gen);
+
+	return line_gen_error(&out->base_gen);
+}
+
+/*
+ * Generate nested blocks with both snippets at every depth into a memory sink
+ * snippets:	the recorded snippets, or NULL to call the recorders
+ * spaces:	the number of spaces per depth,
+ *		or 0 to indent in the default style
+ * sink:	set to the memory sink holding the output
+ * returns	1 iff successful, else return 0
+ */
+static int gen_nested(const struct c_snippet *snippets, size_t spaces,
+		      struct line_sink *sink)
+{
+	struct c_gen out;
+	size_t depth;
+	int ret;
+
+	if (line_sink_mem(sink, 0)) {
+		return 0;
+	}
+	init_c_gen_sink(&out, sink);
+	line_gen_set_sticky(&out.base_gen, 1);
+	if (spaces > 0) {
+		line_gen_set_indent(&out.base_gen, ' ', spaces);
+	}
+	for (depth = 0; depth < MAX_TEST_DEPTH; depth++) {
+		if (snippets == NULL) {
+			check_recorder(&out, NULL);
+			switch_recorder(&out, NULL);
+		} else {
+			c_snippet_emit(&snippets[0], &out);
+			c_snippet_emit(&snippets[1], &out);
+		}
+	}
+	for (depth = 0; depth < MAX_TEST_DEPTH; depth++) {
+		close_block(&out);
+		finish_line(&out.base_gen);
+	}
+	ret = close_c_gen(&out);
+	*sink = out.base_gen.sink;
+
+	return ret == 0;
+}
+
+int test_c_snippet(void)
+{
+	struct c_snippet snippets[2];
+	struct line_sink expected, replayed, full;
+	const char *expected_data, *replayed_data;
+	size_t expected_len, replayed_len, spaces;
+	struct c_gen out;
+	int ret;
+
+	if (c_snippet_record(&snippets[0], check_recorder, NULL)) {
+		return 0;
+	}
+	if (c_snippet_record(&snippets[1], switch_recorder, NULL)) {
+		c_snippet_free(&snippets[0]);
+		return 0;
+	}
+
+	/* the prerendered snippets, and then the lines one by one */
+	ret = snippets[0].max_depth == 1 && snippets[1].max_depth == 2 &&
+	      snippets[1].end_depth == 1;
+	for (spaces = 0; spaces <= 4; spaces += 4) {
+		if (!gen_nested(NULL, spaces, &expected)) {
+			ret = 0;
+			continue;
+		}
+		if (!gen_nested(snippets, spaces, &replayed)) {
+			line_sink_mem_free(&expected);
+			ret = 0;
+			continue;
+		}
+		expected_data = line_sink_mem_data(&expected, &expected_len);
+		replayed_data = line_sink_mem_data(&replayed, &replayed_len);
+		ret = ret && expected_len == replayed_len &&
+		      !memcmp(expected_data, replayed_data, expected_len);
+		line_sink_mem_free(&expected);
+		line_sink_mem_free(&replayed);
+	}
+
+	/* a replay that would go past the maximum writes nothing */
+	if (line_sink_mem(&full, 0)) {
+		ret = 0;
+	} else {
+		init_c_gen_sink(&out, &full);
+		out.base_gen.indent = MAX_C_INDENTS - 1;
+		ret = ret && c_snippet_emit(&snippets[1], &out) == -2 &&
+		      out.base_gen.buf_used == 0 &&
+		      out.base_gen.indent == MAX_C_INDENTS - 1;
+		close_c_gen(&out);
+		line_sink_mem_free(&out.base_gen.sink);
+	}
+
+	c_snippet_free(&snippets[0]);
+	c_snippet_free(&snippets[1]);
+
+	return ret;
+}
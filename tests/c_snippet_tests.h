@@ -0,0 +1,14 @@
+/*
+ * tests for prerendered snippets
+ */
+#ifndef C_SNIPPET_TESTS_H
+#define C_SNIPPET_TESTS_H
+
+/*
+ * Replay snippets at several depths, and check that the output is the same
+ * as calling their recorders, and that "max_indent" is respected
+ * returns	1 iff successful, else return 0
+ */
+int test_c_snippet(void);
+
+#endif /* C_SNIPPET_TESTS_H */
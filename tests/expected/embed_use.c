@@ -0,0 +1,30 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static const uint8_t blob[73] = {
+	0x23, 0x69, 0x6e, 0x63, 0x6c, 0x75, 0x64, 0x65, 0x20, 0x3c, 0x73, 0x74,
+	0x64, 0x69, 0x6f, 0x2e, 0x68, 0x3e, 0x0a, 0x0a, 0x69, 0x6e, 0x74, 0x20,
+	0x6d, 0x61, 0x69, 0x6e, 0x28, 0x29, 0x0a, 0x7b, 0x0a, 0x09, 0x70, 0x72,
+	0x69, 0x6e, 0x74, 0x66, 0x28, 0x22, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20,
+	0x57, 0x6f, 0x72, 0x6c, 0x64, 0x21, 0x5c, 0x6e, 0x22, 0x29, 0x3b, 0x0a,
+	0x09, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x30, 0x3b, 0x0a, 0x7d,
+	0x0a,
+};
+static const size_t blob_len = 73;
+
+__asm__(
+	".section .rodata\n"
+	".global blob_bin\n"
+	".balign 16\n"
+	"blob_bin:\n"
+	".incbin \"expected/hello_world.c\"\n"
+	".previous\n"
+);
+extern const uint8_t blob_bin[];
+static const size_t blob_bin_len = 73;
+
+int main()
+{
+	return blob_len != blob_bin_len || memcmp(blob, blob_bin, blob_len);
+}
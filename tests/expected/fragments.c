@@ -0,0 +1,46 @@
+#include <stdio.h>
+
+int func_7()
+{
+	return 7;
+}
+
+int func_6()
+{
+	return 6;
+}
+
+int func_5()
+{
+	return 5;
+}
+
+int func_4()
+{
+	return 4;
+}
+
+int func_3()
+{
+	return 3;
+}
+
+int func_2()
+{
+	return 2;
+}
+
+int func_1()
+{
+	return 1;
+}
+
+int func_0()
+{
+	return 0;
+}
+
+int main()
+{
+	return func_7() - func_0() - 7;
+}
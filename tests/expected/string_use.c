@@ -0,0 +1,23 @@
+#include <string.h>
+
+static const char escaped[] = "say \"hi\" \\ ?\?= \t\001\177 caf\303\251 1";
+static const char lines[] =
+	"first line\n"
+	"second line\n"
+	"a line that is much longer than fits on a single line of generated co"
+	"de, so it is split where it is full\n";
+static const char *const list[] = {
+	"short",
+	"first line\n"
+	"second line\n"
+	"a line that is much longer than fits on a single line of generated co"
+	"de, so it is split where it is full\n",
+};
+static const char own_line[] =
+	"this fits on a line of its own, but not after its name";
+static const char empty[] = "";
+
+int main()
+{
+	return sizeof(escaped) != 27 || strcmp(list[1], lines) || empty[0];
+}
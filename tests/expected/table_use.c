@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <math.h>
+
+static const uint8_t table[40] = {
+	0x0b, 0x30, 0x55, 0x7a, 0x9f, 0xc4, 0xe9, 0x0e, 0x33, 0x58, 0x7d, 0xa2,
+	0xc7, 0xec, 0x11, 0x36, 0x5b, 0x80, 0xa5, 0xca, 0xef, 0x14, 0x39, 0x5e,
+	0x83, 0xa8, 0xcd, 0xf2, 0x17, 0x3c, 0x61, 0x86, 0xab, 0xd0, 0xf5, 0x1a,
+	0x3f, 0x64, 0x89, 0xae,
+};
+static const int16_t deltas[40] = {
+	-30000, -28223, -26446, -24669, -22892, -21115, -19338, -17561, -15784,
+	-14007, -12230, -10453, -8676, -6899, -5122, -3345, -1568, 209,
+	1986, 3763, 5540, 7317, 9094, 10871, 12648, 14425, 16202,
+	17979, 19756, 21533, 23310, 25087, 26864, 28641, 30418, 32195,
+	-31564, -29787, -28010, -26233,
+};
+static const int8_t bytes_min[24] = {
+	-128, -128, -128, -128, 127, -128, -128, -128, -128, 127, -128, -128,
+	-128, -128, 127, -128, -128, -128, -128, 127, -128, -128, -128, -128,
+};
+static const int8_t bytes_min_hex[24] = {
+	-0x80, -0x80, -0x80, -0x80, 0x7f, -0x80, -0x80, -0x80, -0x80, 0x7f,
+	-0x80, -0x80, -0x80, -0x80, 0x7f, -0x80, -0x80, -0x80, -0x80, 0x7f,
+	-0x80, -0x80, -0x80, -0x80,
+};
+static const int16_t shorts_min[24] = {
+	-32768, -32768, -32768, -32768, -1, -32768, -32768, -32768, -32768,
+	-1, -32768, -32768, -32768, -32768, -1, -32768, -32768, -32768,
+	-32768, -1, -32768, -32768, -32768, -32768,
+};
+static const int16_t shorts_min_hex[24] = {
+	-0x8000, -0x8000, -0x8000, -0x8000, -0x0001, -0x8000, -0x8000, -0x8000,
+	-0x8000, -0x0001, -0x8000, -0x8000, -0x8000, -0x8000, -0x0001, -0x8000,
+	-0x8000, -0x8000, -0x8000, -0x0001, -0x8000, -0x8000, -0x8000, -0x8000,
+};
+static const int32_t limits[6] = {
+	INT32_MIN, -1, 0, 1,
+	2147483647, -2147483647,
+};
+static const int32_t limits_hex[6] = {
+	INT32_MIN, -0x00000001,
+	0x00000000, 0x00000001,
+	0x7fffffff, -0x7fffffff,
+};
+static const uint64_t sizes[4] = {
+	0,
+	1000000007,
+	18446744073709551615u,
+	9223372036854775808u,
+};
+static const int64_t offsets[3] = {
+	INT64_MIN, -12, 9223372036854775807,
+};
+static const double scales[8] = {
+	0.1, -2.5,
+	1e300, 5e-324,
+	0.0, 1e22,
+	1.5e-7, -INFINITY,
+};
+static const double scales_hex[8] = {
+	0x1.999999999999ap-4, -0x1.4p1,
+	0x1.7e43c8800759cp996, 0x0.0000000000001p-1022,
+	0.0, 0x1.0f0cf064dd592p73,
+	0x1.421f5f40d8376p-23, -INFINITY,
+};
+static const float ratios[6] = {
+	0.33333334f, -0.0f, 16777216.0f,
+	3.4028235e38f, 1e-45f, NAN,
+};
+static const float ratios_hex[6] = {
+	0x1.555556p-2f, -0.0f, 0x1p24f,
+	0x1.fffffep127f, 0x1p-149f, NAN,
+};
+
+int main()
+{
+	return scales[1] != -2.5 || ratios[0] != 0x1.555556p-2f;
+}
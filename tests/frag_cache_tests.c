@@ -0,0 +1,179 @@
+#include "frag_cache_tests.h"
+#include <frag_cache.h>
+
+#include <string.h>
+#include <unistd.h>
+
+/* the folder of the cache, which is removed after the test */
+#define CACHE_DIR	"frag_cache"
+/* the number of fragments in the generated function */
+#define N_BRANCHES	3
+/* a size bound that fits every fragment of the test */
+#define CACHE_BYTES	(1024 * 1024)
+/* the key of the branch emitted close to the maximum depth */
+#define DEEP_KEY	(N_BRANCHES + 1)
+
+/*
+ * Emit a branch of the generated function, followed by a blank line
+ */
+static int branch_emitter(struct c_gen *out, size_t frag_i, void *arg)
+{
+	(void) arg;
+	line_gen_printf(&out->base_gen, "if (x == %u)", (unsigned) frag_i);
+	open_block(out);
+	return_value(out, "x");
+	close_block(out);
+	finish_line(&out->base_gen);
+	finish_line(&out->base_gen);
+
+	return line_gen_error(&out->base_gen);
+}
+
+/*
+ * Generate a function made of branches into a memory sink
+ * cache:	the cache through which to emit the branches,
+ *		or NULL to emit them directly
+ * sink:	set to the memory sink holding the function
+ * returns	1 iff successful, else return 0
+ */
+static int gen_branches(struct frag_cache *cache, struct line_sink *sink)
+{
+	struct c_gen out;
+	size_t frag_i;
+	int ret;
+
+	if (line_sink_mem(sink, 0)) {
+		return 0;
+	}
+	init_c_gen_sink(&out, sink);
+	line_gen_set_sticky(&out.base_gen, 1);
+	line_gen_write("int pick(int x)", &out.base_gen);
+	finish_line(&out.base_gen);
+	open_block(&out);
+	for (frag_i = 0; frag_i < N_BRANCHES; frag_i++) {
+		if (cache == NULL) {
+			branch_emitter(&out, frag_i, NULL);
+		} else {
+			frag_cache_emit(cache, &out, frag_i + 1,
+					branch_emitter, frag_i, NULL);
+		}
+	}
+	return_value(&out, "0");
+	close_block(&out);
+	finish_line(&out.base_gen);
+	ret = close_c_gen(&out);
+	*sink = out.base_gen.sink;
+
+	return ret == 0;
+}
+
+/*
+ * Check that generating through a cache gives the expected output,
+ * with the expected number of hits and misses
+ * cache:	the cache to generate through
+ * expected:	the output of generating directly
+ * n_hits:	the expected number of hits
+ * returns	1 iff successful, else return 0
+ */
+static int check_cached(struct frag_cache *cache,
+			const struct line_sink *expected, size_t n_hits)
+{
+	struct line_sink sink;
+	const char *data, *expected_data;
+	size_t len, expected_len;
+	int ret;
+
+	if (!gen_branches(cache, &sink)) {
+		return 0;
+	}
+	data = line_sink_mem_data(&sink, &len);
+	expected_data = line_sink_mem_data(expected, &expected_len);
+	ret = len == expected_len && !memcmp(data, expected_data, len) &&
+	      cache->n_hits == n_hits &&
+	      cache->n_misses == N_BRANCHES - n_hits;
+	line_sink_mem_free(&sink);
+
+	return ret;
+}
+
+/*
+ * Check that a cached branch, which goes one deeper than it starts,
+ * fails on a hit at the maximum depth, as emitting it directly would
+ * cache:	the cache to emit through
+ * returns	1 iff successful, else return 0
+ */
+static int check_too_deep(struct frag_cache *cache)
+{
+	struct line_sink sink;
+	struct c_gen out;
+	size_t n_misses = cache->n_misses;
+	int ret;
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	str_arena_init(&out.arena);
+	out.protos = NULL;
+	init_line_gen_sink(&out.base_gen, 1, &sink, LINE_GEN_BUF_SIZE);
+	ret = frag_cache_emit(cache, &out, DEEP_KEY, branch_emitter, 0,
+			      NULL) == 0 &&
+	      indent(&out.base_gen) == 0 &&
+	      frag_cache_emit(cache, &out, DEEP_KEY, branch_emitter, 0,
+			      NULL) == -2 &&
+	      cache->n_misses == n_misses + 1;
+	close_c_gen(&out);
+	line_sink_mem_free(&out.base_gen.sink);
+
+	return ret;
+}
+
+int test_frag_cache(void)
+{
+	struct frag_cache cache;
+	struct line_sink expected;
+	size_t full_bytes;
+	int ret;
+
+	/* a bound of 0 empties the folder of any earlier run */
+	if (frag_cache_open(&cache, CACHE_DIR, 0)) {
+		return 0;
+	}
+	frag_cache_close(&cache);
+	if (!gen_branches(NULL, &expected)) {
+		return 0;
+	}
+
+	ret = !frag_cache_open(&cache, CACHE_DIR, CACHE_BYTES) &&
+	      check_cached(&cache, &expected, 0);
+	frag_cache_close(&cache);
+	ret = ret && !frag_cache_open(&cache, CACHE_DIR, CACHE_BYTES) &&
+	      check_cached(&cache, &expected, N_BRANCHES) &&
+	      cache.n_entries == N_BRANCHES;
+	full_bytes = cache.n_bytes;
+	frag_cache_close(&cache);
+
+	/*
+	 * The branches are all the same size, so this fits all but one,
+	 * and evicts the least recently used, the first.
+	 * Emitting it again evicts the second, which then evicts the third,
+	 * so that looping over more fragments than fit never hits.
+	 */
+	ret = ret && !frag_cache_open(&cache, CACHE_DIR,
+				      full_bytes * (N_BRANCHES - 1) /
+				      N_BRANCHES) &&
+	      cache.n_evictions == 1 && cache.n_entries == N_BRANCHES - 1 &&
+	      check_cached(&cache, &expected, 0) &&
+	      cache.n_evictions == 1 + N_BRANCHES;
+	frag_cache_close(&cache);
+	ret = ret && !frag_cache_open(&cache, CACHE_DIR, CACHE_BYTES) &&
+	      check_too_deep(&cache);
+	frag_cache_close(&cache);
+
+	line_sink_mem_free(&expected);
+	if (!frag_cache_open(&cache, CACHE_DIR, 0)) {
+		frag_cache_close(&cache);
+	}
+	rmdir(CACHE_DIR);
+
+	return ret;
+}
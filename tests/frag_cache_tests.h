@@ -0,0 +1,15 @@
+/*
+ * tests for the cache of generated fragments
+ */
+#ifndef FRAG_CACHE_TESTS_H
+#define FRAG_CACHE_TESTS_H
+
+/*
+ * Generate a function from fragments directly, through an empty cache,
+ * through the filled cache, and check that the outputs are the same,
+ * and that a smaller size bound evicts fragments
+ * returns	1 iff successful, else return 0
+ */
+int test_frag_cache(void);
+
+#endif /* FRAG_CACHE_TESTS_H */
@@ -0,0 +1,51 @@
+/*
+ * Only built when the whole tree is built with LINE_GEN_STATS,
+ * since it changes the layout of "struct line_gen"
+ */
+#ifndef LINE_GEN_STATS
+#define LINE_GEN_STATS
+#endif
+#include "line_gen_stats_tests.h"
+#include <line_gen.h>
+
+/* a small staging buffer, so that the sink is written more than once */
+#define STATS_BUF_SIZE	8
+/* the text generated by the test */
+#define STATS_TEXT	"int main()\n{\n\treturn 0;\n}\n"
+
+int test_line_gen_stats(void)
+{
+	struct line_gen gen;
+	struct line_sink sink;
+	const struct line_gen_stats *stats = &gen.stats;
+	const char *data;
+	size_t len;
+	int ret;
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	init_line_gen_sink(&gen, 4, &sink, STATS_BUF_SIZE);
+	line_gen_write("int main()", &gen);
+	finish_line(&gen);
+	line_gen_write("{", &gen);
+	indent(&gen);
+	line_gen_printf(&gen, "return %d;", 0);
+	unindent(&gen);
+	line_gen_write("}", &gen);
+	finish_line(&gen);
+	close_line_gen(&gen);
+
+	data = line_sink_mem_data(&gen.sink, &len);
+	ret = len == strlen(STATS_TEXT) && !memcmp(data, STATS_TEXT, len) &&
+	      stats->n_lines == 4 && stats->n_bytes == len &&
+	      stats->n_indent_bytes == 1 && stats->n_indents == 1 &&
+	      stats->n_unindents == 1 && stats->max_depth == 1 &&
+	      stats->n_sink_writes > 1 && stats->n_sink_flushes == 1;
+	if (!ret) {
+		line_gen_stats_dump(&gen, stderr);
+	}
+	line_sink_mem_free(&gen.sink);
+
+	return ret;
+}
@@ -0,0 +1,14 @@
+/*
+ * tests for the counters of "struct line_gen"
+ */
+#ifndef LINE_GEN_STATS_TESTS_H
+#define LINE_GEN_STATS_TESTS_H
+
+/*
+ * Generate a small function, and check the counters of the generator,
+ * which is compiled with LINE_GEN_STATS defined
+ * returns	1 iff successful, else return 0
+ */
+int test_line_gen_stats(void);
+
+#endif /* LINE_GEN_STATS_TESTS_H */
@@ -0,0 +1,104 @@
+/* this test logs asynchronously, whether or not the tree does */
+#ifndef LOG_ASYNC
+#define LOG_ASYNC
+#endif
+#define LOG_FILE	log_out
+#include <stdio.h>
+
+/* the file the logged messages go to */
+static FILE *log_out;
+
+#include "log_async_tests.h"
+#include <logger.h>
+
+#include <pthread.h>
+#include <string.h>
+
+/* the number of threads logging at once */
+#define N_LOG_THREADS	4
+/* the number of messages each thread logs, past the size of its ring */
+#define N_LOG_MSGS	(4 * LOG_ASYNC_SLOTS)
+
+/*
+ * Log numbered messages
+ * thread_arg:	the index of the thread, as a pointer
+ * returns	NULL
+ */
+static void *log_msgs(void *thread_arg)
+{
+	unsigned thread_i = (unsigned) (size_t) thread_arg;
+	unsigned msg_i;
+
+	for (msg_i = 0; msg_i < N_LOG_MSGS; msg_i++) {
+		printlg(INFO_LEVEL, "thread %u message %u\n", thread_i, msg_i);
+	}
+
+	return NULL;
+}
+
+/*
+ * Check that the logged messages of each thread are complete and in order
+ * returns	1 iff successful, else return 0
+ */
+static int check_msgs(void)
+{
+	unsigned next_msg[N_LOG_THREADS] = {0};
+	unsigned thread_i, msg_i;
+	char line[LOG_ASYNC_TEXT_SIZE];
+	int n_locations = 0;
+
+	rewind(log_out);
+	while (fgets(line, sizeof(line), log_out) != NULL) {
+		if (!strncmp(line, "[INFO] File ", strlen("[INFO] File "))) {
+			n_locations++;
+		} else if (sscanf(line, "[INFO]: thread %u message %u",
+				  &thread_i, &msg_i) != 2 ||
+			   thread_i >= N_LOG_THREADS ||
+			   msg_i != next_msg[thread_i]++) {
+			fprintf(stderr, "[ERROR]: Unexpected log line %s",
+				line);
+			return 0;
+		}
+	}
+	for (thread_i = 0; thread_i < N_LOG_THREADS; thread_i++) {
+		if (next_msg[thread_i] != N_LOG_MSGS) {
+			fprintf(stderr,
+				"[ERROR]: Thread %u logged %u messages.\n",
+				thread_i, next_msg[thread_i]);
+			return 0;
+		}
+	}
+
+	return n_locations == 1;
+}
+
+int test_log_async(void)
+{
+	pthread_t threads[N_LOG_THREADS];
+	size_t thread_i, n_started;
+	int ret;
+
+	log_out = tmpfile();
+	if (log_out == NULL) {
+		return 0;
+	}
+	log_async_set_policy(LOG_ASYNC_BLOCK);
+
+	TAG_LOCATION(INFO_LEVEL);
+	for (n_started = 0; n_started < N_LOG_THREADS; n_started++) {
+		if (pthread_create(&threads[n_started], NULL, log_msgs,
+				   (void *) n_started)) {
+			break;
+		}
+	}
+	for (thread_i = 0; thread_i < n_started; thread_i++) {
+		pthread_join(threads[thread_i], NULL);
+	}
+	log_async_flush();
+
+	ret = n_started == N_LOG_THREADS && check_msgs() &&
+	      log_async_dropped() == 0;
+	fclose(log_out);
+
+	return ret;
+}
@@ -0,0 +1,14 @@
+/*
+ * tests for the asynchronous logger backend
+ */
+#ifndef LOG_ASYNC_TESTS_H
+#define LOG_ASYNC_TESTS_H
+
+/*
+ * Log from several threads through the asynchronous backend,
+ * and check that every message was written, in order for each thread
+ * returns	1 iff successful, else return 0
+ */
+int test_log_async(void);
+
+#endif /* LOG_ASYNC_TESTS_H */
@@ -0,0 +1,131 @@
+/* this test logs in binary, whether or not the tree does */
+#ifndef LOG_BINARY
+#define LOG_BINARY
+#endif
+#include "log_binary_tests.h"
+#include <logger.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* the binary log written by the test */
+#define BINARY_LOG_PATH	"test_log.bin"
+/* the largest text expected from decoding the log */
+#define MAX_LOG_TEXT	1024
+/* the start of a log, and its byte order mark, as written by the logger */
+#define LOG_START	"LGBINLOG"
+#define LOG_ORDER	0x01020304u
+/*
+ * a record describing a call site with the ID 0, which no site gets,
+ * followed by its level, and the start of its line
+ */
+#define ZERO_SITE	"\002\0\0\0\0\0\0\0"
+
+/*
+ * Log one event of each kind, writing what printlg would have written
+ * text:	where to write the expected text, of MAX_LOG_TEXT characters
+ * returns	the number of characters written to "text"
+ */
+static int log_events(char *text)
+{
+	/* a string that is not 0-terminated, so only its precision ends it */
+	const struct {
+		char str[3];
+		char after[5];
+	} unterminated = {{'a', 'b', 'c'}, "defg"};
+	size_t size = 42;
+	long offset = -7;
+	int len = 0, line;
+
+	printlg(INFO_LEVEL, "Plain message.\n");
+	len += sprintf(text + len, "[INFO]: Plain message.\n");
+	printlg(ERROR_LEVEL, "Could not declare %s %s.\n", "int", "value");
+	len += sprintf(text + len, "[ERROR]: Could not declare int value.\n");
+	printlg(WARNING_LEVEL, "%zu bytes at %ld, %c%%, [%*d] [%-6.2f]\n",
+		size, offset, 'x', 5, 12, 3.14159);
+	len += sprintf(text + len,
+		       "[WARNING]: %zu bytes at %ld, %c%%, [%*d] [%-6.2f]\n",
+		       size, offset, 'x', 5, 12, 3.14159);
+	printlg(INFO_LEVEL, "[%.*s] [%.2s] [%.*s]\n", 3, unterminated.str,
+		unterminated.str, -1, "whole");
+	len += sprintf(text + len, "[INFO]: [%.*s] [%.2s] [%.*s]\n", 3,
+		       unterminated.str, unterminated.str, -1, "whole");
+	line = __LINE__; TAG_LOCATION(INFO_LEVEL);
+	len += sprintf(text + len, "[INFO] File %s, Line %d\n", __FILE__,
+		       line);
+
+	return len;
+}
+
+/*
+ * Check that decoding a log that describes a call site with the ID 0 fails
+ * returns	1 iff successful, else return 0
+ */
+static int test_zero_site(void)
+{
+	char log[sizeof(LOG_START) - 1 + sizeof(uint32_t) +
+		 sizeof(ZERO_SITE) - 1];
+	char decoded[MAX_LOG_TEXT];
+	uint32_t order = LOG_ORDER;
+	FILE *in, *out;
+	int ret;
+
+	memcpy(log, LOG_START, sizeof(LOG_START) - 1);
+	memcpy(log + sizeof(LOG_START) - 1, &order, sizeof(order));
+	memcpy(log + sizeof(LOG_START) - 1 + sizeof(order), ZERO_SITE,
+	       sizeof(ZERO_SITE) - 1);
+	in = fmemopen(log, sizeof(log), "rb");
+	out = fmemopen(decoded, sizeof(decoded), "w+");
+	ret = in != NULL && out != NULL && log_binary_decode(in, out, 0) < 0;
+	if (in != NULL) {
+		fclose(in);
+	}
+	if (out != NULL) {
+		fclose(out);
+	}
+
+	return ret;
+}
+
+int test_log_binary(void)
+{
+	char expected[MAX_LOG_TEXT], decoded[MAX_LOG_TEXT];
+	size_t expected_len, decoded_len;
+	FILE *in, *out;
+	int ret = 1;
+
+	if (log_binary_open(BINARY_LOG_PATH)) {
+		return 0;
+	}
+	expected_len = log_events(expected);
+	if (log_binary_close()) {
+		return 0;
+	}
+
+	in = fopen(BINARY_LOG_PATH, "rb");
+	out = fmemopen(decoded, sizeof(decoded), "w+");
+	if (in == NULL || out == NULL ||
+	    log_binary_decode(in, out, 0)) {
+		ret = 0;
+	} else {
+		fflush(out);
+		decoded_len = ftell(out);
+		if (decoded_len != expected_len ||
+		    memcmp(decoded, expected, expected_len)) {
+			fprintf(stderr, "[ERROR]: Decoded %.*s",
+				(int) decoded_len, decoded);
+			ret = 0;
+		}
+	}
+
+	if (in != NULL) {
+		fclose(in);
+	}
+	if (out != NULL) {
+		fclose(out);
+	}
+	remove(BINARY_LOG_PATH);
+
+	return test_zero_site() && ret;
+}
@@ -0,0 +1,15 @@
+/*
+ * tests for the binary logger backend
+ */
+#ifndef LOG_BINARY_TESTS_H
+#define LOG_BINARY_TESTS_H
+
+/*
+ * Record events of each kind of argument in a binary log,
+ * and check that decoding it gives the text printlg would have written,
+ * and that decoding a malformed log fails
+ * returns	1 iff successful, else return 0
+ */
+int test_log_binary(void);
+
+#endif /* LOG_BINARY_TESTS_H */
@@ -0,0 +1,187 @@
+#include "str_arena_tests.h"
+#include <c_gen.h>
+
+#include <string.h>
+#include <limits.h>
+
+/* the number of functions generated, resetting the arena after each */
+#define N_TEST_FUNCS	3
+/* the number of if statements per function */
+#define N_TEST_IFS	100
+
+/* the text expected from "gen_func" */
+#define FUNC_START	"{\n"
+#define FUNC_IF		"\tif ((idx_%u + 1) < n) {\n\t\treturn buf[%d];\n\t}\n"
+#define FUNC_END	"}\n"
+
+/*
+ * Generate a block of if statements, whose conditions and values
+ * are built in the arena
+ * out:		the generator to write to
+ * returns	1 iff successful, else return 0
+ */
+static int gen_func(struct c_gen *out)
+{
+	struct str_builder sub, cond, value;
+	char *sub_str, *cond_str, *value_str;
+	char name[16];
+	size_t if_i;
+
+	open_block(out);
+	for (if_i = 0; if_i < N_TEST_IFS; if_i++) {
+		c_gen_build_str(out, &sub);
+		snprintf(name, sizeof(name), "idx_%u", (unsigned) if_i);
+		str_build_ident(&sub, name);
+		str_build_lit(&sub, " + ");
+		str_build_uint(&sub, 1);
+		sub_str = str_build_finish(&sub);
+
+		c_gen_build_str(out, &cond);
+		str_build_sub(&cond, sub_str);
+		str_build_lit(&cond, " < ");
+		str_build_ident(&cond, "n");
+		cond_str = str_build_finish(&cond);
+
+		c_gen_build_str(out, &value);
+		str_build_ident(&value, "buf");
+		str_build_lit(&value, "[");
+		str_build_int(&value, -(long long) if_i);
+		str_build_lit(&value, "]");
+		value_str = str_build_finish(&value);
+
+		if (sub_str == NULL || cond_str == NULL || value_str == NULL) {
+			return 0;
+		}
+		start_if(out, cond_str);
+		return_value(out, value_str);
+		close_block(out);
+	}
+	close_block(out);
+
+	return line_gen_error(&out->base_gen) == 0;
+}
+
+/*
+ * Check that the output is the text expected from "gen_func",
+ * repeated for every function
+ * data:	the output
+ * len:		the number of bytes of output
+ * returns	1 iff the output is as expected, else return 0
+ */
+static int check_funcs(const char *data, size_t len)
+{
+	char expected[sizeof(FUNC_IF) + 32];
+	size_t func_i, if_i, pos = 0, expected_len;
+
+	for (func_i = 0; func_i < N_TEST_FUNCS; func_i++) {
+		if (len - pos < strlen(FUNC_START) ||
+		    memcmp(data + pos, FUNC_START, strlen(FUNC_START))) {
+			return 0;
+		}
+		pos += strlen(FUNC_START);
+		for (if_i = 0; if_i < N_TEST_IFS; if_i++) {
+			expected_len = snprintf(expected, sizeof(expected),
+						FUNC_IF, (unsigned) if_i,
+						-(int) if_i);
+			if (len - pos < expected_len ||
+			    memcmp(data + pos, expected, expected_len)) {
+				return 0;
+			}
+			pos += expected_len;
+		}
+		if (len - pos < strlen(FUNC_END) ||
+		    memcmp(data + pos, FUNC_END, strlen(FUNC_END))) {
+			return 0;
+		}
+		pos += strlen(FUNC_END);
+	}
+
+	return pos == len;
+}
+
+/*
+ * Check the edge cases of the builder:
+ * the smallest integer, a bad identifier,
+ * and a string that does not fit in one block
+ * returns	1 iff successful, else return 0
+ */
+static int test_builder(void)
+{
+	static const char chunk[] = "0123456789abcdef";
+	struct str_arena arena;
+	struct str_builder builder;
+	char *str;
+	size_t chunk_i, n_chunks = 2 * STR_ARENA_BLOCK_SIZE / strlen(chunk);
+	int ret = 1;
+
+	str_arena_init(&arena);
+	str_build_start(&builder, &arena);
+	str_build_int(&builder, LLONG_MIN);
+	str = str_build_finish(&builder);
+	if (str == NULL || strcmp(str, "-9223372036854775808")) {
+		ret = 0;
+	}
+
+	str_build_start(&builder, &arena);
+	str_build_lit(&builder, "x + ");
+	str_build_ident(&builder, "2x");
+	if (str_build_finish(&builder) != NULL) {
+		ret = 0;
+	}
+
+	str_build_start(&builder, &arena);
+	str_build_lit(&builder, "a");
+	for (chunk_i = 0; chunk_i < n_chunks; chunk_i++) {
+		str_build_lit(&builder, chunk);
+	}
+	str = str_build_finish(&builder);
+	if (str == NULL || str[0] != 'a' ||
+	    strlen(str) != 1 + n_chunks * strlen(chunk) ||
+	    memcmp(str + 1 + (n_chunks - 1) * strlen(chunk), chunk,
+		   strlen(chunk))) {
+		ret = 0;
+	}
+
+	/* the blocks are merged into one that fits all of them */
+	str_arena_reset(&arena);
+	if (arena.block == NULL || arena.block->next != NULL ||
+	    arena.block->size != arena.total || arena.used != 0) {
+		ret = 0;
+	}
+	str_arena_free(&arena);
+
+	return ret;
+}
+
+int test_str_arena(void)
+{
+	struct line_sink sink;
+	struct c_gen out;
+	const char *data;
+	size_t func_i, len, first_total = 0;
+	int ret = test_builder();
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	init_c_gen_sink(&out, &sink);
+	for (func_i = 0; func_i < N_TEST_FUNCS; func_i++) {
+		if (!gen_func(&out)) {
+			ret = 0;
+		}
+		c_gen_reset_strs(&out);
+		/* once the arena fits a function, it stops growing */
+		if (func_i == 0) {
+			first_total = out.arena.total;
+		} else if (out.arena.total != first_total) {
+			ret = 0;
+		}
+	}
+
+	ret = close_c_gen(&out) == 0 && ret;
+	data = line_sink_mem_data(&out.base_gen.sink, &len);
+	ret = ret && check_funcs(data, len);
+	line_sink_mem_free(&out.base_gen.sink);
+
+	return ret;
+}
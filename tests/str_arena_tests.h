@@ -0,0 +1,15 @@
+/*
+ * tests for the string arena and builder
+ */
+#ifndef STR_ARENA_TESTS_H
+#define STR_ARENA_TESTS_H
+
+/*
+ * Build the conditions and values of generated statements in the arena
+ * of a "struct c_gen", and check the output, that the arena stops growing
+ * once it fits a function, and that bad identifiers are rejected
+ * returns	1 iff successful, else return 0
+ */
+int test_str_arena(void);
+
+#endif /* STR_ARENA_TESTS_H */
@@ -1,5 +1,12 @@
 #define DEBUG
 #include "c_gen_tests.h"
+#include "log_async_tests.h"
+#include "log_binary_tests.h"
+#include "line_gen_stats_tests.h"
+#include "frag_cache_tests.h"
+#include "c_snippet_tests.h"
+#include "str_arena_tests.h"
+#include "c_shards_tests.h"
 #include <compare_files.h>
 #include <logger.h>
 
@@ -7,24 +14,64 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 /* path to the output file */
 #define TEST_PATH	"test_out.c"
 #define EXPECTED_DIR	"expected/"
 
+/*
+ * Open the expected output of a test vector for reading
+ * c_gen_test:	the test vector containing the expected file
+ * returns	the opened file, or NULL on failure
+ */
+static FILE *open_expected(struct c_gen_tv *c_gen_test)
+{
+	size_t expected_dir_len = strlen(EXPECTED_DIR);
+	size_t expected_file_len = strlen(c_gen_test->expected_file);
+	char expected_path[expected_dir_len + expected_file_len + 1];
+	FILE *expected_file;
+
+	strncpy(expected_path, EXPECTED_DIR, expected_dir_len + 1);
+	strncat(expected_path, c_gen_test->expected_file,
+		expected_file_len + 1);
+	expected_file = fopen(expected_path, "r");
+	if (expected_file == NULL) {
+		printlg(ERROR_LEVEL, "Could not open expected file %s.\n",
+			expected_path);
+	}
+
+	return expected_file;
+}
+
+/*
+ * Open the output file through a memory mapping, without a size hint
+ * to_open:	the struct in which to write the initialized values
+ * path:	the path of the file to write to
+ * returns	0 iff successful, -1 otherwise
+ */
+static int open_c_gen_mapped(struct c_gen *to_open, const char *path)
+{
+	return open_c_gen_mmap(to_open, path, 0);
+}
+
 /*
  * Run a single c_gen test vector
  * c_gen_test:	the test vector containing the expected file and
  *		the testing function
+ * opener:	the function that opens the output file
  * returns	1 iff successful, else return 0
  */
-static int test_c(struct c_gen_tv *c_gen_test)
+static int test_c(struct c_gen_tv *c_gen_test,
+		  int (*opener)(struct c_gen *to_open, const char *path))
 {
 	struct c_gen output;
 	int ret = 1;
 
 	/* open file to write to */
-	if (open_c_gen(&output, TEST_PATH)) {
+	if (opener(&output, TEST_PATH)) {
 		printlg(ERROR_LEVEL,
 			"Could not create temporay output file: %d.\n", errno);
 		return 0;
@@ -34,20 +81,11 @@ static int test_c(struct c_gen_tv *c_gen_test)
 	ret = c_gen_test->tester(&output);
 	close_c_gen(&output);
 	if (ret) {
-		size_t expected_dir_len = strlen(EXPECTED_DIR);
-		size_t expected_file_len = strlen(c_gen_test->expected_file);
-		char expected_path[expected_dir_len + expected_file_len + 1];
 		FILE *expected_file, *output_file;
 
 		/* open the expected file */
-		strncpy(expected_path, EXPECTED_DIR, expected_dir_len + 1);
-		strncat(expected_path, c_gen_test->expected_file,
-			expected_file_len + 1);
-		expected_file = fopen(expected_path, "r");
+		expected_file = open_expected(c_gen_test);
 		if (expected_file == NULL) {
-			printlg(ERROR_LEVEL,
-				"Could not open expected file %s.\n",
-				expected_path);
 			ret = 0;
 		} else {
 			/* reopen the written-to file for reading */
@@ -75,6 +113,655 @@ static int test_c(struct c_gen_tv *c_gen_test)
 	return ret;
 } 
 
+/*
+ * Run a single c_gen test vector into a memory sink
+ * c_gen_test:	the test vector containing the expected file and
+ *		the testing function
+ * returns	1 iff successful, else return 0
+ */
+static int test_c_mem(struct c_gen_tv *c_gen_test)
+{
+	struct c_gen output;
+	struct line_sink sink;
+	FILE *expected_file, *output_file;
+	const char *data;
+	size_t len;
+	int ret;
+
+	if (line_sink_mem(&sink, 0)) {
+		printlg(ERROR_LEVEL, "Could not create memory sink.\n");
+		return 0;
+	}
+	init_c_gen_sink(&output, &sink);
+
+	ret = c_gen_test->tester(&output);
+	close_c_gen(&output);
+	if (!ret) {
+		printlg(ERROR_LEVEL, "Premature error during test.\n");
+		line_sink_mem_free(&output.base_gen.sink);
+		return 0;
+	}
+
+	expected_file = open_expected(c_gen_test);
+	if (expected_file == NULL) {
+		line_sink_mem_free(&output.base_gen.sink);
+		return 0;
+	}
+	data = line_sink_mem_data(&output.base_gen.sink, &len);
+	output_file = fmemopen((void *) data, len, "r");
+	if (output_file == NULL) {
+		printlg(ERROR_LEVEL, "Could not read the memory sink.\n");
+		ret = 0;
+	} else {
+		if (!files_equal(output_file, expected_file)) {
+			printlg(ERROR_LEVEL, "Unexpected output.\n");
+			ret = 0;
+		}
+		fclose(output_file);
+	}
+	fclose(expected_file);
+	line_sink_mem_free(&output.base_gen.sink);
+
+	return ret;
+}
+
+/*
+ * Check that "files_compare" finds the first difference between
+ * "hello_world.c" and "deep_block.c",
+ * which is the tab before "printf" on line 5.
+ * streamed:	nonzero to compare "deep_block.c" against a memory stream,
+ *		which cannot be mapped, 0 to compare it against the file
+ * returns	1 iff successful, else return 0
+ */
+static int test_compare(int streamed)
+{
+	static char hello_start[] = "#include <stdio.h>\n\nint main()\n{\n"
+				    "\tprintf(\"Hello World!\\n\");\n";
+	struct file_diff diff;
+	FILE *hello_file, *deep_file;
+	int ret = 1;
+
+	if (streamed) {
+		hello_file = fmemopen(hello_start, strlen(hello_start), "r");
+	} else {
+		hello_file = fopen(EXPECTED_DIR "hello_world.c", "r");
+	}
+	deep_file = fopen(EXPECTED_DIR "deep_block.c", "r");
+	if (hello_file == NULL || deep_file == NULL) {
+		printlg(ERROR_LEVEL, "Could not open files to compare.\n");
+		ret = 0;
+	} else if (files_compare(hello_file, deep_file, &diff) != 0) {
+		printlg(ERROR_LEVEL, "Difference not found.\n");
+		ret = 0;
+	} else if (diff.offset != 34 || diff.line != 5 || diff.column != 2) {
+		printlg(ERROR_LEVEL,
+			"Difference found at byte %u, line %u, column %u.\n",
+			(unsigned) diff.offset, (unsigned) diff.line,
+			(unsigned) diff.column);
+		ret = 0;
+	}
+
+	if (hello_file != NULL) {
+		fclose(hello_file);
+	}
+	if (deep_file != NULL) {
+		fclose(deep_file);
+	}
+
+	return ret;
+}
+
+/*
+ * Generate a test vector into the output file, only replacing it if it changes
+ * c_gen_test:	the test vector to generate
+ * update:	set to the outcome
+ * returns	1 iff successful, else return 0
+ */
+static int gen_if_changed(struct c_gen_tv *c_gen_test,
+			  struct line_sink_update *update)
+{
+	struct c_gen output;
+	int ret;
+
+	if (open_c_gen_if_changed(&output, TEST_PATH, update)) {
+		printlg(ERROR_LEVEL, "Could not open output: %d.\n", errno);
+		return 0;
+	}
+	ret = c_gen_test->tester(&output);
+	if (close_c_gen(&output) || !ret) {
+		printlg(ERROR_LEVEL, "Premature error during test.\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Generate a line, a failing unindentation, and another line
+ * with "open_c_gen_if_changed", which should leave the file untouched
+ * in sticky-error mode, and otherwise replace it,
+ * with the failure still latched
+ * sticky:	nonzero to generate in sticky-error mode
+ * returns	1 iff successful, else return 0
+ */
+static int gen_failing_if_changed(int sticky)
+{
+	struct line_sink_update update = {1, 0};
+	struct c_gen output;
+
+	if (open_c_gen_if_changed(&output, TEST_PATH, &update)) {
+		printlg(ERROR_LEVEL, "Could not open output: %d.\n", errno);
+		return 0;
+	}
+	line_gen_set_sticky(&output.base_gen, sticky);
+	line_gen_write("int a", &output.base_gen);
+	end_statement(&output);
+	unindent(&output.base_gen);
+	line_gen_write("int b", &output.base_gen);
+	end_statement(&output);
+
+	if (sticky) {
+		return close_c_gen(&output) != 0 && !update.changed;
+	}
+
+	return close_c_gen(&output) == 0 && update.changed &&
+	       line_gen_error(&output.base_gen) == -2;
+}
+
+/*
+ * Check that generating the same file twice with "open_c_gen_if_changed"
+ * replaces it the first time, and leaves it untouched the second time,
+ * and when generating it fails in sticky-error mode
+ * returns	1 iff successful, else return 0
+ */
+static int test_if_changed(void)
+{
+	struct line_sink_update first, second;
+	struct stat first_stat, second_stat;
+	FILE *stale, *expected_file, *output_file;
+	int ret = 1;
+
+	if ((stale = fopen(TEST_PATH, "w")) == NULL) {
+		return 0;
+	}
+	fputs("stale\n", stale);
+	fclose(stale);
+	if (!gen_failing_if_changed(0)) {
+		printlg(ERROR_LEVEL, "Ignored failure kept the file.\n");
+		ret = 0;
+	}
+
+	if (!gen_if_changed(c_gen_tvs[0], &first) ||
+	    stat(TEST_PATH, &first_stat) ||
+	    !gen_if_changed(c_gen_tvs[0], &second) ||
+	    stat(TEST_PATH, &second_stat)) {
+		return 0;
+	}
+	if (!first.changed || second.changed ||
+	    first.hash != second.hash ||
+	    first_stat.st_ino != second_stat.st_ino) {
+		printlg(ERROR_LEVEL, "Changed %d, then %d.\n", first.changed,
+			second.changed);
+		ret = 0;
+	}
+	if (!gen_failing_if_changed(1)) {
+		printlg(ERROR_LEVEL, "Failed generation changed the file.\n");
+		ret = 0;
+	}
+
+	if ((expected_file = open_expected(c_gen_tvs[0])) == NULL) {
+		return 0;
+	}
+	if ((output_file = fopen(TEST_PATH, "r")) == NULL) {
+		ret = 0;
+	} else {
+		if (!files_equal(output_file, expected_file)) {
+			printlg(ERROR_LEVEL, "Unexpected output.\n");
+			ret = 0;
+		}
+		fclose(output_file);
+	}
+	fclose(expected_file);
+
+	return ret;
+}
+
+/* the text kept by the checkpoint test */
+#define CHECKPOINT_TEXT	"int a;\nint b;\n{\n\tint c;\n}\n"
+
+/*
+ * Check that rolling back discards text past the staging buffer's size,
+ * along with the indentation and failures after the checkpoint,
+ * and that committing keeps text
+ * returns	1 iff successful, else return 0
+ */
+static int test_checkpoint(void)
+{
+	struct line_gen_checkpoint outer, inner;
+	struct line_sink sink;
+	struct c_gen out;
+	const char *data;
+	size_t line_i, len;
+	int ret;
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	/* a tiny staging buffer, which the speculative text overflows */
+	str_arena_init(&out.arena);
+	out.protos = NULL;
+	init_line_gen_sink(&out.base_gen, MAX_C_INDENTS, &sink, 4);
+	line_gen_write("int a", &out.base_gen);
+	end_statement(&out);
+
+	line_gen_checkpoint(&out.base_gen, &outer);
+	open_block(&out);
+	for (line_i = 0; line_i < 100; line_i++) {
+		line_gen_printf(&out.base_gen, "int v_%u", (unsigned) line_i);
+		end_statement(&out);
+	}
+	line_gen_checkpoint(&out.base_gen, &inner);
+	less_indent(&out.base_gen, 2);
+	line_gen_rollback(&out.base_gen, &outer);
+	ret = line_gen_error(&out.base_gen) == 0 && out.base_gen.indent == 0;
+
+	line_gen_write("int b", &out.base_gen);
+	end_statement(&out);
+	line_gen_checkpoint(&out.base_gen, &outer);
+	open_block(&out);
+	line_gen_checkpoint(&out.base_gen, &inner);
+	line_gen_write("int c", &out.base_gen);
+	end_statement(&out);
+	line_gen_commit(&out.base_gen, &inner);
+	close_block(&out);
+	line_gen_commit(&out.base_gen, &outer);
+
+	ret = close_c_gen(&out) == 0 && ret;
+	data = line_sink_mem_data(&out.base_gen.sink, &len);
+	ret = ret && len == strlen(CHECKPOINT_TEXT) &&
+	      !memcmp(data, CHECKPOINT_TEXT, len);
+	line_sink_mem_free(&out.base_gen.sink);
+
+	return ret;
+}
+
+/* the number of writes "failing_write" allows before it fails */
+#define N_GOOD_WRITES	2
+
+static int failing_write(struct line_sink *sink, const char *bytes,
+			 size_t len)
+{
+	size_t *n_writes = sink->state.ctx;
+
+	(void) bytes;
+	(void) len;
+	if (++*n_writes > N_GOOD_WRITES) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int no_sink_op(struct line_sink *sink)
+{
+	(void) sink;
+	return 0;
+}
+
+/* a sink that accepts N_GOOD_WRITES writes, and then fails with ENOSPC */
+static const struct line_sink_ops failing_ops = {
+	.write = failing_write,
+	.flush = no_sink_op,
+	.close = no_sink_op
+};
+
+/*
+ * Check that sticky-error mode latches the first failure,
+ * stops writing to the sink after it, and returns it on closing,
+ * both for a failing sink, and for indentation past the maximum
+ * returns	1 iff successful, else return 0
+ */
+static int test_sticky(void)
+{
+	struct line_sink sink = {.ops = &failing_ops};
+	struct c_gen out;
+	size_t n_writes = 0, line_i, indent_i;
+	int close_ret, ret = 1;
+
+	/* a tiny staging buffer, so that every line is one write */
+	sink.state.ctx = &n_writes;
+	str_arena_init(&out.arena);
+	out.protos = NULL;
+	init_line_gen_sink(&out.base_gen, MAX_C_INDENTS, &sink, 4);
+	line_gen_set_sticky(&out.base_gen, 1);
+	for (line_i = 0; line_i < 2 * N_GOOD_WRITES; line_i++) {
+		line_gen_write("return 0", &out.base_gen);
+		end_statement(&out);
+	}
+	if (line_gen_error(&out.base_gen) != -1 || errno != ENOSPC ||
+	    n_writes != N_GOOD_WRITES + 1) {
+		printlg(ERROR_LEVEL, "Sink failure latched after %u writes.\n",
+			(unsigned) n_writes);
+		ret = 0;
+	}
+	if (close_c_gen(&out) != -1 || errno != ENOSPC) {
+		printlg(ERROR_LEVEL, "Sink failure not returned on closing.\n");
+		ret = 0;
+	}
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	init_c_gen_sink(&out, &sink);
+	line_gen_set_sticky(&out.base_gen, 1);
+	for (indent_i = 0; indent_i <= MAX_C_INDENTS; indent_i++) {
+		open_block(&out);
+	}
+	line_gen_write("return 0", &out.base_gen);
+	end_statement(&out);
+	close_ret = close_c_gen(&out);
+	line_sink_mem_data(&out.base_gen.sink, &line_i);
+	if (close_ret != -2 || line_i != 0) {
+		printlg(ERROR_LEVEL, "Excess indentation not latched.\n");
+		ret = 0;
+	}
+	line_sink_mem_free(&out.base_gen.sink);
+
+	return ret;
+}
+
+#define HOLE_PREFIX	"/* generated */\n"
+#define HOLE_TEXT	HOLE_PREFIX \
+			"#include <stdio.h>\n#include <stdlib.h>\n" \
+			"int main(void)\n{\n\tint n;\n\treturn 0;\n}\n"
+
+/*
+ * Check that holes are filled in place, at their indentation depth,
+ * in any order, and that nothing past the first hole that is not filled
+ * reaches the sink, even once the staging buffer overflows
+ * returns	1 iff successful, else return 0
+ */
+static int test_hole(void)
+{
+	struct line_gen_hole *includes, *decls;
+	struct line_sink sink;
+	struct c_gen out, filler;
+	const char *data;
+	size_t len;
+	int ret = 1;
+
+	if (line_sink_mem(&sink, 0)) {
+		return 0;
+	}
+	/* a tiny staging buffer, which the text after the holes overflows */
+	str_arena_init(&out.arena);
+	out.protos = NULL;
+	init_line_gen_sink(&out.base_gen, MAX_C_INDENTS, &sink, 4);
+	line_gen_write("/* generated */", &out.base_gen);
+	finish_line(&out.base_gen);
+	includes = line_gen_reserve_hole(&out.base_gen);
+	line_gen_write("int main(void)", &out.base_gen);
+	finish_line(&out.base_gen);
+	open_block(&out);
+	decls = line_gen_reserve_hole(&out.base_gen);
+	line_gen_write("return 0", &out.base_gen);
+	end_statement(&out);
+	close_block(&out);
+	if (includes == NULL || decls == NULL) {
+		close_c_gen(&out);
+		line_sink_mem_free(&out.base_gen.sink);
+		return 0;
+	}
+
+	line_gen_fill_begin(&out.base_gen, decls, &filler.base_gen);
+	line_gen_write("int n", &filler.base_gen);
+	end_statement(&filler);
+	if (line_gen_fill_end(&out.base_gen, decls, &filler.base_gen)) {
+		ret = 0;
+	}
+	data = line_sink_mem_data(&out.base_gen.sink, &len);
+	if (len != strlen(HOLE_PREFIX) || memcmp(data, HOLE_PREFIX, len)) {
+		printlg(ERROR_LEVEL, "Text past an unfilled hole written.\n");
+		ret = 0;
+	}
+
+	line_gen_fill_begin(&out.base_gen, includes, &filler.base_gen);
+	include(&filler, STDIO_H_PATH);
+	include(&filler, STDLIB_H_PATH);
+	if (line_gen_fill_end(&out.base_gen, includes, &filler.base_gen)) {
+		ret = 0;
+	}
+	line_sink_mem_data(&out.base_gen.sink, &len);
+	if (len != strlen(HOLE_TEXT)) {
+		printlg(ERROR_LEVEL, "Text held back after filling holes.\n");
+		ret = 0;
+	}
+
+	ret = close_c_gen(&out) == 0 && ret;
+	data = line_sink_mem_data(&out.base_gen.sink, &len);
+	ret = ret && len == strlen(HOLE_TEXT) && !memcmp(data, HOLE_TEXT, len);
+	line_sink_mem_free(&out.base_gen.sink);
+
+	return ret;
+}
+
+/* the line written before the literals, unless they start the output */
+#define LITERAL_PREFIX	"int a;\n"
+/* literals that fit after their name, on a line of their own, or on neither */
+static const char *const literals[] = {
+	"short",
+	"this one fits on a line of its own, but not after its name",
+	"this one is far too long to fit on any line of generated code, "
+	"so it is split into several adjacent literals, each of which fills "
+	"a line of its own, up to the last one, which ends with a semicolon",
+};
+
+/*
+ * Write declarations of string literals into a memory sink
+ * buf_size:	the size of the staging buffer
+ * first:	nonzero to start the output with the declarations
+ * len:		set to the number of bytes written
+ * returns	the bytes written, which must be freed, or NULL on failure
+ */
+static char *gen_literals(size_t buf_size, int first, size_t *len)
+{
+	struct line_sink sink;
+	struct c_gen out;
+	size_t str_i;
+
+	if (line_sink_mem(&sink, 0)) {
+		return NULL;
+	}
+	str_arena_init(&out.arena);
+	out.protos = NULL;
+	init_line_gen_sink(&out.base_gen, MAX_C_INDENTS, &sink, buf_size);
+	if (!first) {
+		line_gen_write(LITERAL_PREFIX, &out.base_gen);
+	}
+	open_block(&out);
+	for (str_i = 0; str_i < sizeof(literals) / sizeof(literals[0]);
+	     str_i++) {
+		line_gen_printf(&out.base_gen, "static const char s_%u[] = ",
+				(unsigned) str_i);
+		emit_string_literal(&out, literals[str_i],
+				    strlen(literals[str_i]));
+		end_statement(&out);
+	}
+	close_block(&out);
+	if (close_c_gen(&out)) {
+		line_sink_mem_free(&out.base_gen.sink);
+		return NULL;
+	}
+
+	return line_sink_mem_take(&out.base_gen.sink, len);
+}
+
+/*
+ * Check that string literals are placed the same way whatever the size of
+ * the staging buffer, and whether or not they are on the first lines written
+ * returns	1 iff successful, else return 0
+ */
+static int test_literal_buffers(void)
+{
+	static const size_t buf_sizes[] = {4, 4096};
+	size_t prefix_len = strlen(LITERAL_PREFIX), size_i, len, first_len;
+	char *text, *first_text;
+	int ret = 1;
+
+	first_text = gen_literals(4096, 1, &first_len);
+	if (first_text == NULL) {
+		return 0;
+	}
+	for (size_i = 0; size_i < sizeof(buf_sizes) / sizeof(buf_sizes[0]);
+	     size_i++) {
+		text = gen_literals(buf_sizes[size_i], 0, &len);
+		if (text == NULL || len != prefix_len + first_len ||
+		    memcmp(text, LITERAL_PREFIX, prefix_len) ||
+		    memcmp(text + prefix_len, first_text, first_len)) {
+			printlg(ERROR_LEVEL,
+				"Literals differ with a %u-byte buffer.\n",
+				(unsigned) buf_sizes[size_i]);
+			ret = 0;
+		}
+		free(text);
+		text = gen_literals(buf_sizes[size_i], 1, &len);
+		if (text == NULL || len != first_len ||
+		    memcmp(text, first_text, len)) {
+			printlg(ERROR_LEVEL, "First literals differ "
+				"with a %u-byte buffer.\n",
+				(unsigned) buf_sizes[size_i]);
+			ret = 0;
+		}
+		free(text);
+	}
+	free(first_text);
+
+	return ret;
+}
+
+/* the number of bytes embedded through a pipe, more than a read buffer */
+#define N_PIPED_BYTES	200000
+
+/* the bytes embedded through a pipe, and the end to write them to */
+struct piped_bytes {
+	const unsigned char *bytes;
+	int fd;
+};
+
+static void *write_piped(void *arg)
+{
+	struct piped_bytes *piped = arg;
+	size_t written = 0;
+	ssize_t ret;
+
+	while (written < N_PIPED_BYTES &&
+	       (ret = write(piped->fd, piped->bytes + written,
+			    N_PIPED_BYTES - written)) > 0) {
+		written += ret;
+	}
+	close(piped->fd);
+
+	return NULL;
+}
+
+/*
+ * Embed a file into memory
+ * path:	the path of the file to embed
+ * sink:	set to the memory sink holding the output
+ * returns	1 iff successful, else return 0
+ */
+static int embed_to_mem(const char *path, struct line_sink *sink)
+{
+	struct c_gen out;
+	int ret;
+
+	if (line_sink_mem(sink, 0)) {
+		return 0;
+	}
+	init_c_gen_sink(&out, sink);
+	embed_file(&out, "piped", path, C_EMBED_ARRAY, 16, C_ARRAY_DEC);
+	ret = close_c_gen(&out) == 0;
+	*sink = out.base_gen.sink;
+
+	return ret;
+}
+
+/*
+ * Check that embedding a pipe, which is read a buffer at a time,
+ * gives the same bytes as embedding a file, which is mapped,
+ * apart from the length left out of the brackets
+ * returns	1 iff successful, else return 0
+ */
+static int test_embed_stream(void)
+{
+	static const char head[] = "static const uint8_t piped";
+	static const char mapped_len[] = "[200000]";
+	unsigned char *bytes = malloc(N_PIPED_BYTES);
+	struct line_sink mapped, piped;
+	struct piped_bytes writer;
+	const char *mapped_data, *piped_data;
+	char pipe_path[32];
+	size_t byte_i, mapped_size, piped_size, prefix_len = strlen(head);
+	pthread_t thread;
+	FILE *file;
+	int fds[2], ret = 1;
+
+	if (bytes == NULL) {
+		return 0;
+	}
+	for (byte_i = 0; byte_i < N_PIPED_BYTES; byte_i++) {
+		bytes[byte_i] = byte_i * 7 + byte_i / 256;
+	}
+	if ((file = fopen(TEST_PATH, "w")) == NULL ||
+	    fwrite(bytes, N_PIPED_BYTES, 1, file) != 1 || fclose(file) ||
+	    !embed_to_mem(TEST_PATH, &mapped)) {
+		free(bytes);
+		return 0;
+	}
+
+	if (pipe(fds)) {
+		line_sink_mem_free(&mapped);
+		free(bytes);
+		return 0;
+	}
+	writer.bytes = bytes;
+	writer.fd = fds[1];
+	snprintf(pipe_path, sizeof(pipe_path), "/dev/fd/%d", fds[0]);
+	if (pthread_create(&thread, NULL, write_piped, &writer)) {
+		close(fds[1]);
+		ret = 0;
+	} else {
+		ret = embed_to_mem(pipe_path, &piped);
+		pthread_join(thread, NULL);
+	}
+	close(fds[0]);
+
+	mapped_data = line_sink_mem_data(&mapped, &mapped_size);
+	piped_data = ret ? line_sink_mem_data(&piped, &piped_size) : NULL;
+	if (piped_data == NULL ||
+	    mapped_size < prefix_len + strlen(mapped_len) ||
+	    memcmp(mapped_data, head, prefix_len) ||
+	    memcmp(mapped_data + prefix_len, mapped_len, strlen(mapped_len))) {
+		ret = 0;
+	} else {
+		/* the same, but with "[]" instead of the length */
+		ret = piped_size + strlen(mapped_len) - 2 == mapped_size &&
+		      !memcmp(piped_data, mapped_data, prefix_len) &&
+		      !memcmp(piped_data + prefix_len, "[]", 2) &&
+		      !memcmp(piped_data + prefix_len + 2,
+			      mapped_data + prefix_len + strlen(mapped_len),
+			      piped_size - prefix_len - 2);
+	}
+	if (piped_data != NULL) {
+		line_sink_mem_free(&piped);
+	}
+	line_sink_mem_free(&mapped);
+	free(bytes);
+
+	return ret;
+}
+
 static void test_cs()
 {
 	size_t test_i;
@@ -82,7 +769,23 @@ static void test_cs()
 	for (test_i = 0; test_i < N_C_GEN_TESTS; test_i++) {
 		printlg(INFO_LEVEL, "Running c_gen test %u...\n",
 			(unsigned) test_i);
-		if (test_c(c_gen_tvs[test_i])) {
+		if (test_c(c_gen_tvs[test_i], open_c_gen)) {
+			printlg(INFO_LEVEL, "Passed!\n");
+		} else {
+			printlg(ERROR_LEVEL, "Failed!\n");
+		}
+		printlg(INFO_LEVEL,
+			"Running c_gen test %u into a mapped file...\n",
+			(unsigned) test_i);
+		if (test_c(c_gen_tvs[test_i], open_c_gen_mapped)) {
+			printlg(INFO_LEVEL, "Passed!\n");
+		} else {
+			printlg(ERROR_LEVEL, "Failed!\n");
+		}
+		printlg(INFO_LEVEL,
+			"Running c_gen test %u into memory...\n",
+			(unsigned) test_i);
+		if (test_c_mem(c_gen_tvs[test_i])) {
 			printlg(INFO_LEVEL, "Passed!\n");
 		} else {
 			printlg(ERROR_LEVEL, "Failed!\n");
@@ -92,7 +795,102 @@ static void test_cs()
 
 int main()
 {
+	int streamed;
+
 	test_cs();
+	for (streamed = 0; streamed <= 1; streamed++) {
+		printlg(INFO_LEVEL, "Running %s file comparison test...\n",
+			streamed ? "streamed" : "mapped");
+		if (test_compare(streamed)) {
+			printlg(INFO_LEVEL, "Passed!\n");
+		} else {
+			printlg(ERROR_LEVEL, "Failed!\n");
+		}
+	}
+	printlg(INFO_LEVEL, "Running write-if-changed test...\n");
+	if (test_if_changed()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running checkpoint test...\n");
+	if (test_checkpoint()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running sticky-error test...\n");
+	if (test_sticky()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running streamed embedding test...\n");
+	if (test_embed_stream()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running hole test...\n");
+	if (test_hole()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running literal placement test...\n");
+	if (test_literal_buffers()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running fragment cache test...\n");
+	if (test_frag_cache()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running snippet test...\n");
+	if (test_c_snippet()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running string arena test...\n");
+	if (test_str_arena()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+	printlg(INFO_LEVEL, "Running sharded output test...\n");
+	if (test_c_shards()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+#ifdef LINE_GEN_STATS
+	printlg(INFO_LEVEL, "Running line_gen counters test...\n");
+	if (test_line_gen_stats()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+#endif
+#ifndef LOG_BINARY
+	printlg(INFO_LEVEL, "Running asynchronous logging test...\n");
+	if (test_log_async()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+#endif
+#ifndef LOG_ASYNC
+	printlg(INFO_LEVEL, "Running binary logging test...\n");
+	if (test_log_binary()) {
+		printlg(INFO_LEVEL, "Passed!\n");
+	} else {
+		printlg(ERROR_LEVEL, "Failed!\n");
+	}
+#endif
 
 	return 0;
 }
@@ -0,0 +1,37 @@
+/*
+ * Render a binary log, written by a program built with LOG_BINARY defined,
+ * as the text printlg would have written.
+ * usage:	log_decode [-t] [path]
+ * -t:		start each line with the timestamp of its event
+ * path:	the binary log to read, or stdin if omitted
+ */
+#include <log_binary.h>
+#include <logger.h>
+
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char *argv[])
+{
+	int timestamps = 0, arg_i = 1, ret;
+	FILE *in = stdin;
+
+	if (arg_i < argc && !strcmp(argv[arg_i], "-t")) {
+		timestamps = 1;
+		arg_i++;
+	}
+	if (arg_i < argc && (in = fopen(argv[arg_i], "rb")) == NULL) {
+		printlg(ERROR_LEVEL, "Could not open %s.\n", argv[arg_i]);
+		return 1;
+	}
+
+	ret = log_binary_decode(in, stdout, timestamps);
+	if (ret) {
+		printlg(ERROR_LEVEL, "Malformed binary log.\n");
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	return ret ? 1 : 0;
+}